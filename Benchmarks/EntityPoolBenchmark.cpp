@@ -0,0 +1,301 @@
+// Headless microbenchmark for the entity pools, compared to allocating every entity on its own as SceneHolder used to.
+// Only depends on the standard library. Results are written to stdout as JSON.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "EntityPool.h"
+
+
+// Stand-in for an object, about as large as one and updated by touching its transform like Entity::Update() does.
+struct BenchmarkEntity
+{
+	float world[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	float position[4] = { };
+	float bounds[6] = { };
+	bool isDirty = true;
+	unsigned char resources[320] = { }; // Buffers, material IDs & the rest of the object.
+
+	explicit BenchmarkEntity(const float x)
+	{
+		position[0] = x;
+	}
+
+	void Update()
+	{
+		if (!isDirty)
+			return;
+
+		world[12] = position[0];
+		world[13] = position[1];
+		world[14] = position[2];
+		bounds[0] = world[12] - 1.0f;
+		bounds[3] = world[12] + 1.0f;
+	}
+};
+
+// The wrapper every entity used to be allocated alongside.
+struct HeapEntity
+{
+	BenchmarkEntity *entity = nullptr;
+};
+
+struct BenchmarkSettings
+{
+	std::vector<UINT> counts = { 1000, 10000, 100000 };
+	UINT iterations = 16;
+	float churnRatio = 0.25f;
+	UINT seed = 1337;
+};
+
+struct OperationResult
+{
+	const char *name = "";
+	size_t ops = 0;
+	double totalNs = 0.0;
+};
+
+
+template <typename Func>
+static OperationResult TimeOperation(const char *name, const size_t ops, Func &&func)
+{
+	const auto start = std::chrono::steady_clock::now();
+	func();
+	const auto end = std::chrono::steady_clock::now();
+
+	OperationResult result;
+	result.name = name;
+	result.ops = ops;
+	result.totalNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	return result;
+}
+
+static void PrintOperation(const OperationResult &result, const bool last)
+{
+	const double nsPerOp = result.ops > 0 ? result.totalNs / static_cast<double>(result.ops) : 0.0;
+
+	std::printf(
+		"\t\t\t\t\"%s\": { \"ops\": %zu, \"totalMs\": %.4f, \"nsPerOp\": %.2f }%s\n",
+		result.name, result.ops, result.totalNs / 1.0e6, nsPerOp, last ? "" : ","
+	);
+}
+
+static void PrintCase(const char *storage, const UINT count, const std::vector<OperationResult> &results, const float checksum, const bool last)
+{
+	std::printf("\t\t{\n");
+	std::printf("\t\t\t\"storage\": \"%s\",\n", storage);
+	std::printf("\t\t\t\"entities\": %u,\n", count);
+	std::printf("\t\t\t\"checksum\": %.1f,\n", checksum);
+	std::printf("\t\t\t\"operations\": {\n");
+	for (size_t i = 0; i < results.size(); i++)
+		PrintOperation(results[i], i + 1 == results.size());
+	std::printf("\t\t\t}\n");
+	std::printf("\t\t}%s\n", last ? "" : ",");
+}
+
+
+// Each case allocates every entity, updates them all, replaces a share of them at random, updates them all again & tears down.
+// Entities are iterated through the dense array of wrappers for the heap & in memory order for the pool, as the scene does.
+static void RunHeapCase(const BenchmarkSettings &settings, const UINT count, const bool last)
+{
+	std::mt19937 rng(settings.seed);
+	std::vector<HeapEntity *> entities;
+	std::vector<OperationResult> results;
+	float checksum = 0.0f;
+
+	auto iterate = [&]()
+	{
+		for (UINT i = 0; i < settings.iterations; i++)
+			for (HeapEntity *ent : entities)
+			{
+				ent->entity->Update();
+				checksum += ent->entity->bounds[0];
+			}
+	};
+
+	results.push_back(TimeOperation("Allocate", count, [&]()
+	{
+		entities.reserve(count);
+		for (UINT i = 0; i < count; i++)
+		{
+			HeapEntity *ent = new HeapEntity();
+			ent->entity = new BenchmarkEntity(static_cast<float>(i));
+			entities.push_back(ent);
+		}
+	}));
+
+	results.push_back(TimeOperation("Iterate", static_cast<size_t>(count) * settings.iterations, iterate));
+
+	const UINT churnCount = static_cast<UINT>(static_cast<float>(count) * settings.churnRatio);
+	results.push_back(TimeOperation("Churn", churnCount, [&]()
+	{
+		for (UINT i = 0; i < churnCount; i++)
+		{
+			const size_t index = rng() % entities.size();
+			delete entities[index]->entity;
+			delete entities[index];
+			entities[index] = entities.back();
+			entities.pop_back();
+
+			HeapEntity *ent = new HeapEntity();
+			ent->entity = new BenchmarkEntity(static_cast<float>(i));
+			entities.push_back(ent);
+		}
+	}));
+
+	results.push_back(TimeOperation("IterateAfterChurn", static_cast<size_t>(count) * settings.iterations, iterate));
+
+	results.push_back(TimeOperation("Teardown", count, [&]()
+	{
+		for (const HeapEntity *ent : entities)
+		{
+			delete ent->entity;
+			delete ent;
+		}
+		entities.clear();
+	}));
+
+	PrintCase("heap", count, results, checksum, last);
+}
+
+static void RunPoolCase(const BenchmarkSettings &settings, const UINT count, const bool last)
+{
+	std::mt19937 rng(settings.seed);
+	EntityPool<BenchmarkEntity> pool;
+	std::vector<UINT> poolIndices;
+	std::vector<OperationResult> results;
+	float checksum = 0.0f;
+
+	auto iterate = [&]()
+	{
+		for (UINT i = 0; i < settings.iterations; i++)
+		{
+			(void)pool.ForEach([&checksum](BenchmarkEntity *entity)
+			{
+				entity->Update();
+				checksum += entity->bounds[0];
+				return true;
+			});
+		}
+	};
+
+	results.push_back(TimeOperation("Allocate", count, [&]()
+	{
+		poolIndices.resize(count);
+		for (UINT i = 0; i < count; i++)
+			(void)pool.Create(poolIndices[i], static_cast<float>(i));
+	}));
+
+	results.push_back(TimeOperation("Iterate", static_cast<size_t>(count) * settings.iterations, iterate));
+
+	const UINT churnCount = static_cast<UINT>(static_cast<float>(count) * settings.churnRatio);
+	results.push_back(TimeOperation("Churn", churnCount, [&]()
+	{
+		for (UINT i = 0; i < churnCount; i++)
+		{
+			const size_t index = rng() % poolIndices.size();
+			pool.Destroy(poolIndices[index]);
+			poolIndices[index] = poolIndices.back();
+			poolIndices.pop_back();
+
+			poolIndices.emplace_back();
+			(void)pool.Create(poolIndices.back(), static_cast<float>(i));
+		}
+	}));
+
+	results.push_back(TimeOperation("IterateAfterChurn", static_cast<size_t>(count) * settings.iterations, iterate));
+
+	results.push_back(TimeOperation("Teardown", count, [&]()
+	{
+		pool.Clear();
+		poolIndices.clear();
+	}));
+
+	PrintCase("pool", count, results, checksum, last);
+}
+
+
+static std::vector<std::string> SplitList(const std::string &list)
+{
+	std::vector<std::string> items;
+
+	size_t start = 0;
+	while (start <= list.size())
+	{
+		const size_t end = list.find(',', start);
+		const std::string item = list.substr(start, end == std::string::npos ? std::string::npos : end - start);
+		if (!item.empty())
+			items.push_back(item);
+
+		if (end == std::string::npos)
+			break;
+		start = end + 1;
+	}
+
+	return items;
+}
+
+static bool ParseArguments(const int argc, char **argv, BenchmarkSettings &settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			std::fprintf(stderr, "Missing value for argument '%s'!\n", arg.c_str());
+			return false;
+		}
+
+		const std::string value = argv[++i];
+
+		if (arg == "--counts")
+		{
+			settings.counts.clear();
+			for (const std::string &item : SplitList(value))
+				settings.counts.push_back(static_cast<UINT>(std::strtoul(item.c_str(), nullptr, 10)));
+		}
+		else if (arg == "--iterations")
+			settings.iterations = static_cast<UINT>(std::strtoul(value.c_str(), nullptr, 10));
+		else if (arg == "--churn")
+			settings.churnRatio = std::strtof(value.c_str(), nullptr);
+		else if (arg == "--seed")
+			settings.seed = static_cast<UINT>(std::strtoul(value.c_str(), nullptr, 10));
+		else
+		{
+			std::fprintf(stderr, "Unknown argument '%s'!\n", arg.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int main(int argc, char **argv)
+{
+	BenchmarkSettings settings;
+	if (!ParseArguments(argc, argv, settings))
+	{
+		std::fprintf(stderr, "Usage: EntityPoolBenchmark [--counts 1000,100000] [--iterations N] [--churn R] [--seed N]\n");
+		return 1;
+	}
+
+	std::printf("{\n");
+	std::printf("\t\"benchmark\": \"EntityPool\",\n");
+	std::printf("\t\"seed\": %u,\n", settings.seed);
+	std::printf("\t\"results\": [\n");
+
+	for (size_t i = 0; i < settings.counts.size(); i++)
+	{
+		RunHeapCase(settings, settings.counts[i], false);
+		RunPoolCase(settings, settings.counts[i], i + 1 == settings.counts.size());
+	}
+
+	std::printf("\t]\n");
+	std::printf("}\n");
+	return 0;
+}
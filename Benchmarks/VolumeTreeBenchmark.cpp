@@ -0,0 +1,784 @@
+// Headless microbenchmark for the volume trees.
+// Only depends on DirectXMath & DirectXCollision, so it builds and runs without a device.
+// Results are written to stdout as JSON.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Quadtree.h"
+#include "Octree.h"
+#include "LooseOctree.h"
+#include "LinearOctree.h"
+#include "Bvh.h"
+#include "Notree.h"
+#include "HashGrid.h"
+#include "CullingKernel.h"
+
+using namespace DirectX;
+
+
+// Stand-in for the engine entity. The volume trees only store and compare entity pointers.
+class Entity
+{
+public:
+	UINT id = 0;
+};
+
+
+enum class Distribution
+{
+	UNIFORM,
+	CLUSTERED,
+	CITY,
+	LONG_THIN,
+};
+
+struct BenchmarkSettings
+{
+	std::vector<UINT> counts = { 1000, 10000, 100000, 1000000 };
+	std::vector<VolumeTreeType> trees = { VolumeTreeType::QUADTREE, VolumeTreeType::OCTREE, VolumeTreeType::LOOSE_OCTREE, VolumeTreeType::LINEAR_OCTREE, VolumeTreeType::BVH, VolumeTreeType::NOTREE, VolumeTreeType::HASH_GRID };
+	std::vector<Distribution> distributions = { Distribution::UNIFORM, Distribution::CLUSTERED, Distribution::CITY, Distribution::LONG_THIN };
+	UINT queryCount = 64;
+	UINT rayCount = 1024;
+	UINT nearestCount = 8;
+	UINT removeCount = 1000;
+	UINT seed = 1337;
+	float cellSize = HashGrid::DEFAULT_CELL_SIZE;
+};
+
+struct OperationResult
+{
+	const char *name = "";
+	size_t ops = 0;
+	double totalNs = 0.0;
+	size_t resultItems = 0;
+	size_t nodesVisited = 0;
+	size_t intersectionTests = 0;
+	size_t duplicateItems = 0;
+};
+
+
+static const char *GetTreeName(const VolumeTreeType type)
+{
+	switch (type)
+	{
+		case VolumeTreeType::QUADTREE:		return "Quadtree";
+		case VolumeTreeType::OCTREE:		return "Octree";
+		case VolumeTreeType::LOOSE_OCTREE:	return "LooseOctree";
+		case VolumeTreeType::LINEAR_OCTREE:	return "LinearOctree";
+		case VolumeTreeType::BVH:			return "Bvh";
+		case VolumeTreeType::NOTREE:		return "Notree";
+		case VolumeTreeType::HASH_GRID:		return "HashGrid";
+	}
+
+	return "Unknown";
+}
+
+static const char *GetDistributionName(const Distribution distribution)
+{
+	switch (distribution)
+	{
+		case Distribution::UNIFORM:		return "uniform";
+		case Distribution::CLUSTERED:	return "clustered";
+		case Distribution::CITY:		return "city";
+		case Distribution::LONG_THIN:	return "long_thin";
+	}
+
+	return "unknown";
+}
+
+static std::unique_ptr<VolumeTree> CreateVolumeTree(const VolumeTreeType type, const float cellSize)
+{
+	switch (type)
+	{
+		case VolumeTreeType::QUADTREE:		return std::make_unique<Quadtree>();
+		case VolumeTreeType::OCTREE:		return std::make_unique<Octree>();
+		case VolumeTreeType::LOOSE_OCTREE:	return std::make_unique<LooseOctree>();
+		case VolumeTreeType::LINEAR_OCTREE:	return std::make_unique<LinearOctree>();
+		case VolumeTreeType::BVH:			return std::make_unique<Bvh>();
+		case VolumeTreeType::NOTREE:		return std::make_unique<Notree>();
+		case VolumeTreeType::HASH_GRID:		return std::make_unique<HashGrid>(cellSize);
+	}
+
+	return nullptr;
+}
+
+
+// Generates entity bounds fully contained within the returned world bounds.
+// The world grows with the entity count to keep the entity density roughly constant.
+static BoundingBox GenerateBounds(const Distribution distribution, const UINT count, std::mt19937 &rng, std::vector<BoundingBox> &entityBounds)
+{
+	const float densityScale = static_cast<float>(count) / 1000.0f;
+
+	XMFLOAT3 worldExtents;
+	if (distribution == Distribution::CITY)
+	{
+		const float planarExtent = 64.0f * std::sqrt(densityScale);
+		worldExtents = { planarExtent, 32.0f, planarExtent };
+	}
+	else
+	{
+		const float extent = 64.0f * std::cbrt(densityScale);
+		worldExtents = { extent, extent, extent };
+	}
+
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> smallSize(0.25f, 1.0f);
+
+	auto clampInside = [&worldExtents](XMFLOAT3 &center, XMFLOAT3 &extents)
+	{
+		extents.x = (std::min)(extents.x, worldExtents.x);
+		extents.y = (std::min)(extents.y, worldExtents.y);
+		extents.z = (std::min)(extents.z, worldExtents.z);
+		center.x = std::clamp(center.x, -worldExtents.x + extents.x, worldExtents.x - extents.x);
+		center.y = std::clamp(center.y, -worldExtents.y + extents.y, worldExtents.y - extents.y);
+		center.z = std::clamp(center.z, -worldExtents.z + extents.z, worldExtents.z - extents.z);
+	};
+
+	std::vector<XMFLOAT3> clusters;
+	if (distribution == Distribution::CLUSTERED)
+	{
+		for (UINT i = 0; i < 32; i++)
+			clusters.push_back({ unit(rng) * worldExtents.x, unit(rng) * worldExtents.y, unit(rng) * worldExtents.z });
+	}
+	std::normal_distribution<float> clusterSpread(0.0f, worldExtents.x * 0.05f);
+	std::uniform_int_distribution<UINT> clusterIndex(0, 31);
+	std::uniform_int_distribution<UINT> axisIndex(0, 2);
+
+	entityBounds.clear();
+	entityBounds.reserve(count);
+
+	for (UINT i = 0; i < count; i++)
+	{
+		XMFLOAT3 center, extents;
+
+		switch (distribution)
+		{
+			case Distribution::UNIFORM:
+				center = { unit(rng) * worldExtents.x, unit(rng) * worldExtents.y, unit(rng) * worldExtents.z };
+				extents = { smallSize(rng), smallSize(rng), smallSize(rng) };
+				break;
+
+			case Distribution::CLUSTERED:
+			{
+				const XMFLOAT3 &cluster = clusters[clusterIndex(rng)];
+				center = { cluster.x + clusterSpread(rng), cluster.y + clusterSpread(rng), cluster.z + clusterSpread(rng) };
+				extents = { smallSize(rng), smallSize(rng), smallSize(rng) };
+				break;
+			}
+
+			case Distribution::CITY:
+			{ // Buildings standing on the ground plane at the bottom of the world.
+				const float height = 1.0f + 15.0f * (0.5f + 0.5f * unit(rng));
+				extents = { 1.0f + 3.0f * smallSize(rng), height, 1.0f + 3.0f * smallSize(rng) };
+				center = { unit(rng) * worldExtents.x, -worldExtents.y + height, unit(rng) * worldExtents.z };
+				break;
+			}
+
+			case Distribution::LONG_THIN:
+			{ // Poles, pipes & beams along one of the world axes.
+				const float length = 8.0f + 16.0f * (0.5f + 0.5f * unit(rng));
+				extents = { 0.1f, 0.1f, 0.1f };
+				switch (axisIndex(rng))
+				{
+					case 0: extents.x = length; break;
+					case 1: extents.y = length; break;
+					default: extents.z = length; break;
+				}
+				center = { unit(rng) * worldExtents.x, unit(rng) * worldExtents.y, unit(rng) * worldExtents.z };
+				break;
+			}
+		}
+
+		clampInside(center, extents);
+		entityBounds.emplace_back(center, extents);
+	}
+
+	return BoundingBox({ 0.0f, 0.0f, 0.0f }, worldExtents);
+}
+
+static XMFLOAT4 RandomOrientation(std::mt19937 &rng)
+{
+	std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+
+	XMFLOAT4 orientation;
+	XMStoreFloat4(&orientation, XMQuaternionRotationRollPitchYaw(angle(rng) * 0.5f, angle(rng), 0.0f));
+	return orientation;
+}
+
+static XMFLOAT3 RandomPoint(const BoundingBox &world, std::mt19937 &rng)
+{
+	std::uniform_real_distribution<float> unit(-0.8f, 0.8f);
+
+	return {
+		world.Center.x + world.Extents.x * unit(rng),
+		world.Center.y + world.Extents.y * unit(rng),
+		world.Center.z + world.Extents.z * unit(rng)
+	};
+}
+
+// Camera frustum with a 60 degree vertical field of view, reaching halfway across the world.
+static BoundingFrustum RandomFrustum(const BoundingBox &world, std::mt19937 &rng)
+{
+	const float tanHalfFov = std::tan(XMConvertToRadians(30.0f));
+	const float farZ = (std::max)(world.Extents.x, world.Extents.z) * 0.5f;
+
+	return BoundingFrustum(RandomPoint(world, rng), RandomOrientation(rng),
+		tanHalfFov * (16.0f / 9.0f), -tanHalfFov * (16.0f / 9.0f), tanHalfFov, -tanHalfFov, 0.1f, farZ);
+}
+
+
+static void ResetStats()
+{
+#ifdef VOLUME_TREE_STATS
+	volumeTreeStats = { };
+#endif
+}
+
+static void StoreStats(OperationResult &result)
+{
+#ifdef VOLUME_TREE_STATS
+	result.nodesVisited = volumeTreeStats.nodesVisited;
+	result.intersectionTests = volumeTreeStats.intersectionTests;
+	result.duplicateItems = volumeTreeStats.duplicateItems;
+#endif
+}
+
+template <typename Func>
+static OperationResult TimeOperation(const char *name, const size_t ops, Func &&func)
+{
+	OperationResult result;
+	result.name = name;
+	result.ops = ops;
+
+	ResetStats();
+	const auto start = std::chrono::steady_clock::now();
+	result.resultItems = func();
+	const auto end = std::chrono::steady_clock::now();
+	StoreStats(result);
+
+	result.totalNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	return result;
+}
+
+
+static void PrintOperation(const OperationResult &result, const bool last)
+{
+	const double ops = result.ops > 0 ? static_cast<double>(result.ops) : 1.0;
+
+	// Node traversal throughput, only meaningful when built with VOLUME_TREE_STATS.
+	const double nodesPerUs = result.totalNs > 0.0 ? static_cast<double>(result.nodesVisited) * 1000.0 / result.totalNs : 0.0;
+
+	std::printf(
+		"\t\t\t\t\"%s\": { \"ops\": %zu, \"nsPerOp\": %.2f, \"resultItemsPerOp\": %.2f, "
+		"\"nodesVisitedPerOp\": %.2f, \"intersectionTestsPerOp\": %.2f, \"duplicateItemsPerOp\": %.2f, \"nodesVisitedPerUs\": %.2f }%s\n",
+		result.name, result.ops, result.totalNs / ops, static_cast<double>(result.resultItems) / ops,
+		static_cast<double>(result.nodesVisited) / ops, static_cast<double>(result.intersectionTests) / ops,
+		static_cast<double>(result.duplicateItems) / ops, nodesPerUs, last ? "" : ",");
+}
+
+static bool RunCase(const BenchmarkSettings &settings, const VolumeTreeType treeType, const Distribution distribution, const UINT count, const bool last)
+{
+	std::mt19937 rng(settings.seed + count);
+
+	std::vector<BoundingBox> entityBounds;
+	const BoundingBox worldBounds = GenerateBounds(distribution, count, rng, entityBounds);
+
+	std::vector<Entity> entities(count);
+	for (UINT i = 0; i < count; i++)
+		entities[i].id = i;
+
+	// Queries are generated up front so that every tree is measured against the same set.
+	const float farZ = (std::max)(worldBounds.Extents.x, worldBounds.Extents.z) * 0.5f;
+
+	std::vector<BoundingFrustum> frustums;
+	std::vector<BoundingOrientedBox> boxes;
+	for (UINT i = 0; i < settings.queryCount; i++)
+	{
+		frustums.push_back(RandomFrustum(worldBounds, rng));
+
+		const float boxExtent = farZ * 0.25f;
+		boxes.emplace_back(RandomPoint(worldBounds, rng), XMFLOAT3(boxExtent, boxExtent, boxExtent), RandomOrientation(rng));
+	}
+
+	std::vector<XMFLOAT3A> rayOrigins, rayDirections;
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (UINT i = 0; i < settings.rayCount; i++)
+	{
+		const XMFLOAT3 origin = RandomPoint(worldBounds, rng);
+		rayOrigins.emplace_back(origin.x, origin.y, origin.z);
+
+		XMFLOAT3A direction;
+		XMStoreFloat3A(&direction, XMVector3Normalize(XMVectorSet(unit(rng), unit(rng), unit(rng), 0.0f)));
+		rayDirections.push_back(direction);
+	}
+
+	std::vector<UINT> removeOrder(count);
+	for (UINT i = 0; i < count; i++)
+		removeOrder[i] = i;
+	std::shuffle(removeOrder.begin(), removeOrder.end(), rng);
+	removeOrder.resize((std::min)(count, settings.removeCount));
+
+
+	std::unique_ptr<VolumeTree> tree = CreateVolumeTree(treeType, settings.cellSize);
+	if (tree == nullptr || !tree->Initialize(worldBounds))
+	{
+		std::fprintf(stderr, "Failed to initialize %s!\n", GetTreeName(treeType));
+		return false;
+	}
+
+	std::vector<OperationResult> results;
+
+	results.push_back(TimeOperation("Insert", count, [&]()
+	{
+		for (UINT i = 0; i < count; i++)
+			tree->Insert(&entities[i], entityBounds[i]);
+
+		// Deferred backends build their structure here, once per frame in the engine.
+		if (!tree->Update())
+			std::fprintf(stderr, "Tree update failed!\n");
+		return static_cast<size_t>(count);
+	}));
+
+	// Level load into a second tree, handing every entity over in one batch.
+	std::unique_ptr<VolumeTree> bulkTree = CreateVolumeTree(treeType, settings.cellSize);
+	if (bulkTree == nullptr || !bulkTree->Initialize(worldBounds))
+	{
+		std::fprintf(stderr, "Failed to initialize %s!\n", GetTreeName(treeType));
+		return false;
+	}
+
+	results.push_back(TimeOperation("InsertBulk", count, [&]()
+	{
+		std::vector<VolumeTreeItem> items(count);
+		for (UINT i = 0; i < count; i++)
+			items[i] = { &entities[i], entityBounds[i] };
+
+		bulkTree->InsertBulk(items);
+
+		if (!bulkTree->Update())
+			std::fprintf(stderr, "Tree update failed!\n");
+		return static_cast<size_t>(count);
+	}));
+	bulkTree.reset();
+
+	std::vector<BoundingBox> structure;
+	tree->DebugGetStructure(structure);
+
+	std::vector<Entity *> containingItems;
+	containingItems.reserve(count);
+
+	results.push_back(TimeOperation("FrustumCull", frustums.size(), [&]()
+	{
+		size_t total = 0;
+		for (const BoundingFrustum &frustum : frustums)
+		{
+			containingItems.clear();
+			if (!tree->FrustumCull(frustum, containingItems))
+				std::fprintf(stderr, "Frustum cull failed!\n");
+			total += containingItems.size();
+		}
+		return total;
+	}));
+
+	results.push_back(TimeOperation("BoxCull", boxes.size(), [&]()
+	{
+		size_t total = 0;
+		for (const BoundingOrientedBox &box : boxes)
+		{
+			containingItems.clear();
+			if (!tree->BoxCull(box, containingItems))
+				std::fprintf(stderr, "Box cull failed!\n");
+			total += containingItems.size();
+		}
+		return total;
+	}));
+
+	// The frustums again, all culled in a single traversal. Reported per view to compare with FrustumCull.
+	std::vector<CullingPlanes> views;
+	for (const BoundingFrustum &frustum : frustums)
+		views.push_back(CullingPlanes::FromFrustum(frustum));
+
+	std::vector<std::vector<Entity *>> viewItems(views.size());
+
+	results.push_back(TimeOperation("MultiViewCull", views.size(), [&]()
+	{
+		size_t total = 0;
+		for (size_t first = 0; first < views.size(); first += MAX_CULLING_VIEWS)
+		{
+			const UINT viewCount = static_cast<UINT>((std::min)(views.size() - first, static_cast<size_t>(MAX_CULLING_VIEWS)));
+			if (!tree->MultiViewCull(MultiViewQuery(&views[first], &viewItems[first], viewCount)))
+				std::fprintf(stderr, "Multi-view cull failed!\n");
+		}
+
+		for (const std::vector<Entity *> &items : viewItems)
+			total += items.size();
+		return total;
+	}));
+
+	results.push_back(TimeOperation("RaycastTree", rayOrigins.size(), [&]()
+	{
+		size_t hits = 0;
+		for (size_t i = 0; i < rayOrigins.size(); i++)
+		{
+			float length = FLT_MAX;
+			Entity *hit = nullptr;
+			if (tree->RaycastTree(rayOrigins[i], rayDirections[i], length, hit, nullptr))
+				hits++;
+		}
+		return hits;
+	}));
+
+	// The same rays traced a packet at a time in closest-hit mode, to compare with RaycastTree.
+	results.push_back(TimeOperation("RaycastPacket", rayOrigins.size(), [&]()
+	{
+		size_t hits = 0;
+		RayPacket packet;
+		for (size_t first = 0; first < rayOrigins.size(); first += RayPacket::WIDTH)
+		{
+			packet.Clear(RaycastMode::CLOSEST_HIT);
+			for (size_t i = first; i < rayOrigins.size() && !packet.IsFull(); i++)
+				packet.AddRay(rayOrigins[i], rayDirections[i], FLT_MAX, static_cast<UINT>(i));
+
+			tree->RaycastPacket(packet, nullptr);
+
+			for (UINT ray = 0; ray < packet.count; ray++)
+			{
+				if (packet.entity[ray] != nullptr)
+					hits++;
+			}
+		}
+		return hits;
+	}));
+
+	// Neighbour queries around the ray origins, such as AI sensing or audio source selection.
+	std::vector<NearestItem> nearestItems;
+
+	results.push_back(TimeOperation("FindNearest", rayOrigins.size(), [&]()
+	{
+		size_t total = 0;
+		for (const XMFLOAT3A &origin : rayOrigins)
+		{
+			nearestItems.clear();
+			NearestQuery query(origin, FLT_MAX, settings.nearestCount, nearestItems);
+			if (!tree->NearestCull(query))
+				std::fprintf(stderr, "Nearest cull failed!\n");
+			query.End();
+			total += nearestItems.size();
+		}
+		return total;
+	}));
+
+	const float queryRadius = farZ * 0.1f;
+	results.push_back(TimeOperation("FindInRadius", rayOrigins.size(), [&]()
+	{
+		size_t total = 0;
+		for (const XMFLOAT3A &origin : rayOrigins)
+		{
+			nearestItems.clear();
+			NearestQuery query(origin, queryRadius, 0, nearestItems);
+			if (!tree->NearestCull(query))
+				std::fprintf(stderr, "Radius cull failed!\n");
+			query.End();
+			total += nearestItems.size();
+		}
+		return total;
+	}));
+
+	// Small per-frame style offsets, so most moves stay near where the entity was.
+	std::vector<BoundingBox> movedBounds;
+	std::uniform_real_distribution<float> moveOffset(-0.5f, 0.5f);
+	for (const UINT i : removeOrder)
+	{
+		BoundingBox moved = entityBounds[i];
+		moved.Center.x = std::clamp(moved.Center.x + moveOffset(rng), -worldBounds.Extents.x + moved.Extents.x, worldBounds.Extents.x - moved.Extents.x);
+		moved.Center.y = std::clamp(moved.Center.y + moveOffset(rng), -worldBounds.Extents.y + moved.Extents.y, worldBounds.Extents.y - moved.Extents.y);
+		moved.Center.z = std::clamp(moved.Center.z + moveOffset(rng), -worldBounds.Extents.z + moved.Extents.z, worldBounds.Extents.z - moved.Extents.z);
+		movedBounds.push_back(moved);
+	}
+
+	results.push_back(TimeOperation("Move", removeOrder.size(), [&]()
+	{
+		size_t moved = 0;
+		for (size_t i = 0; i < removeOrder.size(); i++)
+		{
+			const UINT index = removeOrder[i];
+			if (tree->Move(&entities[index], movedBounds[i]))
+			{
+				entityBounds[index] = movedBounds[i];
+				moved++;
+			}
+		}
+		return moved;
+	}));
+
+	results.push_back(TimeOperation("Remove", removeOrder.size(), [&]()
+	{
+		size_t removed = 0;
+		for (const UINT i : removeOrder)
+		{
+			if (tree->Remove(&entities[i], entityBounds[i]))
+				removed++;
+		}
+		return removed;
+	}));
+
+
+	std::printf("\t\t{\n");
+	std::printf("\t\t\t\"tree\": \"%s\",\n", GetTreeName(treeType));
+	std::printf("\t\t\t\"distribution\": \"%s\",\n", GetDistributionName(distribution));
+	std::printf("\t\t\t\"entities\": %u,\n", count);
+	std::printf("\t\t\t\"leafNodes\": %zu,\n", structure.size());
+	std::printf("\t\t\t\"operations\": {\n");
+	for (size_t i = 0; i < results.size(); i++)
+		PrintOperation(results[i], i + 1 == results.size());
+	std::printf("\t\t\t}\n");
+	std::printf("\t\t}%s\n", last ? "" : ",");
+	std::fflush(stdout);
+
+	return true;
+}
+
+// Compares the scalar & wide plane kernels, and the per-box DirectXCollision test they replace, by classifying
+// every entity against each frustum without a tree.
+static bool RunKernelCase(const BenchmarkSettings &settings, const Distribution distribution, const UINT count, const bool last)
+{
+	std::mt19937 rng(settings.seed + count);
+
+	std::vector<BoundingBox> entityBounds;
+	const BoundingBox worldBounds = GenerateBounds(distribution, count, rng, entityBounds);
+
+	CullingBoxes cullingBoxes;
+	cullingBoxes.Reserve(count);
+	for (const BoundingBox &bounds : entityBounds)
+		cullingBoxes.PushBack(bounds);
+
+	std::vector<CullingPlanes> planes;
+	std::vector<BoundingFrustum> frustums;
+	for (UINT i = 0; i < settings.queryCount; i++)
+	{
+		frustums.push_back(RandomFrustum(worldBounds, rng));
+		planes.push_back(CullingPlanes::FromFrustum(frustums.back()));
+	}
+
+	const size_t ops = static_cast<size_t>(count) * planes.size();
+	std::vector<UINT> scalarResults(count), wideResults(count); // Reused by every query.
+	std::vector<OperationResult> results;
+
+	results.push_back(TimeOperation("BoundingFrustum::Contains", ops, [&]()
+	{
+		size_t total = 0;
+		for (const BoundingFrustum &frustum : frustums)
+		{
+			for (const BoundingBox &bounds : entityBounds)
+			{
+				if (frustum.Contains(bounds) != DISJOINT)
+					total++;
+			}
+		}
+		return total;
+	}));
+
+	auto classifyAll = [&](auto &&classify, std::vector<UINT> &classifyResults)
+	{
+		size_t total = 0;
+		for (const CullingPlanes &queryPlanes : planes)
+		{
+			classify(queryPlanes, CULLING_ALL_PLANES, cullingBoxes, 0, count, classifyResults.data());
+
+			for (UINT j = 0; j < count; j++)
+			{
+				if (classifyResults[j] != CULLING_OUTSIDE)
+					total++;
+			}
+		}
+		return total;
+	};
+
+	results.push_back(TimeOperation("ClassifyBoxesScalar", ops, [&]() { return classifyAll(ClassifyBoxesScalar, scalarResults); }));
+	results.push_back(TimeOperation("ClassifyBoxes", ops, [&]() { return classifyAll(ClassifyBoxes, wideResults); }));
+
+	// Compared outside the timed runs, one query at a time.
+	bool resultsMatch = true;
+	for (const CullingPlanes &queryPlanes : planes)
+	{
+		ClassifyBoxesScalar(queryPlanes, CULLING_ALL_PLANES, cullingBoxes, 0, count, scalarResults.data());
+		ClassifyBoxes(queryPlanes, CULLING_ALL_PLANES, cullingBoxes, 0, count, wideResults.data());
+
+		if (scalarResults != wideResults)
+		{
+			resultsMatch = false;
+			break;
+		}
+	}
+
+	std::printf("\t\t{\n");
+	std::printf("\t\t\t\"distribution\": \"%s\",\n", GetDistributionName(distribution));
+	std::printf("\t\t\t\"entities\": %u,\n", count);
+	std::printf("\t\t\t\"kernelWidth\": %d,\n", CULLING_KERNEL_WIDTH);
+	std::printf("\t\t\t\"resultsMatch\": %s,\n", resultsMatch ? "true" : "false");
+	std::printf("\t\t\t\"operations\": {\n");
+	for (size_t i = 0; i < results.size(); i++)
+		PrintOperation(results[i], i + 1 == results.size());
+	std::printf("\t\t\t}\n");
+	std::printf("\t\t}%s\n", last ? "" : ",");
+	std::fflush(stdout);
+
+	return resultsMatch;
+}
+
+
+static std::vector<std::string> SplitList(const std::string &list)
+{
+	std::vector<std::string> items;
+
+	size_t start = 0;
+	while (start <= list.size())
+	{
+		const size_t end = list.find(',', start);
+		const std::string item = list.substr(start, end == std::string::npos ? std::string::npos : end - start);
+		if (!item.empty())
+			items.push_back(item);
+
+		if (end == std::string::npos)
+			break;
+		start = end + 1;
+	}
+
+	return items;
+}
+
+static bool ParseArguments(const int argc, char **argv, BenchmarkSettings &settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			std::fprintf(stderr, "Missing value for argument '%s'!\n", arg.c_str());
+			return false;
+		}
+
+		const std::string value = argv[++i];
+
+		if (arg == "--counts")
+		{
+			settings.counts.clear();
+			for (const std::string &item : SplitList(value))
+				settings.counts.push_back(static_cast<UINT>(std::strtoul(item.c_str(), nullptr, 10)));
+		}
+		else if (arg == "--trees")
+		{
+			settings.trees.clear();
+			for (const std::string &item : SplitList(value))
+			{
+				if (item == "quadtree")				settings.trees.push_back(VolumeTreeType::QUADTREE);
+				else if (item == "octree")			settings.trees.push_back(VolumeTreeType::OCTREE);
+				else if (item == "loose_octree")	settings.trees.push_back(VolumeTreeType::LOOSE_OCTREE);
+				else if (item == "linear_octree")	settings.trees.push_back(VolumeTreeType::LINEAR_OCTREE);
+				else if (item == "bvh")				settings.trees.push_back(VolumeTreeType::BVH);
+				else if (item == "notree")			settings.trees.push_back(VolumeTreeType::NOTREE);
+				else if (item == "hash_grid")		settings.trees.push_back(VolumeTreeType::HASH_GRID);
+				else
+				{
+					std::fprintf(stderr, "Unknown tree '%s'!\n", item.c_str());
+					return false;
+				}
+			}
+		}
+		else if (arg == "--distributions")
+		{
+			settings.distributions.clear();
+			for (const std::string &item : SplitList(value))
+			{
+				if (item == "uniform")			settings.distributions.push_back(Distribution::UNIFORM);
+				else if (item == "clustered")	settings.distributions.push_back(Distribution::CLUSTERED);
+				else if (item == "city")		settings.distributions.push_back(Distribution::CITY);
+				else if (item == "long_thin")	settings.distributions.push_back(Distribution::LONG_THIN);
+				else
+				{
+					std::fprintf(stderr, "Unknown distribution '%s'!\n", item.c_str());
+					return false;
+				}
+			}
+		}
+		else if (arg == "--queries")
+			settings.queryCount = static_cast<UINT>(std::strtoul(value.c_str(), nullptr, 10));
+		else if (arg == "--rays")
+			settings.rayCount = static_cast<UINT>(std::strtoul(value.c_str(), nullptr, 10));
+		else if (arg == "--removes")
+			settings.removeCount = static_cast<UINT>(std::strtoul(value.c_str(), nullptr, 10));
+		else if (arg == "--seed")
+			settings.seed = static_cast<UINT>(std::strtoul(value.c_str(), nullptr, 10));
+		else if (arg == "--cell-size")
+			settings.cellSize = std::strtof(value.c_str(), nullptr);
+		else
+		{
+			std::fprintf(stderr, "Unknown argument '%s'!\n", arg.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int main(int argc, char **argv)
+{
+	BenchmarkSettings settings;
+	if (!ParseArguments(argc, argv, settings))
+	{
+		std::fprintf(stderr,
+			"Usage: VolumeTreeBenchmark [--counts 1000,10000] [--trees quadtree,octree,loose_octree,linear_octree,bvh,notree,hash_grid]\n"
+			"                           [--distributions uniform,clustered,city,long_thin]\n"
+			"                           [--queries N] [--rays N] [--removes N] [--seed N] [--cell-size S]\n");
+		return 1;
+	}
+
+	std::printf("{\n");
+	std::printf("\t\"benchmark\": \"VolumeTree\",\n");
+#ifdef VOLUME_TREE_STATS
+	std::printf("\t\"statsEnabled\": true,\n");
+#else
+	std::printf("\t\"statsEnabled\": false,\n");
+#endif
+	std::printf("\t\"seed\": %u,\n", settings.seed);
+	std::printf("\t\"results\": [\n");
+
+	const size_t caseCount = settings.counts.size() * settings.distributions.size() * settings.trees.size();
+	size_t caseIndex = 0;
+
+	for (const UINT count : settings.counts)
+		for (const Distribution distribution : settings.distributions)
+			for (const VolumeTreeType treeType : settings.trees)
+			{
+				if (!RunCase(settings, treeType, distribution, count, ++caseIndex == caseCount))
+					return 1;
+			}
+
+	std::printf("\t],\n");
+	std::printf("\t\"kernels\": [\n");
+
+	const size_t kernelCaseCount = settings.counts.size() * settings.distributions.size();
+	size_t kernelCaseIndex = 0;
+
+	for (const UINT count : settings.counts)
+		for (const Distribution distribution : settings.distributions)
+		{
+			if (!RunKernelCase(settings, distribution, count, ++kernelCaseIndex == kernelCaseCount))
+			{
+				std::fprintf(stderr, "Scalar & wide culling kernel results differ!\n");
+				return 1;
+			}
+		}
+
+	std::printf("\t]\n");
+	std::printf("}\n");
+	return 0;
+}
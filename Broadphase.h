@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include <DirectXCollision.h>
+
+typedef unsigned int UINT;
+
+// Like the volume trees, the broadphase only stores and returns entity pointers.
+class Entity;
+
+
+// Two entities whose bounds overlap. The first entity has the lower body ID.
+struct CollisionPair
+{
+	Entity *first = nullptr;
+	Entity *second = nullptr;
+};
+
+
+// Finds every pair of overlapping entity bounds with an incremental sweep & prune along the x-axis.
+// Bodies stay sorted by their minimum x between updates, so a frame of small moves only needs a few swaps.
+// Each update splits the sorted bodies into slabs along a second axis, which are swept in parallel.
+// Pairs are kept from one update to the next, reporting which pairs started & stopped overlapping.
+class Broadphase
+{
+private:
+	// Slabs are about this many average box sizes thick, with at least MIN_BOXES_PER_SLAB boxes per slab on average.
+	static constexpr float SLAB_SIZE_IN_BOXES = 4.0f;
+	static constexpr UINT MIN_BOXES_PER_SLAB = 64;
+	static constexpr UINT MAX_SLABS = 4096;
+
+	// Insertion sort gives up & sorts from scratch past this many swaps per body, such as after a teleport of many bodies.
+	static constexpr size_t MAX_SORT_SWAPS_PER_BODY = 8;
+
+	struct Body
+	{
+		Entity *entity = nullptr;
+		DirectX::BoundingBox bounds;
+		bool isActive = false;
+		bool isSorted = false; // Whether the body has a sweep box.
+	};
+
+	// Bounds stored as min & max per axis, packed so the sweep walks them in order through memory.
+	struct SweepBox
+	{
+		float minX = 0.0f, maxX = 0.0f;
+		float minY = 0.0f, maxY = 0.0f;
+		float minZ = 0.0f, maxZ = 0.0f;
+		UINT id = 0;
+	};
+
+	std::vector<Body> _bodies; // Indexed by body ID, which SceneHolder keeps dense by using entity slots.
+	std::vector<SweepBox> _sweepBoxes; // Sorted by minX.
+	std::vector<UINT> _addedBodies;
+
+	// Boxes of each slab in x order, each slab sweeping its pairs into its own list.
+	std::vector<SweepBox> _slabBoxes;
+	std::vector<UINT> _slabOffsets, _slabFill;
+	std::vector<std::vector<std::uint64_t>> _slabPairs;
+	UINT _slabCount = 0;
+	float _slabMin = 0.0f, _invSlabSize = 0.0f;
+	bool _slabAxisY = false;
+	std::vector<std::uint64_t> _pairKeys, _previousPairKeys, _changedPairKeys;
+
+	std::vector<CollisionPair> _pairs, _beganPairs, _endedPairs;
+
+
+	[[nodiscard]] static SweepBox GetSweepBox(const UINT id, const DirectX::BoundingBox &bounds)
+	{
+		return {
+			bounds.Center.x - bounds.Extents.x, bounds.Center.x + bounds.Extents.x,
+			bounds.Center.y - bounds.Extents.y, bounds.Center.y + bounds.Extents.y,
+			bounds.Center.z - bounds.Extents.z, bounds.Center.z + bounds.Extents.z,
+			id
+		};
+	}
+
+	[[nodiscard]] static std::uint64_t GetPairKey(const UINT firstID, const UINT secondID)
+	{
+		return (firstID < secondID)
+			? (static_cast<std::uint64_t>(firstID) << 32) | secondID
+			: (static_cast<std::uint64_t>(secondID) << 32) | firstID;
+	}
+
+	[[nodiscard]] CollisionPair GetPair(const std::uint64_t key) const
+	{
+		return { _bodies[static_cast<UINT>(key >> 32)].entity, _bodies[static_cast<UINT>(key & 0xffffffff)].entity };
+	}
+
+	[[nodiscard]] float GetSlabMin(const SweepBox &box) const
+	{
+		return _slabAxisY ? box.minY : box.minZ;
+	}
+
+	[[nodiscard]] float GetSlabMax(const SweepBox &box) const
+	{
+		return _slabAxisY ? box.maxY : box.maxZ;
+	}
+
+	[[nodiscard]] UINT GetSlab(const float value) const
+	{
+		const float slab = (value - _slabMin) * _invSlabSize;
+		return static_cast<UINT>(std::clamp(slab, 0.0f, static_cast<float>(_slabCount - 1)));
+	}
+
+	// Refreshes the sweep boxes of existing bodies, dropping removed ones, & restores their order.
+	void SortSweepBoxes()
+	{
+		std::erase_if(_sweepBoxes, [this](SweepBox &box)
+		{
+			Body &body = _bodies[box.id];
+			if (!body.isActive)
+			{
+				body.isSorted = false;
+				return true;
+			}
+
+			box = GetSweepBox(box.id, body.bounds);
+			return false;
+		});
+
+		const size_t boxCount = _sweepBoxes.size();
+		const size_t maxSwaps = boxCount * MAX_SORT_SWAPS_PER_BODY;
+		size_t swaps = 0;
+
+		for (size_t i = 1; i < boxCount; i++)
+		{
+			const SweepBox box = _sweepBoxes[i];
+
+			size_t j = i;
+			while (j > 0 && _sweepBoxes[j - 1].minX > box.minX)
+			{
+				_sweepBoxes[j] = _sweepBoxes[j - 1];
+				j--;
+			}
+			_sweepBoxes[j] = box;
+
+			swaps += i - j;
+			if (swaps > maxSwaps)
+			{
+				std::sort(_sweepBoxes.begin(), _sweepBoxes.end(), [](const SweepBox &a, const SweepBox &b) { return a.minX < b.minX; });
+				break;
+			}
+		}
+
+		// New bodies are sorted on their own & merged in, keeping level loads from degrading the insertion sort.
+		const size_t firstAdded = boxCount;
+		for (const UINT id : _addedBodies)
+		{
+			Body &body = _bodies[id];
+			if (!body.isActive || body.isSorted)
+				continue;
+
+			body.isSorted = true;
+			_sweepBoxes.push_back(GetSweepBox(id, body.bounds));
+		}
+		_addedBodies.clear();
+
+		auto byMinX = [](const SweepBox &a, const SweepBox &b) { return a.minX < b.minX; };
+		std::sort(_sweepBoxes.begin() + firstAdded, _sweepBoxes.end(), byMinX);
+		std::inplace_merge(_sweepBoxes.begin(), _sweepBoxes.begin() + firstAdded, _sweepBoxes.end(), byMinX);
+	}
+
+	// Splits the boxes into slabs along whichever of y & z they spread out the most over, keeping the x order in each slab.
+	// A pair is only tested in the slab where its overlap along the slab axis starts, so each pair is found once.
+	void BuildSlabs()
+	{
+		const UINT boxCount = static_cast<UINT>(_sweepBoxes.size());
+		if (boxCount == 0)
+		{
+			_slabCount = 0;
+			return;
+		}
+
+		float minY = FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX, maxZ = -FLT_MAX, sizeY = 0.0f, sizeZ = 0.0f;
+		for (const SweepBox &box : _sweepBoxes)
+		{
+			minY = (std::min)(minY, box.minY);
+			maxY = (std::max)(maxY, box.maxY);
+			minZ = (std::min)(minZ, box.minZ);
+			maxZ = (std::max)(maxZ, box.maxZ);
+			sizeY += box.maxY - box.minY;
+			sizeZ += box.maxZ - box.minZ;
+		}
+
+		// Range of the slab axis measured in average box sizes.
+		const float
+			spreadY = (maxY - minY) * static_cast<float>(boxCount) / (std::max)(sizeY, FLT_MIN),
+			spreadZ = (maxZ - minZ) * static_cast<float>(boxCount) / (std::max)(sizeZ, FLT_MIN);
+
+		_slabAxisY = spreadY > spreadZ;
+		_slabMin = _slabAxisY ? minY : minZ;
+
+		const float spread = (std::min)((std::max)(spreadY, spreadZ) / SLAB_SIZE_IN_BOXES, static_cast<float>(MAX_SLABS));
+		_slabCount = std::clamp(static_cast<UINT>(spread), 1u, (std::max)(boxCount / MIN_BOXES_PER_SLAB, 1u));
+		_invSlabSize = static_cast<float>(_slabCount) / (std::max)(_slabAxisY ? maxY - minY : maxZ - minZ, FLT_MIN);
+
+		// Counting sort of the boxes into every slab they span, walking them in x order to keep each slab sorted.
+		_slabOffsets.assign(_slabCount + 1, 0);
+		for (const SweepBox &box : _sweepBoxes)
+		{
+			for (UINT slab = GetSlab(GetSlabMin(box)); slab <= GetSlab(GetSlabMax(box)); slab++)
+				_slabOffsets[slab + 1]++;
+		}
+
+		for (UINT slab = 0; slab < _slabCount; slab++)
+			_slabOffsets[slab + 1] += _slabOffsets[slab];
+
+		_slabBoxes.resize(_slabOffsets[_slabCount]);
+		_slabFill.assign(_slabOffsets.begin(), _slabOffsets.end() - 1);
+		for (const SweepBox &box : _sweepBoxes)
+		{
+			for (UINT slab = GetSlab(GetSlabMin(box)); slab <= GetSlab(GetSlabMax(box)); slab++)
+				_slabBoxes[_slabFill[slab]++] = box;
+		}
+	}
+
+	// Tests every box against the following boxes of its slab that start before it ends along x.
+	void SweepPairs()
+	{
+		BuildSlabs();
+
+		if (_slabPairs.size() < _slabCount)
+			_slabPairs.resize(_slabCount);
+
+#pragma omp parallel for schedule(dynamic)
+		for (int slab = 0; slab < static_cast<int>(_slabCount); slab++)
+		{
+			std::vector<std::uint64_t> &pairs = _slabPairs[slab];
+			pairs.clear();
+
+			const SweepBox *boxes = _slabBoxes.data();
+			const UINT slabEnd = _slabOffsets[slab + 1];
+
+			for (UINT i = _slabOffsets[slab]; i < slabEnd; i++)
+			{
+				const SweepBox &box = boxes[i];
+
+				for (UINT j = i + 1; j < slabEnd && boxes[j].minX <= box.maxX; j++)
+				{
+					const SweepBox &other = boxes[j];
+					if (box.minY > other.maxY || other.minY > box.maxY || box.minZ > other.maxZ || other.minZ > box.maxZ)
+						continue;
+
+					if (GetSlab((std::max)(GetSlabMin(box), GetSlabMin(other))) == static_cast<UINT>(slab))
+						pairs.push_back(GetPairKey(box.id, other.id));
+				}
+			}
+		}
+
+		_pairKeys.clear();
+		for (UINT slab = 0; slab < _slabCount; slab++)
+			_pairKeys.insert(_pairKeys.end(), _slabPairs[slab].begin(), _slabPairs[slab].end());
+
+		std::sort(_pairKeys.begin(), _pairKeys.end());
+	}
+
+
+public:
+	Broadphase() = default;
+	~Broadphase() = default;
+	Broadphase(const Broadphase &other) = delete;
+	Broadphase &operator=(const Broadphase &other) = delete;
+	Broadphase(Broadphase &&other) = delete;
+	Broadphase &operator=(Broadphase &&other) = delete;
+
+	// Adds a body for the entity with the given ID, or updates its bounds if it already has one.
+	void SetBody(const UINT id, Entity *entity, const DirectX::BoundingBox &bounds)
+	{
+		if (id >= _bodies.size())
+			_bodies.resize(id + 1);
+
+		Body &body = _bodies[id];
+		if (!body.isActive && !body.isSorted)
+			_addedBodies.push_back(id);
+
+		body.entity = entity;
+		body.bounds = bounds;
+		body.isActive = true;
+	}
+
+	// Pairs with a removed body end without being reported, as its entity may no longer exist.
+	void RemoveBody(const UINT id)
+	{
+		if (id < _bodies.size())
+			_bodies[id].isActive = false;
+	}
+
+	void Clear()
+	{
+		_bodies.clear();
+		_sweepBoxes.clear();
+		_addedBodies.clear();
+		_pairKeys.clear();
+		_previousPairKeys.clear();
+		_pairs.clear();
+		_beganPairs.clear();
+		_endedPairs.clear();
+	}
+
+	// Finds the overlapping pairs of the current bounds & compares them with those of the previous update.
+	void Update()
+	{
+		SortSweepBoxes();
+		SweepPairs();
+
+		_pairs.clear();
+		for (const std::uint64_t key : _pairKeys)
+			_pairs.push_back(GetPair(key));
+
+		_changedPairKeys.clear();
+		std::set_difference(_pairKeys.begin(), _pairKeys.end(), _previousPairKeys.begin(), _previousPairKeys.end(), std::back_inserter(_changedPairKeys));
+
+		_beganPairs.clear();
+		for (const std::uint64_t key : _changedPairKeys)
+			_beganPairs.push_back(GetPair(key));
+
+		_changedPairKeys.clear();
+		std::set_difference(_previousPairKeys.begin(), _previousPairKeys.end(), _pairKeys.begin(), _pairKeys.end(), std::back_inserter(_changedPairKeys));
+
+		_endedPairs.clear();
+		for (const std::uint64_t key : _changedPairKeys)
+		{
+			if (_bodies[static_cast<UINT>(key >> 32)].isActive && _bodies[static_cast<UINT>(key & 0xffffffff)].isActive)
+				_endedPairs.push_back(GetPair(key));
+		}
+
+		std::swap(_pairKeys, _previousPairKeys);
+	}
+
+	// Every overlapping pair as of the last update, sorted by body ID.
+	[[nodiscard]] const std::vector<CollisionPair> &GetPairs() const
+	{
+		return _pairs;
+	}
+
+	// Pairs that started overlapping during the last update.
+	[[nodiscard]] const std::vector<CollisionPair> &GetBeganPairs() const
+	{
+		return _beganPairs;
+	}
+
+	// Pairs that stopped overlapping during the last update.
+	[[nodiscard]] const std::vector<CollisionPair> &GetEndedPairs() const
+	{
+		return _endedPairs;
+	}
+};
@@ -0,0 +1,879 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <utility>
+#include <vector>
+#include <DirectXCollision.h>
+
+#include "VolumeTree.h"
+#include "Raycast.h"
+
+
+// Bounding volume hierarchy built with binned SAH over entity bounds, stored as a single node array.
+// Moved entities are refit in place. Update() rebuilds the hierarchy once refitting has degraded it too far,
+// or once too many entities are waiting in the linearly tested pending list.
+class Bvh final : public VolumeTree
+{
+private:
+	static constexpr UINT MAX_ITEMS_IN_LEAF = 4;
+	static constexpr UINT MAX_ITEMS_IN_FALLBACK_LEAF = 16;
+	static constexpr UINT MAX_DEPTH = 48;
+	static constexpr UINT MAX_STACK_SIZE = MAX_DEPTH + 2;
+	static constexpr UINT BIN_COUNT = 16;
+	static constexpr UINT MIN_PENDING_FOR_REBUILD = 64;
+	static constexpr float TRAVERSAL_COST = 1.0f;
+	static constexpr float REBUILD_COST_RATIO = 1.5f;
+
+	struct Aabb
+	{
+		DirectX::XMFLOAT3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+		DirectX::XMFLOAT3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void Grow(const DirectX::XMFLOAT3 &point)
+		{
+			min = { (std::min)(min.x, point.x), (std::min)(min.y, point.y), (std::min)(min.z, point.z) };
+			max = { (std::max)(max.x, point.x), (std::max)(max.y, point.y), (std::max)(max.z, point.z) };
+		}
+
+		void Grow(const Aabb &other)
+		{
+			if (!other.IsValid())
+				return;
+
+			Grow(other.min);
+			Grow(other.max);
+		}
+
+		void Grow(const DirectX::BoundingBox &box)
+		{
+			Grow(DirectX::XMFLOAT3(box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z));
+			Grow(DirectX::XMFLOAT3(box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z));
+		}
+
+		[[nodiscard]] bool IsValid() const
+		{
+			return min.x <= max.x;
+		}
+
+		[[nodiscard]] float SurfaceArea() const
+		{
+			if (!IsValid())
+				return 0.0f;
+
+			const DirectX::XMFLOAT3 size = { max.x - min.x, max.y - min.y, max.z - min.z };
+			return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+		}
+
+		[[nodiscard]] DirectX::BoundingBox ToBoundingBox() const
+		{
+			if (!IsValid())
+				return DirectX::BoundingBox({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f });
+
+			return DirectX::BoundingBox(
+				{ (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f },
+				{ (max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f }
+			);
+		}
+	};
+
+	struct Node
+	{
+		Aabb aabb;
+		DirectX::BoundingBox bounds;
+		UINT parent = 0;
+		UINT firstChild = 0; // Zero for leaves, as the root is never a child.
+		UINT itemStart = 0;
+		UINT itemCount = 0;
+		bool isDirty = false;
+	};
+
+	struct Item
+	{
+		Entity *entity = nullptr;
+		DirectX::BoundingBox bounds;
+		UINT leaf = 0;
+		bool isBuilt = false; // False while the item is only found through the pending list.
+		bool isPending = false;
+	};
+
+	std::vector<Node> _nodes;
+	std::vector<UINT> _leafItems;
+	std::vector<Item> _items;
+	std::vector<UINT> _pendingItems;
+	std::vector<UINT> _dirtyLeaves;
+	DirectX::BoundingBox _sceneBounds;
+	UINT _staleReferences = 0;
+	float _builtCost = 0.0f;
+
+
+	[[nodiscard]] static float GetAxis(const DirectX::XMFLOAT3 &vec, const UINT axis)
+	{
+		return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+	}
+
+	[[nodiscard]] float GetNodeCost(const Node &node) const
+	{
+		return node.firstChild == 0
+			? node.aabb.SurfaceArea() * static_cast<float>(node.itemCount)
+			: node.aabb.SurfaceArea() * TRAVERSAL_COST;
+	}
+
+	// SAH cost of the whole hierarchy, relative to the surface area of the root.
+	[[nodiscard]] float GetTreeCost() const
+	{
+		const float rootArea = _nodes[0].aabb.SurfaceArea();
+		if (rootArea <= 0.0f)
+			return 0.0f;
+
+		float cost = 0.0f;
+		for (const Node &node : _nodes)
+			cost += GetNodeCost(node);
+
+		return cost / rootArea;
+	}
+
+
+	void Build()
+	{
+		_nodes.clear();
+		_leafItems.clear();
+		_pendingItems.clear();
+		_dirtyLeaves.clear();
+		_staleReferences = 0;
+
+		for (UINT slot = 0; slot < _items.size(); slot++)
+		{
+			Item &item = _items[slot];
+			item.isPending = false;
+			item.isBuilt = (item.entity != nullptr);
+
+			if (item.isBuilt)
+				_leafItems.push_back(slot);
+		}
+
+		// Centroids are computed once up front, as binning reads them repeatedly.
+		std::vector<DirectX::XMFLOAT3> centroids(_items.size());
+		for (const UINT slot : _leafItems)
+			centroids[slot] = _items[slot].bounds.Center;
+
+		_nodes.emplace_back();
+
+		struct BuildTask { UINT node, start, end, depth; };
+		std::vector<BuildTask> tasks = { { 0, 0, static_cast<UINT>(_leafItems.size()), 0 } };
+
+		while (!tasks.empty())
+		{
+			const BuildTask task = tasks.back();
+			tasks.pop_back();
+
+			const UINT count = task.end - task.start;
+
+			Aabb nodeAabb, centroidAabb;
+			for (UINT i = task.start; i < task.end; i++)
+			{
+				nodeAabb.Grow(_items[_leafItems[i]].bounds);
+				centroidAabb.Grow(centroids[_leafItems[i]]);
+			}
+
+			_nodes[task.node].aabb = nodeAabb;
+
+			auto makeLeaf = [&]()
+			{
+				Node &node = _nodes[task.node];
+				node.itemStart = task.start;
+				node.itemCount = count;
+
+				for (UINT i = task.start; i < task.end; i++)
+					_items[_leafItems[i]].leaf = task.node;
+			};
+
+			if (count <= MAX_ITEMS_IN_LEAF || task.depth >= MAX_DEPTH)
+			{
+				makeLeaf();
+				continue;
+			}
+
+			// Find the cheapest binned split over all three axes.
+			struct Bin { Aabb aabb; UINT count = 0; };
+
+			float bestCost = FLT_MAX;
+			UINT bestAxis = 0, bestSplit = 0;
+
+			for (UINT axis = 0; axis < 3; axis++)
+			{
+				const float
+					axisMin = GetAxis(centroidAabb.min, axis),
+					axisMax = GetAxis(centroidAabb.max, axis);
+
+				if (axisMax <= axisMin)
+					continue;
+
+				const float binScale = static_cast<float>(BIN_COUNT) / (axisMax - axisMin);
+
+				Bin bins[BIN_COUNT];
+				for (UINT i = task.start; i < task.end; i++)
+				{
+					const UINT slot = _leafItems[i];
+					const UINT binIndex = (std::min)(BIN_COUNT - 1, static_cast<UINT>((GetAxis(centroids[slot], axis) - axisMin) * binScale));
+
+					bins[binIndex].aabb.Grow(_items[slot].bounds);
+					bins[binIndex].count++;
+				}
+
+				float rightAreas[BIN_COUNT];
+				UINT rightCounts[BIN_COUNT];
+				Aabb rightAabb;
+				UINT rightCount = 0;
+
+				for (UINT i = BIN_COUNT - 1; i > 0; i--)
+				{
+					rightAabb.Grow(bins[i].aabb);
+					rightCount += bins[i].count;
+					rightAreas[i] = rightAabb.SurfaceArea();
+					rightCounts[i] = rightCount;
+				}
+
+				Aabb leftAabb;
+				UINT leftCount = 0;
+
+				for (UINT split = 1; split < BIN_COUNT; split++)
+				{
+					leftAabb.Grow(bins[split - 1].aabb);
+					leftCount += bins[split - 1].count;
+
+					if (leftCount == 0 || rightCounts[split] == 0)
+						continue;
+
+					const float cost = leftAabb.SurfaceArea() * static_cast<float>(leftCount) + rightAreas[split] * static_cast<float>(rightCounts[split]);
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = split;
+					}
+				}
+			}
+
+			const float
+				nodeArea = nodeAabb.SurfaceArea(),
+				leafCost = static_cast<float>(count),
+				splitCost = nodeArea > 0.0f ? TRAVERSAL_COST + bestCost / nodeArea : FLT_MAX;
+
+			const bool isSahSplit = bestCost < FLT_MAX && splitCost < leafCost;
+			if (!isSahSplit && count <= MAX_ITEMS_IN_FALLBACK_LEAF)
+			{
+				makeLeaf();
+				continue;
+			}
+
+			UINT mid = task.start;
+			if (isSahSplit)
+			{
+				const float
+					axisMin = GetAxis(centroidAabb.min, bestAxis),
+					binScale = static_cast<float>(BIN_COUNT) / (GetAxis(centroidAabb.max, bestAxis) - axisMin);
+
+				const auto midIt = std::partition(_leafItems.begin() + task.start, _leafItems.begin() + task.end, [&](const UINT slot)
+				{
+					const UINT binIndex = (std::min)(BIN_COUNT - 1, static_cast<UINT>((GetAxis(centroids[slot], bestAxis) - axisMin) * binScale));
+					return binIndex < bestSplit;
+				});
+
+				mid = static_cast<UINT>(midIt - _leafItems.begin());
+			}
+
+			if (mid == task.start || mid == task.end)
+			{ // No useful split was found, fall back to a median split along the widest centroid axis.
+				const DirectX::XMFLOAT3 size = {
+					centroidAabb.max.x - centroidAabb.min.x,
+					centroidAabb.max.y - centroidAabb.min.y,
+					centroidAabb.max.z - centroidAabb.min.z
+				};
+				const UINT axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+
+				mid = task.start + count / 2;
+				std::nth_element(_leafItems.begin() + task.start, _leafItems.begin() + mid, _leafItems.begin() + task.end, [&](const UINT a, const UINT b)
+				{
+					return GetAxis(centroids[a], axis) < GetAxis(centroids[b], axis);
+				});
+			}
+
+			const UINT firstChild = static_cast<UINT>(_nodes.size());
+			_nodes[task.node].firstChild = firstChild;
+
+			_nodes.emplace_back().parent = task.node;
+			_nodes.emplace_back().parent = task.node;
+
+			tasks.push_back({ firstChild, task.start, mid, task.depth + 1 });
+			tasks.push_back({ firstChild + 1, mid, task.end, task.depth + 1 });
+		}
+
+		for (Node &node : _nodes)
+			node.bounds = node.aabb.ToBoundingBox();
+
+		_builtCost = GetTreeCost();
+	}
+
+	// Recomputes the bounds of dirty leaves & their ancestors, stopping where nothing changed.
+	void Refit()
+	{
+		for (const UINT leafIndex : _dirtyLeaves)
+		{
+			Node &leaf = _nodes[leafIndex];
+			leaf.isDirty = false;
+
+			Aabb aabb;
+			for (UINT i = leaf.itemStart; i < leaf.itemStart + leaf.itemCount; i++)
+			{
+				const Item &item = _items[_leafItems[i]];
+				if (item.isBuilt)
+					aabb.Grow(item.bounds);
+			}
+
+			leaf.aabb = aabb;
+			leaf.bounds = aabb.ToBoundingBox();
+
+			for (UINT nodeIndex = leafIndex; nodeIndex != 0;)
+			{
+				nodeIndex = _nodes[nodeIndex].parent;
+				Node &node = _nodes[nodeIndex];
+
+				Aabb parentAabb = _nodes[node.firstChild].aabb;
+				parentAabb.Grow(_nodes[node.firstChild + 1].aabb);
+
+				if (parentAabb.min.x == node.aabb.min.x && parentAabb.min.y == node.aabb.min.y && parentAabb.min.z == node.aabb.min.z &&
+					parentAabb.max.x == node.aabb.max.x && parentAabb.max.y == node.aabb.max.y && parentAabb.max.z == node.aabb.max.z)
+					break;
+
+				node.aabb = parentAabb;
+				node.bounds = parentAabb.ToBoundingBox();
+			}
+		}
+
+		_dirtyLeaves.clear();
+	}
+
+	// Grows the ancestors of a leaf so they keep containing a moved item until the next refit.
+	void GrowAncestors(UINT nodeIndex, const DirectX::BoundingBox &itemBounds)
+	{
+		while (true)
+		{
+			Node &node = _nodes[nodeIndex];
+
+			Aabb grown = node.aabb;
+			grown.Grow(itemBounds);
+
+			node.aabb = grown;
+			node.bounds = grown.ToBoundingBox();
+
+			if (nodeIndex == 0)
+				break;
+
+			nodeIndex = node.parent;
+		}
+	}
+
+	void MoveBuiltItem(const UINT slot, const DirectX::BoundingBox &bounds)
+	{
+		Item &item = _items[slot];
+		item.bounds = bounds;
+
+		// Keep queries correct until the next Update() refits the hierarchy tightly.
+		GrowAncestors(item.leaf, bounds);
+		MarkLeafDirty(item.leaf);
+	}
+
+	void MarkLeafDirty(const UINT leafIndex)
+	{
+		Node &leaf = _nodes[leafIndex];
+		if (leaf.isDirty)
+			return;
+
+		leaf.isDirty = true;
+		_dirtyLeaves.push_back(leafIndex);
+	}
+
+
+	void AddItem(const UINT slot, std::vector<Entity *> &containingItems) const
+	{
+		containingItems.push_back(_items[slot].entity);
+	}
+
+	template <typename Shape>
+	void Cull(const Shape &shape, std::vector<Entity *> &containingItems) const
+	{
+		struct StackEntry { UINT node; bool isContained; };
+		StackEntry stack[MAX_STACK_SIZE];
+		UINT stackSize = 0;
+
+		if (_nodes[0].aabb.IsValid())
+			stack[stackSize++] = { 0, false };
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			const Node &node = _nodes[entry.node];
+
+			VOLUME_TREE_STAT(nodesVisited);
+
+			bool isContained = entry.isContained;
+			if (!isContained)
+			{
+				VOLUME_TREE_STAT(intersectionTests);
+
+				const DirectX::ContainmentType containment = shape.Contains(node.bounds);
+				if (containment == DirectX::DISJOINT)
+					continue;
+
+				isContained = (containment == DirectX::CONTAINS);
+			}
+
+			if (node.firstChild != 0)
+			{
+				stack[stackSize++] = { node.firstChild, isContained };
+				stack[stackSize++] = { node.firstChild + 1, isContained };
+				continue;
+			}
+
+			for (UINT i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+			{
+				const UINT slot = _leafItems[i];
+				const Item &item = _items[slot];
+				if (!item.isBuilt)
+					continue;
+
+				if (!isContained)
+				{
+					VOLUME_TREE_STAT(intersectionTests);
+
+					if (!shape.Intersects(item.bounds))
+						continue;
+				}
+
+				AddItem(slot, containingItems);
+			}
+		}
+
+		for (const UINT slot : _pendingItems)
+		{
+			VOLUME_TREE_STAT(intersectionTests);
+
+			if (shape.Intersects(_items[slot].bounds))
+				AddItem(slot, containingItems);
+		}
+	}
+
+
+public:
+	Bvh() = default;
+	~Bvh() override = default;
+	Bvh(const Bvh &other) = delete;
+	Bvh &operator=(const Bvh &other) = delete;
+	Bvh(Bvh &&other) = delete;
+	Bvh &operator=(Bvh &&other) = delete;
+
+	[[nodiscard]] VolumeTreeType GetType() const override
+	{
+		return VolumeTreeType::BVH;
+	}
+
+	[[nodiscard]] bool Initialize(const DirectX::BoundingBox &sceneBounds) override
+	{
+		ClearSlots();
+		_items.clear();
+		_sceneBounds = sceneBounds;
+
+		Build();
+		return true;
+	}
+
+	[[nodiscard]] bool IsBounded() const override
+	{
+		return false; // Node bounds are fit to the items, the scene bounds are only reported.
+	}
+
+	[[nodiscard]] bool Update() override
+	{
+		if (_nodes.empty())
+			return false;
+
+		const bool isRefit = !_dirtyLeaves.empty();
+		Refit();
+
+		const size_t rebuildThreshold = (std::max)(static_cast<size_t>(MIN_PENDING_FOR_REBUILD), _leafItems.size() / 8);
+		if (_pendingItems.size() + _staleReferences >= rebuildThreshold || (isRefit && GetTreeCost() > _builtCost * REBUILD_COST_RATIO))
+			Build();
+
+		return true;
+	}
+
+	void Insert(Entity *data, const DirectX::BoundingBox &bounds) override
+	{
+		if (_nodes.empty())
+			return;
+
+		const UINT slot = AcquireSlot(data);
+		if (slot >= _items.size())
+			_items.resize(slot + 1);
+
+		Item &item = _items[slot];
+		if (item.isBuilt)
+		{
+			MoveBuiltItem(slot, bounds);
+			return;
+		}
+
+		item.entity = data;
+		item.bounds = bounds;
+
+		if (!item.isPending)
+		{
+			item.isPending = true;
+			_pendingItems.push_back(slot);
+		}
+	}
+
+
+	[[nodiscard]] bool Remove(Entity *data, const DirectX::BoundingBox &) override
+	{
+		return Remove(data);
+	}
+
+	[[nodiscard]] bool Remove(Entity *data) override
+	{
+		if (_nodes.empty())
+			return false;
+
+		const auto it = _itemSlots.find(data);
+		if (it == _itemSlots.end())
+			return true;
+
+		const UINT slot = it->second;
+		Item &item = _items[slot];
+
+		if (item.isBuilt)
+		{
+			_staleReferences++;
+			MarkLeafDirty(item.leaf);
+		}
+
+		if (item.isPending)
+			std::erase(_pendingItems, slot);
+
+		item = { };
+		ReleaseSlot(data);
+		return true;
+	}
+
+	[[nodiscard]] bool Move(Entity *data, const DirectX::BoundingBox &bounds) override
+	{
+		if (_nodes.empty())
+			return false;
+
+		const auto it = _itemSlots.find(data);
+		if (it == _itemSlots.end() || !_items[it->second].isBuilt)
+		{
+			Insert(data, bounds);
+			return true;
+		}
+
+		MoveBuiltItem(it->second, bounds);
+		return true;
+	}
+
+
+	[[nodiscard]] bool FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const override
+	{
+		if (_nodes.empty())
+			return false;
+
+		Cull(frustum, containingItems);
+		return true;
+	}
+
+	[[nodiscard]] bool BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const override
+	{
+		if (_nodes.empty())
+			return false;
+
+		Cull(box, containingItems);
+		return true;
+	}
+
+	[[nodiscard]] bool MultiViewCull(const MultiViewQuery &query) const override
+	{
+		if (_nodes.empty())
+			return false;
+
+		const MultiViewState rootState = query.Begin(_slotCount);
+
+		struct StackEntry { UINT node; MultiViewState state; };
+		StackEntry stack[MAX_STACK_SIZE];
+		UINT stackSize = 0;
+
+		if (_nodes[0].aabb.IsValid() && query.ClassifyNode(rootState, _nodes[0].bounds, stack[0].state))
+			stack[stackSize++].node = 0;
+
+		while (stackSize > 0)
+		{
+			const StackEntry &entry = stack[--stackSize];
+			const Node &node = _nodes[entry.node];
+
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (node.firstChild == 0)
+			{
+				for (UINT i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+				{
+					const UINT slot = _leafItems[i];
+					const Item &item = _items[slot];
+					if (item.isBuilt)
+						query.AddItem(entry.state, item.entity, item.bounds, slot);
+				}
+				continue;
+			}
+
+			// Children overwrite the popped entry, so the parent state is copied out first.
+			const MultiViewState parentState = entry.state;
+			const UINT firstChild = node.firstChild;
+
+			for (UINT i = 0; i < 2; i++)
+			{
+				if (query.ClassifyNode(parentState, _nodes[firstChild + i].bounds, stack[stackSize].state))
+					stack[stackSize++].node = firstChild + i;
+			}
+		}
+
+		for (const UINT slot : _pendingItems)
+			query.AddItem(rootState, _items[slot].entity, _items[slot].bounds, slot);
+
+		return true;
+	}
+
+
+	[[nodiscard]] bool NearestCull(NearestQuery &query) const override
+	{
+		if (_nodes.empty())
+			return false;
+
+		query.Begin(_slotCount);
+
+		for (const UINT slot : _pendingItems)
+			query.AddItem(_items[slot].entity, _items[slot].bounds, slot);
+
+		struct StackEntry { UINT node; float distanceSq; };
+		StackEntry stack[MAX_STACK_SIZE];
+		UINT stackSize = 0;
+
+		float rootDistanceSq = 0.0f;
+		if (_nodes[0].aabb.IsValid() && query.ClassifyNode(_nodes[0].bounds, rootDistanceSq))
+			stack[stackSize++] = { 0, rootDistanceSq };
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			if (entry.distanceSq > query.GetMaxDistanceSq())
+				continue;
+
+			const Node &node = _nodes[entry.node];
+
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (node.firstChild == 0)
+			{
+				for (UINT i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+				{
+					const UINT slot = _leafItems[i];
+					if (_items[slot].isBuilt)
+						query.AddItem(_items[slot].entity, _items[slot].bounds, slot);
+				}
+				continue;
+			}
+
+			StackEntry first = { node.firstChild, 0.0f }, second = { node.firstChild + 1, 0.0f };
+			const bool
+				nearFirst = _nodes[first.node].aabb.IsValid() && query.ClassifyNode(_nodes[first.node].bounds, first.distanceSq),
+				nearSecond = _nodes[second.node].aabb.IsValid() && query.ClassifyNode(_nodes[second.node].bounds, second.distanceSq);
+
+			if (nearFirst && nearSecond)
+			{
+				if (second.distanceSq > first.distanceSq)
+					std::swap(first, second);
+
+				// Push the furthest child first so the nearest is visited first.
+				stack[stackSize++] = first;
+				stack[stackSize++] = second;
+			}
+			else if (nearFirst)
+				stack[stackSize++] = first;
+			else if (nearSecond)
+				stack[stackSize++] = second;
+		}
+
+		return true;
+	}
+
+	bool RaycastTree(const DirectX::XMFLOAT3A &orig, const DirectX::XMFLOAT3A &dir, float &length, Entity *&entity, RaycastItemTest *itemTest) const override
+	{
+		if (_nodes.empty())
+			return false;
+
+		entity = nullptr;
+
+		auto testItem = [&](const UINT slot)
+		{
+			RaycastItem(orig, dir, _items[slot].entity, _items[slot].bounds, itemTest, length, entity);
+		};
+
+		// Returns the distance at which the ray enters the node, or zero if it starts inside.
+		auto raycastNode = [&](const Node &node, float &nodeLength)
+		{
+			VOLUME_TREE_STAT(intersectionTests);
+
+			if (!node.aabb.IsValid())
+				return false;
+
+			if (node.bounds.Contains(DirectX::XMLoadFloat3(&orig)) != DirectX::DISJOINT)
+			{
+				nodeLength = 0.0f;
+				return true;
+			}
+
+			return Raycast(orig, dir, node.bounds, nodeLength);
+		};
+
+		for (const UINT slot : _pendingItems)
+			testItem(slot);
+
+		struct StackEntry { UINT node; float length; };
+		StackEntry stack[MAX_STACK_SIZE];
+		UINT stackSize = 0;
+
+		float rootLength = 0.0f;
+		if (raycastNode(_nodes[0], rootLength))
+			stack[stackSize++] = { 0, rootLength };
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			if (entry.length >= length)
+				continue;
+
+			const Node &node = _nodes[entry.node];
+
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (node.firstChild == 0)
+			{ // Check all items in leaf for intersection.
+				for (UINT i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+				{
+					if (_items[_leafItems[i]].isBuilt)
+						testItem(_leafItems[i]);
+				}
+				continue;
+			}
+
+			StackEntry first = { node.firstChild, 0.0f }, second = { node.firstChild + 1, 0.0f };
+			const bool
+				hitFirst = raycastNode(_nodes[first.node], first.length) && first.length < length,
+				hitSecond = raycastNode(_nodes[second.node], second.length) && second.length < length;
+
+			if (hitFirst && hitSecond)
+			{
+				if (second.length > first.length)
+					std::swap(first, second);
+
+				// Push the furthest child first so the closest is visited first.
+				stack[stackSize++] = first;
+				stack[stackSize++] = second;
+			}
+			else if (hitFirst)
+				stack[stackSize++] = first;
+			else if (hitSecond)
+				stack[stackSize++] = second;
+		}
+
+		return (entity != nullptr);
+	}
+
+	// Nodes are tested against every ray of the packet at once, and a subtree is skipped once none of its rays hit it.
+	// Each node keeps the rays that hit its parent, so rays that miss a subtree are never tested in it again.
+	void RaycastPacket(RayPacket &packet, RaycastItemTest *itemTest) const override
+	{
+		if (_nodes.empty())
+			return;
+
+		for (const UINT slot : _pendingItems)
+			RaycastPacketItem(packet, packet.activeRays, _items[slot].entity, _items[slot].bounds, itemTest);
+
+		struct StackEntry { UINT node; UINT rayMask; };
+		StackEntry stack[MAX_STACK_SIZE];
+		UINT stackSize = 0;
+
+		stack[stackSize++] = { 0, packet.activeRays };
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			const Node &node = _nodes[entry.node];
+
+			if (!node.aabb.IsValid())
+				continue;
+
+			// Tested when popped rather than pushed, so rays shortened by hits in the meantime are pruned.
+			VOLUME_TREE_STAT(intersectionTests);
+			const UINT rayMask = RaycastBoxPacket(packet, entry.rayMask & packet.activeRays, node.bounds);
+			if (rayMask == 0)
+				continue;
+
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (node.firstChild == 0)
+			{ // Check all items in leaf for intersection.
+				for (UINT i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+				{
+					const Item &item = _items[_leafItems[i]];
+					if (item.isBuilt)
+						RaycastPacketItem(packet, rayMask, item.entity, item.bounds, itemTest);
+				}
+				continue;
+			}
+
+			// Order the children along the direction of the first ray, which coherent packets share.
+			const DirectX::XMFLOAT3
+				&dir = packet.direction[std::countr_zero(rayMask)],
+				&firstCenter = _nodes[node.firstChild].bounds.Center,
+				&secondCenter = _nodes[node.firstChild + 1].bounds.Center;
+
+			const float secondAhead =
+				(secondCenter.x - firstCenter.x) * dir.x +
+				(secondCenter.y - firstCenter.y) * dir.y +
+				(secondCenter.z - firstCenter.z) * dir.z;
+
+			// Push the furthest child first so the closest is visited first.
+			const UINT nearChild = (secondAhead >= 0.0f) ? 0 : 1;
+			stack[stackSize++] = { node.firstChild + (1 - nearChild), rayMask };
+			stack[stackSize++] = { node.firstChild + nearChild, rayMask };
+		}
+	}
+
+
+	[[nodiscard]] const DirectX::BoundingBox *GetBounds() const override
+	{
+		if (_nodes.empty())
+			return nullptr;
+
+		return &_sceneBounds;
+	}
+
+
+	void DebugGetStructure(std::vector<DirectX::BoundingBox> &boxCollection) const override
+	{
+		for (const Node &node : _nodes)
+		{
+			if (node.firstChild == 0 && node.aabb.IsValid())
+				boxCollection.push_back(node.bounds);
+		}
+	}
+};
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <vector>
+#include <DirectXCollision.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CULLING_KERNEL_WIDTH 8
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CULLING_KERNEL_WIDTH 4
+#else
+#define CULLING_KERNEL_WIDTH 1
+#endif
+
+typedef unsigned int UINT;
+
+
+// Outward facing planes of a convex culling volume, stored as separate component arrays for wide loads.
+// A box is outside the volume if it is entirely in front of any plane.
+struct CullingPlanes
+{
+	static constexpr UINT MAX_PLANES = 6;
+
+	float normalX[MAX_PLANES] = { };
+	float normalY[MAX_PLANES] = { };
+	float normalZ[MAX_PLANES] = { };
+	float absNormalX[MAX_PLANES] = { };
+	float absNormalY[MAX_PLANES] = { };
+	float absNormalZ[MAX_PLANES] = { };
+	float distance[MAX_PLANES] = { };
+	UINT count = 0;
+
+
+	[[nodiscard]] bool operator==(const CullingPlanes &other) const = default;
+
+	void AddPlane(const DirectX::XMFLOAT4 &p)
+	{
+		normalX[count] = p.x;
+		normalY[count] = p.y;
+		normalZ[count] = p.z;
+		absNormalX[count] = std::abs(p.x);
+		absNormalY[count] = std::abs(p.y);
+		absNormalZ[count] = std::abs(p.z);
+		distance[count] = p.w;
+		count++;
+	}
+
+	[[nodiscard]] static CullingPlanes FromFrustum(const DirectX::BoundingFrustum &frustum)
+	{
+		DirectX::XMVECTOR planes[MAX_PLANES];
+		frustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+
+		CullingPlanes result;
+		for (const DirectX::XMVECTOR &plane : planes)
+		{
+			DirectX::XMFLOAT4 p;
+			DirectX::XMStoreFloat4(&p, plane);
+			result.AddPlane(p);
+		}
+		return result;
+	}
+
+	[[nodiscard]] static CullingPlanes FromBox(const DirectX::BoundingBox &box)
+	{
+		const DirectX::XMFLOAT3 &c = box.Center, &e = box.Extents;
+
+		CullingPlanes result;
+		result.AddPlane({ 1.0f, 0.0f, 0.0f, -c.x - e.x });
+		result.AddPlane({ -1.0f, 0.0f, 0.0f, c.x - e.x });
+		result.AddPlane({ 0.0f, 1.0f, 0.0f, -c.y - e.y });
+		result.AddPlane({ 0.0f, -1.0f, 0.0f, c.y - e.y });
+		result.AddPlane({ 0.0f, 0.0f, 1.0f, -c.z - e.z });
+		result.AddPlane({ 0.0f, 0.0f, -1.0f, c.z - e.z });
+		return result;
+	}
+
+	// The face planes of an oriented box. Unlike BoundingOrientedBox::Contains() this never separates
+	// boxes along edge axes, so a few boxes near the corners are kept that an exact test would reject.
+	[[nodiscard]] static CullingPlanes FromOrientedBox(const DirectX::BoundingOrientedBox &box)
+	{
+		using namespace DirectX;
+
+		const XMVECTOR orientation = XMLoadFloat4(&box.Orientation);
+		const XMVECTOR center = XMLoadFloat3(&box.Center);
+		const float extents[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+
+		CullingPlanes result;
+		for (UINT axis = 0; axis < 3; axis++)
+		{
+			const XMVECTOR localAxis = XMVectorSet(axis == 0 ? 1.0f : 0.0f, axis == 1 ? 1.0f : 0.0f, axis == 2 ? 1.0f : 0.0f, 0.0f);
+			const XMVECTOR normal = XMVector3Rotate(localAxis, orientation);
+			const float offset = XMVectorGetX(XMVector3Dot(normal, center));
+
+			XMFLOAT3 n;
+			XMStoreFloat3(&n, normal);
+
+			result.AddPlane({ n.x, n.y, n.z, -offset - extents[axis] });
+			result.AddPlane({ -n.x, -n.y, -n.z, offset - extents[axis] });
+		}
+		return result;
+	}
+};
+
+// Plane mask with one bit per plane, where a set bit means the plane still needs testing.
+constexpr UINT CULLING_ALL_PLANES = (1u << CullingPlanes::MAX_PLANES) - 1;
+
+// Result of a box that is entirely outside at least one of the tested planes.
+constexpr UINT CULLING_OUTSIDE = 1u << 31;
+
+
+// Axis-aligned boxes stored as separate component arrays.
+struct CullingBoxes
+{
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+
+
+	[[nodiscard]] UINT Size() const
+	{
+		return static_cast<UINT>(centerX.size());
+	}
+
+	void Clear()
+	{
+		centerX.clear(); centerY.clear(); centerZ.clear();
+		extentX.clear(); extentY.clear(); extentZ.clear();
+	}
+
+	void Reserve(const size_t count)
+	{
+		centerX.reserve(count); centerY.reserve(count); centerZ.reserve(count);
+		extentX.reserve(count); extentY.reserve(count); extentZ.reserve(count);
+	}
+
+	void PushBack(const DirectX::BoundingBox &box)
+	{
+		centerX.push_back(box.Center.x); centerY.push_back(box.Center.y); centerZ.push_back(box.Center.z);
+		extentX.push_back(box.Extents.x); extentY.push_back(box.Extents.y); extentZ.push_back(box.Extents.z);
+	}
+
+	void Set(const UINT index, const DirectX::BoundingBox &box)
+	{
+		centerX[index] = box.Center.x; centerY[index] = box.Center.y; centerZ[index] = box.Center.z;
+		extentX[index] = box.Extents.x; extentY[index] = box.Extents.y; extentZ[index] = box.Extents.z;
+	}
+};
+
+
+// Classifies a single box against the planes in planeMask.
+// The result is CULLING_OUTSIDE, or the mask of tested planes the box straddles. A result of zero means the box
+// is fully inside every tested plane, and a straddle mask can be passed on as the plane mask of anything inside the box.
+[[nodiscard]] inline UINT ClassifyBox(const CullingPlanes &planes, const UINT planeMask,
+	const float centerX, const float centerY, const float centerZ,
+	const float extentX, const float extentY, const float extentZ)
+{
+	UINT result = 0;
+
+	for (UINT p = 0; p < planes.count; p++)
+	{
+		if (!(planeMask & (1u << p)))
+			continue;
+
+		const float dist = planes.normalX[p] * centerX
+			+ planes.normalY[p] * centerY
+			+ planes.normalZ[p] * centerZ
+			+ planes.distance[p];
+
+		const float radius = planes.absNormalX[p] * extentX
+			+ planes.absNormalY[p] * extentY
+			+ planes.absNormalZ[p] * extentZ;
+
+		if (dist > radius)
+			return CULLING_OUTSIDE;
+
+		if (dist > -radius)
+			result |= 1u << p;
+	}
+
+	return result;
+}
+
+[[nodiscard]] inline UINT ClassifyBox(const CullingPlanes &planes, const UINT planeMask, const DirectX::BoundingBox &box)
+{
+	return ClassifyBox(planes, planeMask, box.Center.x, box.Center.y, box.Center.z, box.Extents.x, box.Extents.y, box.Extents.z);
+}
+
+// Returns the views in viewMask, one bit per element of views, that the box is not entirely outside of.
+[[nodiscard]] inline UINT ClassifyBoxViews(const CullingPlanes *views, const UINT viewMask, const DirectX::BoundingBox &box)
+{
+	UINT result = 0;
+
+	for (UINT remaining = viewMask; remaining != 0; remaining &= remaining - 1)
+	{
+		const UINT view = static_cast<UINT>(std::countr_zero(remaining));
+		if (ClassifyBox(views[view], CULLING_ALL_PLANES, box) != CULLING_OUTSIDE)
+			result |= 1u << view;
+	}
+
+	return result;
+}
+
+// Classifies boxes [first, first + count) one at a time, writing the result of each to results.
+inline void ClassifyBoxesScalar(const CullingPlanes &planes, const UINT planeMask,
+	const CullingBoxes &boxes, const UINT first, const UINT count, UINT *results)
+{
+	for (UINT i = first; i < first + count; i++)
+	{
+		*results++ = ClassifyBox(planes, planeMask,
+			boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i],
+			boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+	}
+}
+
+
+// Same as ClassifyBoxesScalar(), testing CULLING_KERNEL_WIDTH boxes per instruction.
+inline void ClassifyBoxes(const CullingPlanes &planes, const UINT planeMask,
+	const CullingBoxes &boxes, const UINT first, const UINT count, UINT *results)
+{
+	UINT i = 0;
+
+#if CULLING_KERNEL_WIDTH == 8
+	const __m256i outsideValue = _mm256_set1_epi32(static_cast<int>(CULLING_OUTSIDE));
+
+	for (; i + 8 <= count; i += 8)
+	{
+		const UINT b = first + i;
+		const __m256
+			cx = _mm256_loadu_ps(&boxes.centerX[b]), cy = _mm256_loadu_ps(&boxes.centerY[b]), cz = _mm256_loadu_ps(&boxes.centerZ[b]),
+			ex = _mm256_loadu_ps(&boxes.extentX[b]), ey = _mm256_loadu_ps(&boxes.extentY[b]), ez = _mm256_loadu_ps(&boxes.extentZ[b]);
+
+		__m256 outside = _mm256_setzero_ps();
+		__m256i straddle = _mm256_setzero_si256();
+
+		for (UINT p = 0; p < planes.count; p++)
+		{
+			if (!(planeMask & (1u << p)))
+				continue;
+
+			// Summed in the same order as ClassifyBox(), so boxes on a plane classify the same at every kernel width.
+			const __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(_mm256_set1_ps(planes.normalX[p]), cx),
+				_mm256_mul_ps(_mm256_set1_ps(planes.normalY[p]), cy)),
+				_mm256_mul_ps(_mm256_set1_ps(planes.normalZ[p]), cz)),
+				_mm256_set1_ps(planes.distance[p]));
+
+			const __m256 radius = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(_mm256_set1_ps(planes.absNormalX[p]), ex),
+				_mm256_mul_ps(_mm256_set1_ps(planes.absNormalY[p]), ey)),
+				_mm256_mul_ps(_mm256_set1_ps(planes.absNormalZ[p]), ez));
+
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(dist, radius, _CMP_GT_OQ));
+			if (_mm256_movemask_ps(outside) == 0xFF)
+				break;
+
+			const __m256 straddling = _mm256_cmp_ps(dist, _mm256_sub_ps(_mm256_setzero_ps(), radius), _CMP_GT_OQ);
+			straddle = _mm256_or_si256(straddle, _mm256_and_si256(_mm256_castps_si256(straddling), _mm256_set1_epi32(static_cast<int>(1u << p))));
+		}
+
+		const __m256i outsideMask = _mm256_castps_si256(outside);
+		const __m256i result = _mm256_or_si256(_mm256_and_si256(outsideMask, outsideValue), _mm256_andnot_si256(outsideMask, straddle));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(results + i), result);
+	}
+#endif
+
+#if CULLING_KERNEL_WIDTH >= 4
+	const __m128i outsideValue4 = _mm_set1_epi32(static_cast<int>(CULLING_OUTSIDE));
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const UINT b = first + i;
+		const __m128
+			cx = _mm_loadu_ps(&boxes.centerX[b]), cy = _mm_loadu_ps(&boxes.centerY[b]), cz = _mm_loadu_ps(&boxes.centerZ[b]),
+			ex = _mm_loadu_ps(&boxes.extentX[b]), ey = _mm_loadu_ps(&boxes.extentY[b]), ez = _mm_loadu_ps(&boxes.extentZ[b]);
+
+		__m128 outside = _mm_setzero_ps();
+		__m128i straddle = _mm_setzero_si128();
+
+		for (UINT p = 0; p < planes.count; p++)
+		{
+			if (!(planeMask & (1u << p)))
+				continue;
+
+			const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(planes.normalX[p]), cx),
+				_mm_mul_ps(_mm_set1_ps(planes.normalY[p]), cy)),
+				_mm_mul_ps(_mm_set1_ps(planes.normalZ[p]), cz)),
+				_mm_set1_ps(planes.distance[p]));
+
+			const __m128 radius = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(planes.absNormalX[p]), ex),
+				_mm_mul_ps(_mm_set1_ps(planes.absNormalY[p]), ey)),
+				_mm_mul_ps(_mm_set1_ps(planes.absNormalZ[p]), ez));
+
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(dist, radius));
+			if (_mm_movemask_ps(outside) == 0xF)
+				break;
+
+			const __m128 straddling = _mm_cmpgt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), radius));
+			straddle = _mm_or_si128(straddle, _mm_and_si128(_mm_castps_si128(straddling), _mm_set1_epi32(static_cast<int>(1u << p))));
+		}
+
+		const __m128i outsideMask = _mm_castps_si128(outside);
+		const __m128i result = _mm_or_si128(_mm_and_si128(outsideMask, outsideValue4), _mm_andnot_si128(outsideMask, straddle));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(results + i), result);
+	}
+#endif
+
+	ClassifyBoxesScalar(planes, planeMask, boxes, first + i, count - i, results + i);
+}
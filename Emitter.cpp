@@ -3,7 +3,7 @@
 #include "ErrMsg.h"
 
 
-Emitter::Emitter(const UINT id, const DirectX::BoundingBox &bounds) : Entity(id, bounds)
+Emitter::Emitter(const UINT id, const UINT slot, const DirectX::BoundingBox &bounds, EntityNameTable *nameTable, EntityComponents *components) : Entity(id, slot, bounds, nameTable, components)
 {
 
 }
@@ -130,6 +130,17 @@ bool Emitter::Update(ID3D11DeviceContext *context, Time &time, const Input &inpu
 	return true;
 }
 
+bool Emitter::UpdateBuffers(ID3D11DeviceContext *context)
+{
+	if (!InternalUpdateBuffers(context))
+	{
+		ErrMsg("Failed to update emitter buffers!");
+		return false;
+	}
+
+	return true;
+}
+
 bool Emitter::BindBuffers(ID3D11DeviceContext *context) const
 {
 	if (!InternalBindBuffers(context))
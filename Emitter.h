@@ -35,7 +35,7 @@ private:
 
 
 public:
-	explicit Emitter(UINT id, const DirectX::BoundingBox &bounds);
+	explicit Emitter(UINT id, UINT slot, const DirectX::BoundingBox &bounds, EntityNameTable *nameTable, EntityComponents *components);
 
 	[[nodiscard]] bool Initialize(ID3D11Device *device, const std::string &name, const EmitterData &settings, UINT textureID);
 
@@ -44,6 +44,7 @@ public:
 	[[nodiscard]] UINT GetTextureID() const;
 
 	[[nodiscard]] bool Update(ID3D11DeviceContext *context, Time &time, const Input &input) override;
+	[[nodiscard]] bool UpdateBuffers(ID3D11DeviceContext *context) override;
 	[[nodiscard]] bool BindBuffers(ID3D11DeviceContext *context) const override;
 	[[nodiscard]] bool Render(CameraD3D11 *camera) override;
 
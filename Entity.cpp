@@ -3,20 +3,26 @@
 #include "ErrMsg.h"
 
 
-Entity::Entity(const UINT id, const DirectX::BoundingBox &bounds)
+Entity::Entity(const UINT id, const UINT slot, const DirectX::BoundingBox &bounds, EntityNameTable *nameTable, EntityComponents *components)
 {
 	_entityID = id;
-	_bounds = bounds;
+	_slot = slot;
+
+	_nameTable = nameTable;
+	_nameIndex = _nameTable->AddEntity(_nameID, this);
+
+	_components = components;
+	_components->Add(_slot, bounds, &_transform);
 }
 
 Entity::~Entity()
 {
-	for (auto& child : _children)
-	{
-		if (child != nullptr)
-			child->SetParent(nullptr);
-	}
-	_children.clear();
+	RemoveFromNameTable();
+	_components->Remove(_slot);
+
+	// Unparenting a child removes it from _children.
+	while (!_children.empty())
+		_children.back()->SetParent(nullptr);
 
 	if (_parent)
 		_parent->RemoveChild(this);
@@ -87,10 +93,20 @@ void Entity::SetDirty()
 	for (auto &child : _children)
 		child->SetDirty();
 
-	_recalculateBounds = true;
+	_components->SetDirty(_slot);
 	_transform.SetDirty();
 }
 
+void Entity::SetStatic(const bool isStatic)
+{
+	_components->SetStatic(_slot, isStatic);
+}
+
+bool Entity::IsStatic() const
+{
+	return _components->IsStatic(_slot);
+}
+
 
 
 void Entity::SetParent(Entity *parent, bool keepWorldTransform)
@@ -115,6 +131,7 @@ void Entity::SetParent(Entity *parent, bool keepWorldTransform)
 	else
 		_transform.SetParent(nullptr, keepWorldTransform);
 
+	_components->SetParent(_slot, parent ? parent->_slot : EntityComponents::NO_PARENT);
 	SetDirty();
 }
 
@@ -136,29 +153,49 @@ UINT Entity::GetID() const
 
 void Entity::SetName(const std::string &name)
 {
-	_name.assign(name);
+	const UINT nameID = _nameTable->Intern(name);
+	if (nameID == _nameID)
+		return;
+
+	RemoveFromNameTable();
+	_nameID = nameID;
+	_nameIndex = _nameTable->AddEntity(_nameID, this);
 }
 
-const std::string Entity::GetName() const
+const std::string &Entity::GetName() const
 {
-	return _name;
+	return _nameTable->GetName(_nameID);
+}
+
+void Entity::RemoveFromNameTable()
+{
+	Entity *moved = _nameTable->RemoveEntity(_nameID, _nameIndex);
+	if (moved != nullptr)
+		moved->_nameIndex = _nameIndex;
 }
 
 Transform *Entity::GetTransform()
+{
+	// Sleeping entities are not updated, so they would never see the transform being edited.
+	// Waking is enough, as InternalUpdate() dirties the entity if it finds the transform dirty.
+	_components->Wake(_slot);
+	return &_transform;
+}
+
+const Transform *Entity::GetTransform() const
 {
 	return &_transform;
 }
 
 
-void Entity::StoreBounds(DirectX::BoundingBox &entityBounds)
+void Entity::StoreBounds(DirectX::BoundingBox &entityBounds) const
 {
-	if (_recalculateBounds)
-	{
-		_bounds.Transform(_transformedBounds, _transform.GetWorldMatrix());
-		_recalculateBounds = false;
-	}
+	entityBounds = _components->GetWorldBounds(_slot);
+}
 
-	entityBounds = _transformedBounds;
+DirectX::XMMATRIX Entity::GetWorldMatrix() const
+{
+	return DirectX::XMLoadFloat4x4A(&_components->GetWorldMatrix(_slot));
 }
 
 
@@ -175,7 +212,22 @@ bool Entity::InternalUpdate(ID3D11DeviceContext *context)
 		SetDirty();
 	}
 
-	if (!_transform.UpdateConstantBuffer(context))
+	return true;
+}
+
+bool Entity::InternalUpdateBuffers(ID3D11DeviceContext *context)
+{
+	if (!_isInitialized)
+	{
+		ErrMsg("Entity is not initialized!");
+		return false;
+	}
+
+	// Uploading maps the buffer & inverts the matrix, so it is only done for entities that have moved.
+	if (!_transform.GetDirty())
+		return true;
+
+	if (!_transform.UpdateConstantBuffer(context, GetWorldMatrix()))
 	{
 		ErrMsg("Failed to set world matrix buffer!");
 		return false;
@@ -4,6 +4,8 @@
 #include "Time.h"
 #include "Input.h"
 #include "Graphics.h"
+#include "EntityNameTable.h"
+#include "EntityComponents.h"
 
 
 enum class EntityType
@@ -17,17 +19,22 @@ class Entity
 {
 private:
 	UINT _entityID;
-	std::string _name = "";
+
+	EntityNameTable *_nameTable = nullptr;
+	UINT _nameID = EntityNameTable::EMPTY_NAME_ID;
+	UINT _nameIndex = 0; // Index among the entities using the same name.
+
+	void RemoveFromNameTable();
+
+	// Holds the per-frame state of the entity, such as its world bounds.
+	EntityComponents *_components = nullptr;
+	UINT _slot = 0;
 
 
 protected:
 	bool _isInitialized = false;
 	Transform _transform;
 
-	DirectX::BoundingBox _bounds;
-	DirectX::BoundingBox _transformedBounds;
-	bool _recalculateBounds = true;
-
 	Entity *_parent = nullptr;
 	std::vector<Entity *> _children;
 
@@ -35,11 +42,12 @@ protected:
 	void RemoveChild(Entity *child, bool keepWorldTransform = false);
 
 
-	Entity(UINT id, const DirectX::BoundingBox &bounds);
+	Entity(UINT id, UINT slot, const DirectX::BoundingBox &bounds, EntityNameTable *nameTable, EntityComponents *components);
 
 	[[nodiscard]] bool Initialize(ID3D11Device *device, const std::string &name);
 
 	[[nodiscard]] bool InternalUpdate(ID3D11DeviceContext *context);
+	[[nodiscard]] bool InternalUpdateBuffers(ID3D11DeviceContext *context);
 	[[nodiscard]] bool InternalBindBuffers(ID3D11DeviceContext *context) const;
 	[[nodiscard]] bool InternalRender(CameraD3D11 *camera);
 
@@ -54,20 +62,30 @@ public:
 
 	void SetDirty();
 
+	// Marks the entity as one that is not expected to move, which puts it to sleep as soon as it stops moving.
+	void SetStatic(bool isStatic);
+	[[nodiscard]] bool IsStatic() const;
+
 	void SetParent(Entity *parent, bool keepWorldTransform = false);
 	[[nodiscard]] Entity *GetParent();
 	[[nodiscard]] const std::vector<Entity *> *GetChildren();
 
 	void SetName(const std::string &name);
-	[[nodiscard]] const std::string GetName() const;
+	[[nodiscard]] const std::string &GetName() const;
 
 	[[nodiscard]] UINT GetID() const;
+	// Wakes the entity, so edits made through the returned pointer are picked up by its next update.
 	[[nodiscard]] Transform *GetTransform();
+	[[nodiscard]] const Transform *GetTransform() const;
 	[[nodiscard]] virtual EntityType GetType() const = 0;
 
-	void StoreBounds(DirectX::BoundingBox &entityBounds);
+	// Stores the world bounds as of the last world data pass.
+	void StoreBounds(DirectX::BoundingBox &entityBounds) const;
+	[[nodiscard]] DirectX::XMMATRIX GetWorldMatrix() const;
 
 	[[nodiscard]] virtual bool Update(ID3D11DeviceContext *context, Time &time, const Input &input) = 0;
+	// Uploads the world data of the last world data pass if the entity has moved, so it has to be called after SceneHolder::Update().
+	[[nodiscard]] virtual bool UpdateBuffers(ID3D11DeviceContext *context) = 0;
 	[[nodiscard]] virtual bool BindBuffers(ID3D11DeviceContext *context) const = 0;
 	[[nodiscard]] virtual bool Render(CameraD3D11 *camera) = 0;
 };
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+#include "Transform.h"
+
+typedef unsigned int UINT;
+
+
+// Entity state read & written every frame, kept in arrays indexed by entity slot.
+// Passes over every entity thus sweep packed arrays instead of visiting each entity.
+// Names & GPU buffers are rarely touched, so they stay with the entity.
+//
+// World matrices & bounds are only written by UpdateWorldData(), once per frame after entities have updated.
+// Reading them is const & safe from any number of threads, as long as no update runs at the same time.
+// Each world matrix is the local matrix times the cached world matrix of the parent, so a moved entity costs one multiply.
+//
+// Entities that stop moving fall asleep & are skipped by the scene update until they are dirtied again,
+// so the cost of a frame follows the number of moving entities rather than the size of the scene.
+class EntityComponents
+{
+private:
+	// Below this many slots at one depth, the world data pass costs less than waking the other threads.
+	static constexpr UINT MIN_PARALLEL_SLOTS = 4096;
+
+	// Frames a dynamic entity may go without moving before it falls asleep. Static entities sleep after one.
+	static constexpr UINT SLEEP_FRAMES = 60;
+
+	enum Flags : unsigned char
+	{
+		IS_ALIVE		= 1 << 0,
+		IS_DIRTY		= 1 << 1, // The world matrix & bounds are out of date.
+		IS_STATIC		= 1 << 2, // The entity is not expected to move.
+		IS_AWAKE		= 1 << 3, // The entity is in _awakeSlots.
+		IS_SLEEPLESS	= 1 << 4, // The entity has to update every frame, moving or not.
+	};
+
+	std::vector<unsigned char> _flags;
+	std::vector<DirectX::XMFLOAT4X4A> _worldMatrices;
+	std::vector<DirectX::BoundingBox> _localBounds;
+	std::vector<DirectX::BoundingBox> _worldBounds;
+	std::vector<const Transform *> _transforms; // Source of the local matrix, which is only read for dirty entities.
+	std::vector<UINT> _parents;
+	std::vector<UINT> _depths; // Depth of each entity in the hierarchy, rebuilt when the hierarchy changes.
+	UINT _maxDepth = 0;
+	bool _isDepthDirty = false;
+
+	std::vector<UINT> _awakeSlots; // In no particular order.
+	std::vector<UINT> _awakeIndices; // Index of each awake slot in _awakeSlots.
+	std::vector<UINT> _idleFrames; // Frames each awake entity has gone without moving.
+
+	// Dirty slots sorted by depth, so every parent comes before its children. Rebuilt by every pass.
+	// Slots at depth d are found in _updateOrder[_depthStarts[d] .. _depthStarts[d + 1]).
+	std::vector<UINT> _updateOrder;
+	std::vector<UINT> _depthStarts;
+	std::vector<UINT> _scratch;
+
+	// Expects the parent to be up to date.
+	void ComputeWorldData(const UINT slot)
+	{
+		DirectX::XMMATRIX worldMatrix = _transforms[slot]->GetLocalMatrix();
+
+		const UINT parent = _parents[slot];
+		if (parent != NO_PARENT)
+			worldMatrix = DirectX::XMMatrixMultiply(worldMatrix, DirectX::XMLoadFloat4x4A(&_worldMatrices[parent]));
+
+		DirectX::XMStoreFloat4x4A(&_worldMatrices[slot], worldMatrix);
+		_localBounds[slot].Transform(_worldBounds[slot], worldMatrix);
+		_flags[slot] &= ~IS_DIRTY;
+		_idleFrames[slot] = 0;
+	}
+
+	void RebuildDepths()
+	{
+		constexpr UINT UNKNOWN_DEPTH = 0xffffffff;
+		const UINT slotCount = static_cast<UINT>(_flags.size());
+
+		_depths.assign(slotCount, UNKNOWN_DEPTH);
+		_maxDepth = 0;
+
+		for (UINT slot = 0; slot < slotCount; slot++)
+		{
+			if (!(_flags[slot] & IS_ALIVE) || _depths[slot] != UNKNOWN_DEPTH)
+				continue;
+
+			// Walk up to the first ancestor with a known depth, then hand out depths on the way back down.
+			_scratch.clear();
+			UINT ancestor = slot;
+			while (ancestor != NO_PARENT && _depths[ancestor] == UNKNOWN_DEPTH)
+			{
+				_scratch.push_back(ancestor);
+				ancestor = _parents[ancestor];
+			}
+
+			UINT depth = (ancestor == NO_PARENT) ? 0 : _depths[ancestor] + 1;
+			for (auto it = _scratch.rbegin(); it != _scratch.rend(); ++it)
+				_depths[*it] = depth++;
+
+			_maxDepth = (std::max)(_maxDepth, depth - 1);
+		}
+
+		_isDepthDirty = false;
+	}
+
+	// Counting sort of the dirty slots by depth. Dirty entities are always awake, so only awake slots are visited.
+	void BuildUpdateOrder()
+	{
+		_depthStarts.assign(_maxDepth + 2, 0);
+		for (const UINT slot : _awakeSlots)
+		{
+			if (_flags[slot] & IS_DIRTY)
+				_depthStarts[_depths[slot] + 1]++;
+		}
+
+		for (UINT depth = 1; depth < _depthStarts.size(); depth++)
+			_depthStarts[depth] += _depthStarts[depth - 1];
+
+		_updateOrder.resize(_depthStarts.back());
+		_scratch.assign(_depthStarts.begin(), _depthStarts.end() - 1);
+		for (const UINT slot : _awakeSlots)
+		{
+			if (_flags[slot] & IS_DIRTY)
+				_updateOrder[_scratch[_depths[slot]]++] = slot;
+		}
+	}
+
+	void Sleep(const UINT slot)
+	{
+		const UINT index = _awakeIndices[slot];
+		const UINT moved = _awakeSlots.back();
+
+		_awakeSlots[index] = moved;
+		_awakeIndices[moved] = index;
+		_awakeSlots.pop_back();
+
+		_flags[slot] &= ~IS_AWAKE;
+	}
+
+public:
+	static constexpr UINT NO_PARENT = 0xffffffff;
+
+	EntityComponents() = default;
+	~EntityComponents() = default;
+	EntityComponents(const EntityComponents &other) = delete;
+	EntityComponents &operator=(const EntityComponents &other) = delete;
+	EntityComponents(EntityComponents &&other) = delete;
+	EntityComponents &operator=(EntityComponents &&other) = delete;
+
+	void Add(const UINT slot, const DirectX::BoundingBox &localBounds, const Transform *transform)
+	{
+		if (slot >= _flags.size())
+		{
+			_flags.resize(slot + 1, 0);
+			_worldMatrices.resize(slot + 1);
+			_localBounds.resize(slot + 1);
+			_worldBounds.resize(slot + 1);
+			_transforms.resize(slot + 1, nullptr);
+			_parents.resize(slot + 1, NO_PARENT);
+			_depths.resize(slot + 1, 0);
+			_awakeIndices.resize(slot + 1, 0);
+			_idleFrames.resize(slot + 1, 0);
+		}
+
+		// New entities have no parent, so their depth is known without rebuilding.
+		_flags[slot] = IS_ALIVE;
+		_localBounds[slot] = localBounds;
+		_transforms[slot] = transform;
+		_parents[slot] = NO_PARENT;
+		_depths[slot] = 0;
+		SetDirty(slot);
+	}
+
+	// Expects the entity to have no children left.
+	void Remove(const UINT slot)
+	{
+		if (_flags[slot] & IS_AWAKE)
+			Sleep(slot);
+
+		_flags[slot] = 0;
+		_transforms[slot] = nullptr;
+		_parents[slot] = NO_PARENT;
+	}
+
+	// Mirrors the entity hierarchy, which has to match the hierarchy of the transforms.
+	void SetParent(const UINT slot, const UINT parentSlot)
+	{
+		_parents[slot] = parentSlot;
+		_isDepthDirty = true;
+	}
+
+	// Also wakes the entity.
+	void SetDirty(const UINT slot)
+	{
+		_flags[slot] |= IS_DIRTY;
+		Wake(slot);
+	}
+
+	[[nodiscard]] bool IsDirty(const UINT slot) const
+	{
+		return _flags[slot] & IS_DIRTY;
+	}
+
+	void SetStatic(const UINT slot, const bool isStatic)
+	{
+		if (isStatic)
+			_flags[slot] |= IS_STATIC;
+		else
+			_flags[slot] &= ~IS_STATIC;
+	}
+
+	[[nodiscard]] bool IsStatic(const UINT slot) const
+	{
+		return _flags[slot] & IS_STATIC;
+	}
+
+	// Keeps the entity awake for as long as it lives.
+	void SetSleepless(const UINT slot)
+	{
+		_flags[slot] |= IS_SLEEPLESS;
+		Wake(slot);
+	}
+
+	void Wake(const UINT slot)
+	{
+		_idleFrames[slot] = 0;
+
+		if (_flags[slot] & IS_AWAKE)
+			return;
+
+		_flags[slot] |= IS_AWAKE;
+		_awakeIndices[slot] = static_cast<UINT>(_awakeSlots.size());
+		_awakeSlots.push_back(slot);
+	}
+
+	[[nodiscard]] bool IsAwake(const UINT slot) const
+	{
+		return _flags[slot] & IS_AWAKE;
+	}
+
+	// Slots woken while iterating are appended, so iterate by index to visit them too.
+	[[nodiscard]] const std::vector<UINT> &GetAwakeSlots() const
+	{
+		return _awakeSlots;
+	}
+
+	// Both return the world data as of the last update, even if the entity has moved since.
+	[[nodiscard]] const DirectX::XMFLOAT4X4A &GetWorldMatrix(const UINT slot) const
+	{
+		return _worldMatrices[slot];
+	}
+
+	[[nodiscard]] const DirectX::BoundingBox &GetWorldBounds(const UINT slot) const
+	{
+		return _worldBounds[slot];
+	}
+
+	// Brings the world matrix & bounds of one entity up to date right away, for edits that need them before the next pass.
+	// Dirty ancestors are brought up to date first. Not thread-safe.
+	void UpdateWorldData(const UINT slot)
+	{
+		if (!(_flags[slot] & IS_DIRTY))
+			return;
+
+		const UINT parent = _parents[slot];
+		if (parent != NO_PARENT)
+			UpdateWorldData(parent);
+
+		ComputeWorldData(slot);
+	}
+
+	// Brings every moved entity up to date one depth at a time, then puts entities that have stopped moving to sleep.
+	// Entities at the same depth never depend on each other, so each depth is split between threads.
+	// Relies on dirtying an entity also dirtying its descendants, as Entity::SetDirty() does.
+	void UpdateWorldData()
+	{
+		if (_isDepthDirty)
+			RebuildDepths();
+
+		BuildUpdateOrder();
+
+		for (UINT depth = 0; depth + 1 < _depthStarts.size(); depth++)
+		{
+			const int first = static_cast<int>(_depthStarts[depth]);
+			const int last = static_cast<int>(_depthStarts[depth + 1]);
+
+			#pragma omp parallel for schedule(static) if(last - first >= static_cast<int>(MIN_PARALLEL_SLOTS))
+			for (int i = first; i < last; i++)
+				ComputeWorldData(_updateOrder[i]);
+		}
+
+		// Iterated backwards, as putting an entity to sleep moves the last awake slot into its place.
+		for (size_t i = _awakeSlots.size(); i > 0; i--)
+		{
+			const UINT slot = _awakeSlots[i - 1];
+			if (_flags[slot] & IS_SLEEPLESS)
+				continue;
+
+			const UINT sleepFrames = (_flags[slot] & IS_STATIC) ? 1 : SLEEP_FRAMES;
+			if (_idleFrames[slot] >= sleepFrames)
+				Sleep(slot);
+			else
+				_idleFrames[slot]++;
+		}
+	}
+};
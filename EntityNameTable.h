@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef unsigned int UINT;
+
+class Entity;
+
+
+// Entity names interned by ID, along with the entities currently using each name.
+// Many entities may share a name, so looking them up by name costs one hash lookup no matter how many entities there are.
+// Names are never released, as scenes reuse the same few names.
+class EntityNameTable
+{
+private:
+	std::unordered_map<std::string, UINT> _nameIDs;
+	std::vector<const std::string *> _names; // Keys of _nameIDs, which keep their address as the map grows.
+	std::vector<std::vector<Entity *>> _entities; // Entities using each name, in no particular order.
+
+public:
+	static constexpr UINT EMPTY_NAME_ID = 0;
+	static constexpr UINT INVALID_NAME_ID = 0xffffffff;
+
+	EntityNameTable()
+	{
+		(void)Intern("");
+	}
+
+	~EntityNameTable() = default;
+	EntityNameTable(const EntityNameTable &other) = delete;
+	EntityNameTable &operator=(const EntityNameTable &other) = delete;
+	EntityNameTable(EntityNameTable &&other) = delete;
+	EntityNameTable &operator=(EntityNameTable &&other) = delete;
+
+	// Returns the ID of the name, adding it if it is new.
+	[[nodiscard]] UINT Intern(const std::string &name)
+	{
+		const auto [it, isNew] = _nameIDs.try_emplace(name, static_cast<UINT>(_names.size()));
+		if (isNew)
+		{
+			_names.push_back(&it->first);
+			_entities.emplace_back();
+		}
+
+		return it->second;
+	}
+
+	// Returns INVALID_NAME_ID if no entity has ever used the name.
+	[[nodiscard]] UINT Find(const std::string &name) const
+	{
+		const auto it = _nameIDs.find(name);
+		return (it != _nameIDs.end()) ? it->second : INVALID_NAME_ID;
+	}
+
+	[[nodiscard]] const std::string &GetName(const UINT nameID) const
+	{
+		return *_names[nameID];
+	}
+
+	[[nodiscard]] const std::vector<Entity *> &GetEntities(const UINT nameID) const
+	{
+		return _entities[nameID];
+	}
+
+	// Returns the index of the entity among the entities using the name, which is needed to remove it.
+	[[nodiscard]] UINT AddEntity(const UINT nameID, Entity *entity)
+	{
+		_entities[nameID].push_back(entity);
+		return static_cast<UINT>(_entities[nameID].size() - 1);
+	}
+
+	// Moves the last entity using the name to the index of the removed one. Returns the moved entity, or nullptr if none was moved.
+	[[nodiscard]] Entity *RemoveEntity(const UINT nameID, const UINT index)
+	{
+		std::vector<Entity *> &entities = _entities[nameID];
+
+		Entity *moved = (index + 1 < entities.size()) ? entities.back() : nullptr;
+		entities[index] = entities.back();
+		entities.pop_back();
+
+		return moved;
+	}
+};
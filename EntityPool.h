@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+typedef unsigned int UINT;
+
+
+// Stores items of one type in fixed-size chunks, so items never move once created and neighbouring items share cache lines.
+// Freed places are reused before new chunks are allocated. Items are identified by their index in the pool.
+template <typename T>
+class EntityPool
+{
+private:
+	static constexpr UINT CHUNK_SIZE = 256;
+
+	struct Chunk
+	{
+		alignas(T) unsigned char storage[CHUNK_SIZE * sizeof(T)];
+		bool isAlive[CHUNK_SIZE];
+	};
+
+	std::vector<std::unique_ptr<Chunk>> _chunks;
+	std::vector<UINT> _freeIndices; // Used as a stack, refilling the most recently freed place first.
+	UINT _count = 0;
+
+	[[nodiscard]] T *GetItem(const UINT index) const
+	{
+		return std::launder(reinterpret_cast<T *>(_chunks[index / CHUNK_SIZE]->storage) + index % CHUNK_SIZE);
+	}
+
+public:
+	EntityPool() = default;
+	~EntityPool()
+	{
+		Clear();
+	}
+	EntityPool(const EntityPool &other) = delete;
+	EntityPool &operator=(const EntityPool &other) = delete;
+	EntityPool(EntityPool &&other) = delete;
+	EntityPool &operator=(EntityPool &&other) = delete;
+
+	// Constructs a new item from the given arguments, writing its index to index.
+	template <typename... Args>
+	[[nodiscard]] T *Create(UINT &index, Args &&...args)
+	{
+		if (_freeIndices.empty())
+		{
+			const UINT chunkStart = static_cast<UINT>(_chunks.size()) * CHUNK_SIZE;
+
+			std::unique_ptr<Chunk> chunk = std::make_unique_for_overwrite<Chunk>();
+			std::fill_n(chunk->isAlive, CHUNK_SIZE, false);
+			_chunks.push_back(std::move(chunk));
+
+			// Pushed in reverse so the chunk fills from its start.
+			for (UINT i = CHUNK_SIZE; i > 0; i--)
+				_freeIndices.push_back(chunkStart + i - 1);
+		}
+
+		index = _freeIndices.back();
+		T *item = ::new (static_cast<void *>(reinterpret_cast<T *>(_chunks[index / CHUNK_SIZE]->storage) + index % CHUNK_SIZE))
+			T(std::forward<Args>(args)...);
+
+		_freeIndices.pop_back();
+		_chunks[index / CHUNK_SIZE]->isAlive[index % CHUNK_SIZE] = true;
+		_count++;
+		return item;
+	}
+
+	void Destroy(const UINT index)
+	{
+		Chunk &chunk = *_chunks[index / CHUNK_SIZE];
+		if (!chunk.isAlive[index % CHUNK_SIZE])
+			return;
+
+		chunk.isAlive[index % CHUNK_SIZE] = false;
+		GetItem(index)->~T();
+
+		_freeIndices.push_back(index);
+		_count--;
+	}
+
+	// Destroys every item, but keeps the chunks for reuse.
+	void Clear()
+	{
+		_freeIndices.clear();
+
+		for (UINT chunkIndex = static_cast<UINT>(_chunks.size()); chunkIndex > 0; chunkIndex--)
+		{
+			Chunk &chunk = *_chunks[chunkIndex - 1];
+			const UINT chunkStart = (chunkIndex - 1) * CHUNK_SIZE;
+
+			for (UINT i = CHUNK_SIZE; i > 0; i--)
+			{
+				if (chunk.isAlive[i - 1])
+				{
+					chunk.isAlive[i - 1] = false;
+					GetItem(chunkStart + i - 1)->~T();
+				}
+
+				_freeIndices.push_back(chunkStart + i - 1);
+			}
+		}
+
+		_count = 0;
+	}
+
+	[[nodiscard]] T *Get(const UINT index) const
+	{
+		return GetItem(index);
+	}
+
+	[[nodiscard]] UINT GetCount() const
+	{
+		return _count;
+	}
+
+	// Calls func on every item in memory order, stopping early if func returns false. Returns whether every call returned true.
+	template <typename Func>
+	[[nodiscard]] bool ForEach(Func &&func) const
+	{
+		for (UINT chunkIndex = 0; chunkIndex < _chunks.size(); chunkIndex++)
+		{
+			const Chunk &chunk = *_chunks[chunkIndex];
+			for (UINT i = 0; i < CHUNK_SIZE; i++)
+			{
+				if (!chunk.isAlive[i])
+					continue;
+
+				if (!func(GetItem(chunkIndex * CHUNK_SIZE + i)))
+					return false;
+			}
+		}
+
+		return true;
+	}
+};
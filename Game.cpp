@@ -323,44 +323,26 @@ bool Game::Render(Time& time, const Input& input)
 	snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("SceneRenderTime"));
 	ImGui::Text(std::format("{} Scene Render", timeStr).c_str());
 
-	snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("FrustumCull"));
-	ImGui::Text(std::format("{} Culling Main View", timeStr).c_str());
+	snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("MultiViewCull"));
+	ImGui::Text(std::format("{} Culling All Views", timeStr).c_str());
 
-	if (_graphics.GetUpdateCubemap())
-	{
-		snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("FrustumCullCubemap"));
-		ImGui::Text(std::format("{} Culling Cubemap Views", timeStr).c_str());
-	}
+	snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("RenderMainView"));
+	ImGui::Text(std::format("{} Rendering Main View", timeStr).c_str());
 
-	snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("FrustumCullSpotlights"));
-	ImGui::Text(std::format("{} Culling Spotlights Total", timeStr).c_str());
-
-	int i = 0;
-	float spotlightTime = time.CompareSnapshots(std::format("FrustumCullSpotlight{}", i));
-	while (spotlightTime >= 0.0f)
+	if (_graphics.GetUpdateCubemap())
 	{
-		snprintf(timeStr, sizeof(timeStr), "%.6f", spotlightTime);
-		ImGui::Text(std::format("{} Culling Spotlight #{}", timeStr, i).c_str());
-
-		spotlightTime = time.CompareSnapshots(std::format("FrustumCullSpotlight{}", ++i));
+		snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("RenderCubemap"));
+		ImGui::Text(std::format("{} Rendering Cubemap Views", timeStr).c_str());
 	}
 
-	snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("FrustumCullDirlights"));
-	ImGui::Text(std::format("{} Culling Dirlights Total", timeStr).c_str());
-
+	snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("RenderSpotlights"));
+	ImGui::Text(std::format("{} Rendering Spotlights Total", timeStr).c_str());
 
-	snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("FrustumCullPointlights"));
-	ImGui::Text(std::format("{} Culling Pointlights Total", timeStr).c_str());
+	snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("RenderDirlights"));
+	ImGui::Text(std::format("{} Rendering Dirlights Total", timeStr).c_str());
 
-	i = 0;
-	float pointlightTime = time.CompareSnapshots(std::format("FrustumCullPointlight{}", i));
-	while (pointlightTime >= 0.0f)
-	{
-		snprintf(timeStr, sizeof(timeStr), "%.6f", pointlightTime);
-		ImGui::Text(std::format("{} Culling Pointlight #{}", timeStr, i).c_str());
-
-		pointlightTime = time.CompareSnapshots(std::format("FrustumCullPointlight{}", ++i));
-	}
+	snprintf(timeStr, sizeof(timeStr), "%.6f", time.CompareSnapshots("RenderPointlights"));
+	ImGui::Text(std::format("{} Rendering Pointlights Total", timeStr).c_str());
 
 	/// ^==========================================^ ///
 	/// ^        Render UI here...                 ^ ///
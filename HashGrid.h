@@ -0,0 +1,747 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <DirectXCollision.h>
+
+#include "VolumeTree.h"
+#include "Raycast.h"
+
+
+// Uniform grid of cells stored sparsely in a hash map, suited to many similarly sized moving entities.
+// Each entity is stored in the one cell containing its center, so inserting, moving & removing are O(1).
+// Cells are loose, reaching past their edges by the largest extents of their items. Entities with extents
+// larger than a cell are kept in a separate list that every query tests linearly.
+class HashGrid final : public VolumeTree
+{
+public:
+	static constexpr float DEFAULT_CELL_SIZE = 4.0f;
+
+private:
+	static constexpr UINT NO_CELL = 0xffffffff;
+	static constexpr UINT LARGE_ITEMS = 0xfffffffe;
+
+	// Rough cost of looking up a cell in the hash map relative to scanning past it in the cell array.
+	static constexpr double CELL_LOOKUP_COST = 8.0;
+
+	// Cell coordinates are packed into 21 bits per axis.
+	static constexpr int COORD_BIAS = 1 << 20;
+	static constexpr std::uint64_t COORD_MASK = (1ull << 21) - 1;
+	static constexpr int RELEASED_COORD = -4 * COORD_BIAS;
+
+	// Coordinates are kept apart from the cell contents so that scanning them stays compact.
+	struct CellCoords
+	{
+		int x = 0, y = 0, z = 0;
+	};
+
+	struct Cell
+	{
+		std::vector<UINT> slots;
+		DirectX::XMFLOAT3 maxExtents = { 0.0f, 0.0f, 0.0f };
+	};
+
+	struct Item
+	{
+		Entity *entity = nullptr;
+		DirectX::BoundingBox bounds;
+		UINT cell = NO_CELL; // LARGE_ITEMS for items in the large item list.
+		UINT index = 0; // Position in the slot list of the cell or in the large item list.
+	};
+
+	float _cellSize = DEFAULT_CELL_SIZE;
+	float _invCellSize = 1.0f / DEFAULT_CELL_SIZE;
+
+	DirectX::BoundingBox _sceneBounds;
+	std::unordered_map<std::uint64_t, UINT> _cellLookup;
+	std::vector<Cell> _cells;
+	std::vector<CellCoords> _cellCoords; // Released cells lie far outside any range of coordinates.
+	std::vector<UINT> _freeCells;
+	std::vector<Item> _items;
+	std::vector<UINT> _largeItems;
+
+	// Range of cell coordinates that have ever been occupied, limiting raycasts.
+	int _minCell[3] = { 0, 0, 0 }, _maxCell[3] = { -1, -1, -1 };
+	bool _isInitialized = false;
+
+
+	[[nodiscard]] int GetCellCoord(const float value) const
+	{
+		const float coord = std::floor(value * _invCellSize);
+		return static_cast<int>(std::clamp(coord, static_cast<float>(-COORD_BIAS), static_cast<float>(COORD_BIAS - 1)));
+	}
+
+	[[nodiscard]] static std::uint64_t GetCellKey(const int x, const int y, const int z)
+	{
+		return (static_cast<std::uint64_t>(x + COORD_BIAS) & COORD_MASK)
+			| ((static_cast<std::uint64_t>(y + COORD_BIAS) & COORD_MASK) << 21)
+			| ((static_cast<std::uint64_t>(z + COORD_BIAS) & COORD_MASK) << 42);
+	}
+
+	[[nodiscard]] UINT FindCell(const int x, const int y, const int z) const
+	{
+		const auto it = _cellLookup.find(GetCellKey(x, y, z));
+		return (it == _cellLookup.end()) ? NO_CELL : it->second;
+	}
+
+	[[nodiscard]] bool IsLarge(const DirectX::BoundingBox &bounds) const
+	{
+		return bounds.Extents.x > _cellSize || bounds.Extents.y > _cellSize || bounds.Extents.z > _cellSize;
+	}
+
+	// Cell bounds grown by the extents of the largest items in the cell, containing every item stored in it.
+	[[nodiscard]] DirectX::BoundingBox GetLooseBounds(const UINT cellIndex) const
+	{
+		const Cell &cell = _cells[cellIndex];
+		const CellCoords &coords = _cellCoords[cellIndex];
+		const float halfSize = _cellSize * 0.5f;
+		return DirectX::BoundingBox(
+			{ (static_cast<float>(coords.x) + 0.5f) * _cellSize, (static_cast<float>(coords.y) + 0.5f) * _cellSize, (static_cast<float>(coords.z) + 0.5f) * _cellSize },
+			{ halfSize + cell.maxExtents.x, halfSize + cell.maxExtents.y, halfSize + cell.maxExtents.z }
+		);
+	}
+
+
+	void PlaceItem(const UINT slot)
+	{
+		Item &item = _items[slot];
+
+		if (IsLarge(item.bounds))
+		{
+			item.cell = LARGE_ITEMS;
+			item.index = static_cast<UINT>(_largeItems.size());
+			_largeItems.push_back(slot);
+			return;
+		}
+
+		const int
+			x = GetCellCoord(item.bounds.Center.x),
+			y = GetCellCoord(item.bounds.Center.y),
+			z = GetCellCoord(item.bounds.Center.z);
+
+		UINT cellIndex = FindCell(x, y, z);
+		if (cellIndex == NO_CELL)
+		{
+			if (!_freeCells.empty())
+			{
+				cellIndex = _freeCells.back();
+				_freeCells.pop_back();
+			}
+			else
+			{
+				cellIndex = static_cast<UINT>(_cells.size());
+				_cells.emplace_back();
+				_cellCoords.emplace_back();
+			}
+
+			_cells[cellIndex].maxExtents = { 0.0f, 0.0f, 0.0f };
+			_cellCoords[cellIndex] = { x, y, z };
+
+			_cellLookup.emplace(GetCellKey(x, y, z), cellIndex);
+
+			const bool isFirstCell = (_maxCell[0] < _minCell[0]);
+			const int coords[3] = { x, y, z };
+			for (int axis = 0; axis < 3; axis++)
+			{
+				_minCell[axis] = isFirstCell ? coords[axis] : (std::min)(_minCell[axis], coords[axis]);
+				_maxCell[axis] = isFirstCell ? coords[axis] : (std::max)(_maxCell[axis], coords[axis]);
+			}
+		}
+
+		Cell &cell = _cells[cellIndex];
+		item.cell = cellIndex;
+		item.index = static_cast<UINT>(cell.slots.size());
+		cell.slots.push_back(slot);
+
+		cell.maxExtents = {
+			(std::max)(cell.maxExtents.x, item.bounds.Extents.x),
+			(std::max)(cell.maxExtents.y, item.bounds.Extents.y),
+			(std::max)(cell.maxExtents.z, item.bounds.Extents.z)
+		};
+	}
+
+	// Swap-removes the item from its cell or the large item list, releasing the cell if it becomes empty.
+	void UnplaceItem(const UINT slot)
+	{
+		Item &item = _items[slot];
+
+		std::vector<UINT> &slots = (item.cell == LARGE_ITEMS) ? _largeItems : _cells[item.cell].slots;
+		if (item.index + 1 < slots.size())
+		{
+			slots[item.index] = slots.back();
+			_items[slots[item.index]].index = item.index;
+		}
+		slots.pop_back();
+
+		if (item.cell != LARGE_ITEMS && slots.empty())
+		{
+			CellCoords &coords = _cellCoords[item.cell];
+			_cellLookup.erase(GetCellKey(coords.x, coords.y, coords.z));
+			coords = { RELEASED_COORD, RELEASED_COORD, RELEASED_COORD };
+			_freeCells.push_back(item.cell);
+		}
+
+		item.cell = NO_CELL;
+	}
+
+
+	// Adds the items of a cell to the results, testing them individually against the planes it straddles.
+	void CullCell(const UINT cellIndex, const CullingPlanes &planes, std::vector<Entity *> &containingItems) const
+	{
+		VOLUME_TREE_STAT(nodesVisited);
+		VOLUME_TREE_STAT(intersectionTests);
+
+		const Cell &cell = _cells[cellIndex];
+		const UINT planeMask = ClassifyBox(planes, CULLING_ALL_PLANES, GetLooseBounds(cellIndex));
+		if (planeMask == CULLING_OUTSIDE)
+			return;
+
+		for (const UINT slot : cell.slots)
+		{
+			if (planeMask != 0)
+			{
+				VOLUME_TREE_STAT(intersectionTests);
+
+				if (ClassifyBox(planes, planeMask, _items[slot].bounds) == CULLING_OUTSIDE)
+					continue;
+			}
+
+			containingItems.push_back(_items[slot].entity);
+		}
+	}
+
+	// Visits the cells overlapped by the bounding box of the culling shape, or scans every cell if that is cheaper.
+	void Cull(const CullingPlanes &planes, const DirectX::XMFLOAT3 (&corners)[8], std::vector<Entity *> &containingItems) const
+	{
+		for (const UINT slot : _largeItems)
+		{
+			VOLUME_TREE_STAT(intersectionTests);
+
+			if (ClassifyBox(planes, CULLING_ALL_PLANES, _items[slot].bounds) != CULLING_OUTSIDE)
+				containingItems.push_back(_items[slot].entity);
+		}
+
+		DirectX::XMFLOAT3 shapeMin = corners[0], shapeMax = corners[0];
+		for (const DirectX::XMFLOAT3 &corner : corners)
+		{
+			shapeMin = { (std::min)(shapeMin.x, corner.x), (std::min)(shapeMin.y, corner.y), (std::min)(shapeMin.z, corner.z) };
+			shapeMax = { (std::max)(shapeMax.x, corner.x), (std::max)(shapeMax.y, corner.y), (std::max)(shapeMax.z, corner.z) };
+		}
+
+		// Items reach at most one cell size past their cell, so neighbouring cells may hold items inside the shape.
+		const int
+			minX = GetCellCoord(shapeMin.x - _cellSize), maxX = GetCellCoord(shapeMax.x + _cellSize),
+			minY = GetCellCoord(shapeMin.y - _cellSize), maxY = GetCellCoord(shapeMax.y + _cellSize),
+			minZ = GetCellCoord(shapeMin.z - _cellSize), maxZ = GetCellCoord(shapeMax.z + _cellSize);
+
+		const double rangeCellCount =
+			static_cast<double>(maxX - minX + 1) *
+			static_cast<double>(maxY - minY + 1) *
+			static_cast<double>(maxZ - minZ + 1);
+
+		if (rangeCellCount * CELL_LOOKUP_COST > static_cast<double>(_cells.size()))
+		{
+			// Unsigned differences test both ends of each range at once, released cells always fall outside.
+			const unsigned
+				rangeX = static_cast<unsigned>(maxX - minX),
+				rangeY = static_cast<unsigned>(maxY - minY),
+				rangeZ = static_cast<unsigned>(maxZ - minZ);
+
+			const UINT cellCount = static_cast<UINT>(_cellCoords.size());
+			for (UINT cellIndex = 0; cellIndex < cellCount; cellIndex++)
+			{
+				const CellCoords &coords = _cellCoords[cellIndex];
+				const bool inRange =
+					(static_cast<unsigned>(coords.x) - static_cast<unsigned>(minX) <= rangeX) &
+					(static_cast<unsigned>(coords.y) - static_cast<unsigned>(minY) <= rangeY) &
+					(static_cast<unsigned>(coords.z) - static_cast<unsigned>(minZ) <= rangeZ);
+
+				if (inRange)
+					CullCell(cellIndex, planes, containingItems);
+			}
+			return;
+		}
+
+		for (int z = minZ; z <= maxZ; z++)
+			for (int y = minY; y <= maxY; y++)
+				for (int x = minX; x <= maxX; x++)
+				{
+					const UINT cellIndex = FindCell(x, y, z);
+					if (cellIndex != NO_CELL)
+						CullCell(cellIndex, planes, containingItems);
+				}
+	}
+
+
+	// Raycasts the items of every occupied cell within the given range of cell coordinates.
+	void RaycastCells(const int (&minCoords)[3], const int (&maxCoords)[3], const DirectX::XMFLOAT3 &orig, const DirectX::XMFLOAT3 &dir,
+		float &length, Entity *&entity, RaycastItemTest *itemTest) const
+	{
+		const int
+			minX = (std::max)(minCoords[0], _minCell[0]), maxX = (std::min)(maxCoords[0], _maxCell[0]),
+			minY = (std::max)(minCoords[1], _minCell[1]), maxY = (std::min)(maxCoords[1], _maxCell[1]),
+			minZ = (std::max)(minCoords[2], _minCell[2]), maxZ = (std::min)(maxCoords[2], _maxCell[2]);
+
+		for (int z = minZ; z <= maxZ; z++)
+			for (int y = minY; y <= maxY; y++)
+				for (int x = minX; x <= maxX; x++)
+				{
+					const UINT cellIndex = FindCell(x, y, z);
+					if (cellIndex == NO_CELL)
+						continue;
+
+					VOLUME_TREE_STAT(nodesVisited);
+					VOLUME_TREE_STAT(intersectionTests);
+
+					float cellLength = 0.0f;
+					if (!RaycastEntry(orig, dir, GetLooseBounds(cellIndex), cellLength) || cellLength >= length)
+						continue;
+
+					for (const UINT slot : _cells[cellIndex].slots)
+						RaycastItem(orig, dir, _items[slot].entity, _items[slot].bounds, itemTest, length, entity);
+				}
+	}
+
+
+	void NearestCullCell(NearestQuery &query, const UINT cellIndex) const
+	{
+		VOLUME_TREE_STAT(nodesVisited);
+
+		float distanceSq = 0.0f;
+		if (!query.ClassifyNode(GetLooseBounds(cellIndex), distanceSq))
+			return;
+
+		for (const UINT slot : _cells[cellIndex].slots)
+			query.AddItem(_items[slot].entity, _items[slot].bounds, slot);
+	}
+
+	// Skips cells by their coordinates alone while they lie beyond the furthest accepted entity, as items reach at most one cell past their own.
+	void NearestCullAllCells(NearestQuery &query) const
+	{
+		const DirectX::XMFLOAT3 &point = query.GetPoint();
+		const float reach = _cellSize * 1.5f;
+
+		const UINT cellCount = static_cast<UINT>(_cellCoords.size());
+		for (UINT cellIndex = 0; cellIndex < cellCount; cellIndex++)
+		{
+			const CellCoords &coords = _cellCoords[cellIndex];
+			const float
+				dx = (std::max)(std::abs(point.x - (static_cast<float>(coords.x) + 0.5f) * _cellSize) - reach, 0.0f),
+				dy = (std::max)(std::abs(point.y - (static_cast<float>(coords.y) + 0.5f) * _cellSize) - reach, 0.0f),
+				dz = (std::max)(std::abs(point.z - (static_cast<float>(coords.z) + 0.5f) * _cellSize) - reach, 0.0f);
+
+			if (dx * dx + dy * dy + dz * dz > query.GetMaxDistanceSq())
+				continue;
+
+			if (!_cells[cellIndex].slots.empty())
+				NearestCullCell(query, cellIndex);
+		}
+	}
+
+	// Visits the occupied cells at the given Chebyshev distance from the center cell.
+	void NearestCullRing(NearestQuery &query, const int (&center)[3], const int ring) const
+	{
+		auto visit = [&](const int x, const int y, const int z)
+		{
+			const UINT cellIndex = FindCell(x, y, z);
+			if (cellIndex != NO_CELL)
+				NearestCullCell(query, cellIndex);
+		};
+
+		const int
+			minX = (std::max)(center[0] - ring, _minCell[0]), maxX = (std::min)(center[0] + ring, _maxCell[0]),
+			minY = (std::max)(center[1] - ring, _minCell[1]), maxY = (std::min)(center[1] + ring, _maxCell[1]),
+			minZ = (std::max)(center[2] - ring, _minCell[2]), maxZ = (std::min)(center[2] + ring, _maxCell[2]);
+
+		for (int z = minZ; z <= maxZ; z++)
+			for (int y = minY; y <= maxY; y++)
+			{
+				if (std::abs(z - center[2]) == ring || std::abs(y - center[1]) == ring)
+				{
+					for (int x = minX; x <= maxX; x++)
+						visit(x, y, z);
+					continue;
+				}
+
+				// Cells within the ring were visited by earlier rings, leaving only the two ends of the row.
+				if (center[0] - ring >= _minCell[0])
+					visit(center[0] - ring, y, z);
+
+				if (center[0] + ring <= _maxCell[0])
+					visit(center[0] + ring, y, z);
+			}
+	}
+
+
+public:
+	explicit HashGrid(const float cellSize = DEFAULT_CELL_SIZE) :
+		_cellSize(cellSize), _invCellSize(1.0f / cellSize)
+	{
+	}
+
+	~HashGrid() override = default;
+	HashGrid(const HashGrid &other) = delete;
+	HashGrid &operator=(const HashGrid &other) = delete;
+	HashGrid(HashGrid &&other) = delete;
+	HashGrid &operator=(HashGrid &&other) = delete;
+
+	[[nodiscard]] VolumeTreeType GetType() const override
+	{
+		return VolumeTreeType::HASH_GRID;
+	}
+
+	[[nodiscard]] bool Initialize(const DirectX::BoundingBox &sceneBounds) override
+	{
+		if (!(_cellSize > 0.0f))
+			return false;
+
+		ClearSlots();
+		_cellLookup.clear();
+		_cells.clear();
+		_cellCoords.clear();
+		_freeCells.clear();
+		_items.clear();
+		_largeItems.clear();
+
+		std::fill_n(_minCell, 3, 0);
+		std::fill_n(_maxCell, 3, -1);
+
+		_sceneBounds = sceneBounds;
+		_isInitialized = true;
+		return true;
+	}
+
+	[[nodiscard]] bool IsBounded() const override
+	{
+		return false; // Cells are created wherever entities are, the scene bounds are only reported.
+	}
+
+	[[nodiscard]] float GetCellSize() const
+	{
+		return _cellSize;
+	}
+
+	void Insert(Entity *data, const DirectX::BoundingBox &bounds) override
+	{
+		if (!_isInitialized)
+			return;
+
+		const UINT slot = AcquireSlot(data);
+		if (slot >= _items.size())
+			_items.resize(slot + 1);
+
+		Item &item = _items[slot];
+		if (item.cell != NO_CELL)
+			UnplaceItem(slot);
+
+		item.entity = data;
+		item.bounds = bounds;
+		PlaceItem(slot);
+	}
+
+
+	[[nodiscard]] bool Remove(Entity *data, const DirectX::BoundingBox &) override
+	{
+		return Remove(data);
+	}
+
+	[[nodiscard]] bool Remove(Entity *data) override
+	{
+		if (!_isInitialized)
+			return false;
+
+		const auto it = _itemSlots.find(data);
+		if (it == _itemSlots.end())
+			return true;
+
+		UnplaceItem(it->second);
+		_items[it->second] = { };
+		ReleaseSlot(data);
+		return true;
+	}
+
+	[[nodiscard]] bool Move(Entity *data, const DirectX::BoundingBox &bounds) override
+	{
+		if (!_isInitialized)
+			return false;
+
+		const auto it = _itemSlots.find(data);
+		if (it == _itemSlots.end())
+		{
+			Insert(data, bounds);
+			return true;
+		}
+
+		const UINT slot = it->second;
+		Item &item = _items[slot];
+
+		if (item.cell != LARGE_ITEMS && !IsLarge(bounds))
+		{
+			const CellCoords &coords = _cellCoords[item.cell];
+			if (GetCellCoord(bounds.Center.x) == coords.x && GetCellCoord(bounds.Center.y) == coords.y && GetCellCoord(bounds.Center.z) == coords.z)
+			{ // Still in the same cell, only the stored bounds change.
+				Cell &cell = _cells[item.cell];
+				item.bounds = bounds;
+				cell.maxExtents = {
+					(std::max)(cell.maxExtents.x, bounds.Extents.x),
+					(std::max)(cell.maxExtents.y, bounds.Extents.y),
+					(std::max)(cell.maxExtents.z, bounds.Extents.z)
+				};
+				return true;
+			}
+		}
+		else if (item.cell == LARGE_ITEMS && IsLarge(bounds))
+		{
+			item.bounds = bounds;
+			return true;
+		}
+
+		UnplaceItem(slot);
+		item.bounds = bounds;
+		PlaceItem(slot);
+		return true;
+	}
+
+
+	[[nodiscard]] bool FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const override
+	{
+		if (!_isInitialized)
+			return false;
+
+		DirectX::XMFLOAT3 corners[8];
+		frustum.GetCorners(corners);
+
+		Cull(CullingPlanes::FromFrustum(frustum), corners, containingItems);
+		return true;
+	}
+
+	[[nodiscard]] bool BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const override
+	{
+		if (!_isInitialized)
+			return false;
+
+		DirectX::XMFLOAT3 corners[8];
+		box.GetCorners(corners);
+
+		Cull(CullingPlanes::FromOrientedBox(box), corners, containingItems);
+		return true;
+	}
+
+	// Views have no common bounding box, so every occupied cell is classified against the views.
+	[[nodiscard]] bool MultiViewCull(const MultiViewQuery &query) const override
+	{
+		if (!_isInitialized)
+			return false;
+
+		const MultiViewState rootState = query.Begin(_slotCount);
+
+		for (const UINT slot : _largeItems)
+			query.AddItem(rootState, _items[slot].entity, _items[slot].bounds, slot);
+
+		MultiViewState state;
+		const UINT cellCount = static_cast<UINT>(_cells.size());
+		for (UINT cellIndex = 0; cellIndex < cellCount; cellIndex++)
+		{
+			const Cell &cell = _cells[cellIndex];
+			if (cell.slots.empty())
+				continue;
+
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (!query.ClassifyNode(rootState, GetLooseBounds(cellIndex), state))
+				continue;
+
+			for (const UINT slot : cell.slots)
+				query.AddItem(state, _items[slot].entity, _items[slot].bounds, slot);
+		}
+
+		return true;
+	}
+
+
+	// Visits rings of cells around the cell of the query point, stopping once a ring lies beyond the furthest accepted entity.
+	// Once looking up the remaining rings would cost more than scanning every cell, the cells are scanned instead.
+	[[nodiscard]] bool NearestCull(NearestQuery &query) const override
+	{
+		if (!_isInitialized)
+			return false;
+
+		query.Begin(_slotCount);
+
+		for (const UINT slot : _largeItems)
+			query.AddItem(_items[slot].entity, _items[slot].bounds, slot);
+
+		if (_maxCell[0] < _minCell[0])
+			return true;
+
+		const DirectX::XMFLOAT3 &point = query.GetPoint();
+		const int center[3] = { GetCellCoord(point.x), GetCellCoord(point.y), GetCellCoord(point.z) };
+
+		// Rings before the first & after the last reach no occupied cell.
+		int firstRing = 0, lastRing = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			firstRing = (std::max)({ firstRing, _minCell[axis] - center[axis], center[axis] - _maxCell[axis] });
+			lastRing = (std::max)({ lastRing, center[axis] - _minCell[axis], _maxCell[axis] - center[axis] });
+		}
+
+		// Cells within the given ring of the center cell that lie in the occupied range.
+		auto getRangeCellCount = [&](const int ring) -> double
+		{
+			double rangeCellCount = 1.0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				const int
+					rangeMin = (std::max)(center[axis] - ring, _minCell[axis]),
+					rangeMax = (std::min)(center[axis] + ring, _maxCell[axis]);
+				rangeCellCount *= static_cast<double>((std::max)(rangeMax - rangeMin + 1, 0));
+			}
+			return rangeCellCount;
+		};
+
+		for (int ring = firstRing; ring <= lastRing; ring++)
+		{
+			// Until the furthest accepted distance limits the rings, the rings so far stand in for those remaining.
+			double remainingCellCount = getRangeCellCount(ring);
+
+			// The point lies within the center cell & items reach at most one cell past their own,
+			// so no item in a ring is nearer than two cells less than the ring distance.
+			const float maxDistance = std::sqrt(query.GetMaxDistanceSq());
+			if (maxDistance < static_cast<float>(lastRing) * _cellSize)
+			{
+				lastRing = (std::min)(lastRing, static_cast<int>(maxDistance * _invCellSize) + 2);
+				if (ring > lastRing)
+					break;
+
+				remainingCellCount = getRangeCellCount(lastRing) - ((ring > 0) ? getRangeCellCount(ring - 1) : 0.0);
+			}
+
+			if (remainingCellCount * CELL_LOOKUP_COST > static_cast<double>(_cells.size()))
+			{
+				NearestCullAllCells(query);
+				break;
+			}
+
+			NearestCullRing(query, center, ring);
+		}
+
+		return true;
+	}
+
+
+	// Steps through the cells along the ray in order, stopping once the next cell starts beyond the closest hit.
+	bool RaycastTree(const DirectX::XMFLOAT3A &orig, const DirectX::XMFLOAT3A &dir, float &length, Entity *&entity, RaycastItemTest *itemTest) const override
+	{
+		if (!_isInitialized)
+			return false;
+
+		entity = nullptr;
+
+		for (const UINT slot : _largeItems)
+			RaycastItem(orig, dir, _items[slot].entity, _items[slot].bounds, itemTest, length, entity);
+
+		if (_cellLookup.empty())
+			return (entity != nullptr);
+
+		// Only the range of cells that have been occupied, along with their neighbours, can hold items.
+		const DirectX::BoundingBox rangeBounds = DirectX::BoundingBox(
+			{
+				(static_cast<float>(_minCell[0] + _maxCell[0]) * 0.5f + 0.5f) * _cellSize,
+				(static_cast<float>(_minCell[1] + _maxCell[1]) * 0.5f + 0.5f) * _cellSize,
+				(static_cast<float>(_minCell[2] + _maxCell[2]) * 0.5f + 0.5f) * _cellSize
+			},
+			{
+				(static_cast<float>(_maxCell[0] - _minCell[0]) * 0.5f + 1.5f) * _cellSize,
+				(static_cast<float>(_maxCell[1] - _minCell[1]) * 0.5f + 1.5f) * _cellSize,
+				(static_cast<float>(_maxCell[2] - _minCell[2]) * 0.5f + 1.5f) * _cellSize
+			}
+		);
+
+		float cellLength = 0.0f;
+		if (!RaycastEntry(orig, dir, rangeBounds, cellLength) || cellLength >= length)
+			return (entity != nullptr);
+
+		const float
+			origin[3] = { orig.x, orig.y, orig.z },
+			direction[3] = { dir.x, dir.y, dir.z };
+
+		int cellCoords[3], step[3];
+		float nextLength[3], lengthDelta[3];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float entryPoint = origin[axis] + direction[axis] * cellLength;
+			cellCoords[axis] = std::clamp(GetCellCoord(entryPoint), _minCell[axis] - 1, _maxCell[axis] + 1);
+
+			if (direction[axis] == 0.0f)
+			{
+				step[axis] = 0;
+				nextLength[axis] = FLT_MAX;
+				lengthDelta[axis] = FLT_MAX;
+				continue;
+			}
+
+			step[axis] = (direction[axis] > 0.0f) ? 1 : -1;
+			const float boundary = static_cast<float>(cellCoords[axis] + (step[axis] > 0 ? 1 : 0)) * _cellSize;
+			nextLength[axis] = (std::max)(cellLength, (boundary - origin[axis]) / direction[axis]);
+			lengthDelta[axis] = _cellSize / std::abs(direction[axis]);
+		}
+
+		// Items reach into the neighbours of their cell, so the cells around the current one are tested as well.
+		// After each step only the far layer of the new neighbourhood has not been tested yet.
+		int minCoords[3] = { cellCoords[0] - 1, cellCoords[1] - 1, cellCoords[2] - 1 };
+		int maxCoords[3] = { cellCoords[0] + 1, cellCoords[1] + 1, cellCoords[2] + 1 };
+
+		while (cellLength < length)
+		{
+			RaycastCells(minCoords, maxCoords, orig, dir, length, entity, itemTest);
+
+			const int axis = (nextLength[0] < nextLength[1])
+				? ((nextLength[0] < nextLength[2]) ? 0 : 2)
+				: ((nextLength[1] < nextLength[2]) ? 1 : 2);
+
+			if (nextLength[axis] == FLT_MAX)
+				break;
+
+			cellCoords[axis] += step[axis];
+			if (cellCoords[axis] < _minCell[axis] - 1 || cellCoords[axis] > _maxCell[axis] + 1)
+				break;
+
+			cellLength = nextLength[axis];
+			nextLength[axis] += lengthDelta[axis];
+
+			for (int i = 0; i < 3; i++)
+			{
+				minCoords[i] = cellCoords[i] - 1;
+				maxCoords[i] = cellCoords[i] + 1;
+			}
+			minCoords[axis] = maxCoords[axis] = cellCoords[axis] + step[axis];
+		}
+
+		return (entity != nullptr);
+	}
+
+
+	[[nodiscard]] const DirectX::BoundingBox *GetBounds() const override
+	{
+		if (!_isInitialized)
+			return nullptr;
+
+		return &_sceneBounds;
+	}
+
+
+	void DebugGetStructure(std::vector<DirectX::BoundingBox> &boxCollection) const override
+	{
+		const UINT cellCount = static_cast<UINT>(_cells.size());
+		for (UINT cellIndex = 0; cellIndex < cellCount; cellIndex++)
+		{
+			if (!_cells[cellIndex].slots.empty())
+				boxCollection.push_back(GetLooseBounds(cellIndex));
+		}
+	}
+};
@@ -0,0 +1,659 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <utility>
+#include <vector>
+#include <DirectXCollision.h>
+
+#include "VolumeTree.h"
+#include "CullingKernel.h"
+#include "Raycast.h"
+
+
+// Octree stored as a single node array without pointers. Nodes are laid out breadth-first with the eight
+// children of a node stored contiguously in Morton order, and leaves reference ranges of one shared item array.
+// Changes are applied immediately through a small pending list and folded into the array by Update().
+// Node & leaf item bounds are mirrored in component arrays, letting culling classify all eight children at once.
+class LinearOctree final : public VolumeTree
+{
+private:
+	static constexpr UINT MAX_ITEMS_IN_NODE = 24;
+	static constexpr UINT MAX_DEPTH = 4;
+	static constexpr UINT CHILD_COUNT = 8;
+	static constexpr UINT MAX_STACK_SIZE = 1 + MAX_DEPTH * (CHILD_COUNT - 1) + 1;
+	static constexpr UINT MIN_PENDING_FOR_REBUILD = 64;
+	static constexpr UINT CULL_BATCH_SIZE = 64;
+
+	struct Node
+	{
+		DirectX::BoundingBox bounds;
+		UINT firstChild = 0; // Zero for leaves, as the root is never a child.
+		UINT itemStart = 0;
+		UINT itemCount = 0;
+	};
+
+	struct Item
+	{
+		Entity *entity = nullptr;
+		DirectX::BoundingBox bounds;
+		bool isBuilt = false; // False while the item is only found through the pending list.
+		bool isPending = false;
+	};
+
+	std::vector<Node> _nodes;
+	CullingBoxes _nodeBoxes;
+	std::vector<UINT> _leafItems;
+	CullingBoxes _leafItemBoxes; // Bounds of the built items in _leafItems, in the same order.
+	std::vector<Item> _items;
+	std::vector<UINT> _pendingItems;
+	UINT _staleReferences = 0;
+
+
+	void Build()
+	{
+		const DirectX::BoundingBox sceneBounds = _nodes[0].bounds;
+
+		_nodes.clear();
+		_leafItems.clear();
+		_pendingItems.clear();
+		_staleReferences = 0;
+
+		_nodes.push_back({ sceneBounds });
+
+		std::vector<std::vector<UINT>> levelItems(1), nextLevelItems;
+		std::vector<UINT> splitNodes;
+		for (UINT slot = 0; slot < _items.size(); slot++)
+		{
+			Item &item = _items[slot];
+			item.isPending = false;
+			item.isBuilt = item.entity != nullptr && sceneBounds.Intersects(item.bounds);
+
+			if (item.isBuilt)
+				levelItems[0].push_back(slot);
+		}
+
+		UINT levelStart = 0;
+		for (UINT depth = 0; !levelItems.empty(); depth++)
+		{
+			const UINT levelEnd = static_cast<UINT>(_nodes.size());
+			splitNodes.clear();
+
+			// Nodes are split serially, as their children are appended to the node array...
+			for (UINT nodeIndex = levelStart; nodeIndex < levelEnd; nodeIndex++)
+			{
+				std::vector<UINT> &nodeItems = levelItems[nodeIndex - levelStart];
+
+				if (depth >= MAX_DEPTH || nodeItems.size() <= MAX_ITEMS_IN_NODE)
+				{
+					_nodes[nodeIndex].itemStart = static_cast<UINT>(_leafItems.size());
+					_nodes[nodeIndex].itemCount = static_cast<UINT>(nodeItems.size());
+					_leafItems.insert(_leafItems.end(), nodeItems.begin(), nodeItems.end());
+					continue;
+				}
+
+				const DirectX::BoundingBox parentBounds = _nodes[nodeIndex].bounds;
+				const DirectX::XMFLOAT3 childExtents = { parentBounds.Extents.x * 0.5f, parentBounds.Extents.y * 0.5f, parentBounds.Extents.z * 0.5f };
+
+				_nodes[nodeIndex].firstChild = static_cast<UINT>(_nodes.size());
+				splitNodes.push_back(nodeIndex);
+
+				for (UINT i = 0; i < CHILD_COUNT; i++)
+				{
+					Node child;
+					child.bounds.Center = {
+						parentBounds.Center.x + ((i & 1) ? childExtents.x : -childExtents.x),
+						parentBounds.Center.y + ((i & 2) ? childExtents.y : -childExtents.y),
+						parentBounds.Center.z + ((i & 4) ? childExtents.z : -childExtents.z)
+					};
+					child.bounds.Extents = childExtents;
+					_nodes.push_back(child);
+				}
+			}
+
+			nextLevelItems.clear();
+			nextLevelItems.resize(_nodes.size() - levelEnd);
+
+			// ...while the items of the split nodes are distributed to their children in parallel.
+			#pragma omp parallel for schedule(dynamic)
+			for (int i = 0; i < static_cast<int>(splitNodes.size()); i++)
+			{
+				const UINT nodeIndex = splitNodes[i];
+				const std::vector<UINT> &nodeItems = levelItems[nodeIndex - levelStart];
+
+				for (UINT child = 0; child < CHILD_COUNT; child++)
+				{
+					const UINT childIndex = _nodes[nodeIndex].firstChild + child;
+					const DirectX::BoundingBox &childBounds = _nodes[childIndex].bounds;
+
+					std::vector<UINT> &childItems = nextLevelItems[childIndex - levelEnd];
+					for (const UINT slot : nodeItems)
+					{
+						if (childBounds.Intersects(_items[slot].bounds))
+							childItems.push_back(slot);
+					}
+				}
+			}
+
+			levelStart = levelEnd;
+			std::swap(levelItems, nextLevelItems);
+		}
+
+		BuildCullingBoxes();
+	}
+
+	void BuildCullingBoxes()
+	{
+		_nodeBoxes.Clear();
+		_nodeBoxes.Reserve(_nodes.size());
+		for (const Node &node : _nodes)
+			_nodeBoxes.PushBack(node.bounds);
+
+		_leafItemBoxes.Clear();
+		_leafItemBoxes.Reserve(_leafItems.size());
+		for (const UINT slot : _leafItems)
+			_leafItemBoxes.PushBack(_items[slot].bounds);
+	}
+
+	// Moves an item out of the node array & into the pending list, leaving its old leaf references stale.
+	void MarkPending(const UINT slot)
+	{
+		Item &item = _items[slot];
+
+		if (item.isBuilt)
+		{
+			item.isBuilt = false;
+			_staleReferences++;
+		}
+
+		if (!item.isPending && item.entity != nullptr)
+		{
+			item.isPending = true;
+			_pendingItems.push_back(slot);
+		}
+	}
+
+
+	void AddItem(const UINT slot, std::vector<Entity *> &containingItems) const
+	{
+		if (volumeTreeVisitedSet.Visit(slot))
+			containingItems.push_back(_items[slot].entity);
+		else
+			VOLUME_TREE_STAT(duplicateItems);
+	}
+
+	void AddLeafItems(const Node &node, const CullingPlanes &planes, const UINT planeMask, std::vector<Entity *> &containingItems) const
+	{
+		if (planeMask == 0)
+		{ // Leaf is fully inside, no items need testing.
+			for (UINT i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+			{
+				const UINT slot = _leafItems[i];
+				if (_items[slot].isBuilt)
+					AddItem(slot, containingItems);
+			}
+			return;
+		}
+
+		UINT results[CULL_BATCH_SIZE];
+		for (UINT batchStart = node.itemStart; batchStart < node.itemStart + node.itemCount; batchStart += CULL_BATCH_SIZE)
+		{
+			const UINT batchSize = (std::min)(CULL_BATCH_SIZE, node.itemStart + node.itemCount - batchStart);
+			ClassifyBoxes(planes, planeMask, _leafItemBoxes, batchStart, batchSize, results);
+
+			for (UINT i = 0; i < batchSize; i++)
+			{
+				VOLUME_TREE_STAT(intersectionTests);
+
+				const UINT slot = _leafItems[batchStart + i];
+				if (results[i] != CULLING_OUTSIDE && _items[slot].isBuilt)
+					AddItem(slot, containingItems);
+			}
+		}
+	}
+
+	void AddLeafItems(const Node &node, const MultiViewQuery &query, const MultiViewState &state) const
+	{
+		const ViewMask partialViews = state.activeViews & ~state.containedViews;
+
+		ViewMask seenViews[CULL_BATCH_SIZE];
+		UINT results[CULL_BATCH_SIZE];
+
+		for (UINT batchStart = node.itemStart; batchStart < node.itemStart + node.itemCount; batchStart += CULL_BATCH_SIZE)
+		{
+			const UINT batchSize = (std::min)(CULL_BATCH_SIZE, node.itemStart + node.itemCount - batchStart);
+			std::fill_n(seenViews, batchSize, state.containedViews);
+
+			for (ViewMask views = partialViews; views != 0; views &= views - 1)
+			{
+				const UINT view = static_cast<UINT>(std::countr_zero(views));
+				ClassifyBoxes(query.GetView(view), state.planeMasks[view], _leafItemBoxes, batchStart, batchSize, results);
+
+				for (UINT i = 0; i < batchSize; i++)
+				{
+					VOLUME_TREE_STAT(intersectionTests);
+
+					if (results[i] != CULLING_OUTSIDE)
+						seenViews[i] |= ViewMask(1) << view;
+				}
+			}
+
+			for (UINT i = 0; i < batchSize; i++)
+			{
+				const UINT slot = _leafItems[batchStart + i];
+				if (_items[slot].isBuilt)
+					query.AddVisibleItem(_items[slot].entity, slot, seenViews[i]);
+			}
+		}
+	}
+
+	// Built nodes & items are classified against the planes of the shape, passing on only the planes each node
+	// straddles to its children. Pending items are tested against the shape itself.
+	template <typename Shape>
+	void Cull(const Shape &shape, const CullingPlanes &planes, std::vector<Entity *> &containingItems) const
+	{
+		volumeTreeVisitedSet.BeginQuery(_slotCount);
+
+		struct StackEntry { UINT node; UINT planeMask; };
+		StackEntry stack[MAX_STACK_SIZE];
+		UINT stackSize = 0;
+
+		VOLUME_TREE_STAT(intersectionTests);
+
+		UINT rootResult;
+		ClassifyBoxes(planes, CULLING_ALL_PLANES, _nodeBoxes, 0, 1, &rootResult);
+		if (rootResult != CULLING_OUTSIDE)
+			stack[stackSize++] = { 0, rootResult };
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			const Node &node = _nodes[entry.node];
+
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (node.firstChild == 0)
+			{
+				AddLeafItems(node, planes, entry.planeMask, containingItems);
+				continue;
+			}
+
+			if (entry.planeMask == 0)
+			{
+				for (UINT i = 0; i < CHILD_COUNT; i++)
+					stack[stackSize++] = { node.firstChild + i, 0 };
+				continue;
+			}
+
+			UINT childResults[CHILD_COUNT];
+			ClassifyBoxes(planes, entry.planeMask, _nodeBoxes, node.firstChild, CHILD_COUNT, childResults);
+
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+			{
+				VOLUME_TREE_STAT(intersectionTests);
+
+				if (childResults[i] != CULLING_OUTSIDE)
+					stack[stackSize++] = { node.firstChild + i, childResults[i] };
+			}
+		}
+
+		for (const UINT slot : _pendingItems)
+		{
+			VOLUME_TREE_STAT(intersectionTests);
+
+			if (shape.Intersects(_items[slot].bounds))
+				AddItem(slot, containingItems);
+		}
+	}
+
+
+public:
+	LinearOctree() = default;
+	~LinearOctree() override = default;
+	LinearOctree(const LinearOctree &other) = delete;
+	LinearOctree &operator=(const LinearOctree &other) = delete;
+	LinearOctree(LinearOctree &&other) = delete;
+	LinearOctree &operator=(LinearOctree &&other) = delete;
+
+	[[nodiscard]] VolumeTreeType GetType() const override
+	{
+		return VolumeTreeType::LINEAR_OCTREE;
+	}
+
+	[[nodiscard]] bool Initialize(const DirectX::BoundingBox &sceneBounds) override
+	{
+		ClearSlots();
+		_items.clear();
+		_nodes.clear();
+		_nodes.push_back({ sceneBounds });
+		_leafItems.clear();
+		_pendingItems.clear();
+		_staleReferences = 0;
+		BuildCullingBoxes();
+
+		return true;
+	}
+
+	[[nodiscard]] bool Update() override
+	{
+		if (_nodes.empty())
+			return false;
+
+		// Rebuild once the linearly tested pending list costs more than it saves.
+		const size_t rebuildThreshold = (std::max)(static_cast<size_t>(MIN_PENDING_FOR_REBUILD), _leafItems.size() / 8);
+		if (_pendingItems.size() + _staleReferences >= rebuildThreshold)
+			Build();
+
+		return true;
+	}
+
+	void Insert(Entity *data, const DirectX::BoundingBox &bounds) override
+	{
+		if (_nodes.empty())
+			return;
+
+		const UINT slot = AcquireSlot(data);
+		if (slot >= _items.size())
+			_items.resize(slot + 1);
+
+		_items[slot].entity = data;
+		_items[slot].bounds = bounds;
+		MarkPending(slot);
+	}
+
+	// New entities get their slots in Morton order, so the next build walks the items through memory in order.
+	void InsertBulk(std::vector<VolumeTreeItem> &items) override
+	{
+		if (_nodes.empty())
+			return;
+
+		SortByMortonCode(items, _nodes[0].bounds);
+		VolumeTree::InsertBulk(items);
+	}
+
+
+	[[nodiscard]] bool Remove(Entity *data, const DirectX::BoundingBox &) override
+	{
+		return Remove(data);
+	}
+
+	[[nodiscard]] bool Remove(Entity *data) override
+	{
+		if (_nodes.empty())
+			return false;
+
+		const auto it = _itemSlots.find(data);
+		if (it == _itemSlots.end())
+			return true;
+
+		const UINT slot = it->second;
+		Item &item = _items[slot];
+
+		if (item.isBuilt)
+			_staleReferences++;
+
+		if (item.isPending)
+			std::erase(_pendingItems, slot);
+
+		item = { };
+		ReleaseSlot(data);
+		return true;
+	}
+
+	[[nodiscard]] bool Move(Entity *data, const DirectX::BoundingBox &bounds) override
+	{
+		Insert(data, bounds);
+		return true;
+	}
+
+
+	[[nodiscard]] bool FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const override
+	{
+		if (_nodes.empty())
+			return false;
+
+		Cull(frustum, CullingPlanes::FromFrustum(frustum), containingItems);
+		return true;
+	}
+
+	[[nodiscard]] bool BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const override
+	{
+		if (_nodes.empty())
+			return false;
+
+		Cull(box, CullingPlanes::FromOrientedBox(box), containingItems);
+		return true;
+	}
+
+	// Nodes & items are classified one view at a time with the wide kernel, as in Cull().
+	[[nodiscard]] bool MultiViewCull(const MultiViewQuery &query) const override
+	{
+		if (_nodes.empty())
+			return false;
+
+		const MultiViewState rootState = query.Begin(_slotCount);
+
+		struct StackEntry { UINT node; MultiViewState state; };
+		StackEntry stack[MAX_STACK_SIZE];
+		UINT stackSize = 0;
+
+		if (query.ClassifyNode(rootState, _nodes[0].bounds, stack[0].state))
+			stack[stackSize++].node = 0;
+
+		while (stackSize > 0)
+		{
+			// Children overwrite the popped entry, so it is copied out first.
+			const StackEntry entry = stack[--stackSize];
+			const Node &node = _nodes[entry.node];
+			const ViewMask partialViews = entry.state.activeViews & ~entry.state.containedViews;
+
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (node.firstChild == 0)
+			{
+				AddLeafItems(node, query, entry.state);
+				continue;
+			}
+
+			MultiViewState childStates[CHILD_COUNT];
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+				childStates[i] = entry.state;
+
+			for (ViewMask views = partialViews; views != 0; views &= views - 1)
+			{
+				const UINT view = static_cast<UINT>(std::countr_zero(views));
+				const ViewMask viewBit = ViewMask(1) << view;
+
+				UINT childResults[CHILD_COUNT];
+				ClassifyBoxes(query.GetView(view), entry.state.planeMasks[view], _nodeBoxes, node.firstChild, CHILD_COUNT, childResults);
+
+				for (UINT i = 0; i < CHILD_COUNT; i++)
+				{
+					VOLUME_TREE_STAT(intersectionTests);
+
+					if (childResults[i] == CULLING_OUTSIDE)
+						childStates[i].activeViews &= ~viewBit;
+					else if (childResults[i] == 0)
+						childStates[i].containedViews |= viewBit;
+					else
+						childStates[i].planeMasks[view] = static_cast<unsigned char>(childResults[i]);
+				}
+			}
+
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+			{
+				if (childStates[i].activeViews != 0)
+					stack[stackSize++] = { node.firstChild + i, childStates[i] };
+			}
+		}
+
+		for (const UINT slot : _pendingItems)
+			query.AddItem(rootState, _items[slot].entity, _items[slot].bounds, slot);
+
+		return true;
+	}
+
+	[[nodiscard]] bool NearestCull(NearestQuery &query) const override
+	{
+		if (_nodes.empty())
+			return false;
+
+		query.Begin(_slotCount);
+
+		for (const UINT slot : _pendingItems)
+			query.AddItem(_items[slot].entity, _items[slot].bounds, slot);
+
+		struct StackEntry { UINT node; float distanceSq; };
+		StackEntry stack[MAX_STACK_SIZE];
+		UINT stackSize = 0;
+
+		float rootDistanceSq = 0.0f;
+		if (query.ClassifyNode(_nodes[0].bounds, rootDistanceSq))
+			stack[stackSize++] = { 0, rootDistanceSq };
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			if (entry.distanceSq > query.GetMaxDistanceSq())
+				continue;
+
+			const Node &node = _nodes[entry.node];
+
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (node.firstChild == 0)
+			{
+				for (UINT i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+				{
+					const UINT slot = _leafItems[i];
+					if (_items[slot].isBuilt)
+						query.AddItem(_items[slot].entity, _items[slot].bounds, slot);
+				}
+				continue;
+			}
+
+			StackEntry childDistances[CHILD_COUNT];
+			UINT childCount = 0;
+
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+			{
+				const UINT childIndex = node.firstChild + i;
+
+				float childDistanceSq = 0.0f;
+				if (!query.ClassifyNode(_nodes[childIndex].bounds, childDistanceSq))
+					continue;
+
+				// Insertion sort, furthest first so the nearest child is popped first.
+				UINT j = childCount++;
+				while (j > 0 && childDistances[j - 1].distanceSq < childDistanceSq)
+				{
+					childDistances[j] = childDistances[j - 1];
+					j--;
+				}
+				childDistances[j] = { childIndex, childDistanceSq };
+			}
+
+			for (UINT i = 0; i < childCount; i++)
+				stack[stackSize++] = childDistances[i];
+		}
+
+		return true;
+	}
+
+	bool RaycastTree(const DirectX::XMFLOAT3A &orig, const DirectX::XMFLOAT3A &dir, float &length, Entity *&entity, RaycastItemTest *itemTest) const override
+	{
+		if (_nodes.empty())
+			return false;
+
+		entity = nullptr;
+
+		auto testItem = [&](const UINT slot)
+		{
+			RaycastItem(orig, dir, _items[slot].entity, _items[slot].bounds, itemTest, length, entity);
+		};
+
+		for (const UINT slot : _pendingItems)
+			testItem(slot);
+
+		struct StackEntry { UINT node; float length; };
+		StackEntry stack[MAX_STACK_SIZE];
+		UINT stackSize = 0;
+
+		float rootLength = FLT_MAX; // In case Intersects() uses the initial dist value as a maximum. Docs don't specify.
+		if (!Raycast(orig, dir, _nodes[0].bounds, rootLength))
+			return (entity != nullptr);
+
+		stack[stackSize++] = { 0, 0.0f };
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			if (entry.length >= length)
+				continue;
+
+			const Node &node = _nodes[entry.node];
+
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (node.firstChild == 0)
+			{ // Check all items in leaf for intersection.
+				for (UINT i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+				{
+					if (_items[_leafItems[i]].isBuilt)
+						testItem(_leafItems[i]);
+				}
+				continue;
+			}
+
+			StackEntry childHits[CHILD_COUNT];
+			UINT childHitCount = 0;
+
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+			{
+				const UINT childIndex = node.firstChild + i;
+				const DirectX::BoundingBox &childBounds = _nodes[childIndex].bounds;
+
+				VOLUME_TREE_STAT(intersectionTests);
+
+				float childLength = 0.0f;
+				if (childBounds.Contains(DirectX::XMLoadFloat3(&orig)) == DirectX::DISJOINT)
+				{
+					if (!Raycast(orig, dir, childBounds, childLength) || childLength >= length)
+						continue;
+				}
+
+				// Insertion sort, furthest first so the closest child is popped first.
+				UINT j = childHitCount++;
+				while (j > 0 && childHits[j - 1].length < childLength)
+				{
+					childHits[j] = childHits[j - 1];
+					j--;
+				}
+				childHits[j] = { childIndex, childLength };
+			}
+
+			for (UINT i = 0; i < childHitCount; i++)
+				stack[stackSize++] = childHits[i];
+		}
+
+		return (entity != nullptr);
+	}
+
+
+	[[nodiscard]] const DirectX::BoundingBox *GetBounds() const override
+	{
+		if (_nodes.empty())
+			return nullptr;
+
+		return &_nodes[0].bounds;
+	}
+
+
+	void DebugGetStructure(std::vector<DirectX::BoundingBox> &boxCollection) const override
+	{
+		for (const Node &node : _nodes)
+		{
+			if (node.firstChild == 0)
+				boxCollection.push_back(node.bounds);
+		}
+	}
+};
@@ -0,0 +1,567 @@
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <DirectXCollision.h>
+
+#include "VolumeTree.h"
+#include "Raycast.h"
+
+
+// Octree where every node's bounds are enlarged by LOOSENESS, letting each entity be stored in exactly one node.
+// Entities are placed in the deepest node that fully contains them, chosen by the octant of their center.
+class LooseOctree final : public VolumeTree
+{
+private:
+	static constexpr UINT MAX_ITEMS_IN_NODE = 48;
+	static constexpr UINT MAX_DEPTH = 5;
+	static constexpr UINT CHILD_COUNT = 8;
+	static constexpr float LOOSENESS = 2.0f;
+
+	struct Node;
+
+	// Back-reference from an item slot to the node storing it, making removal O(1).
+	struct ItemLocation
+	{
+		Node *node = nullptr;
+		UINT index = 0;
+	};
+
+
+	struct Node
+	{
+		std::vector<VolumeTreeItem> data;
+		DirectX::BoundingBox bounds;
+		DirectX::BoundingBox looseBounds;
+		std::unique_ptr<Node> children[CHILD_COUNT];
+		Node *parent = nullptr;
+		UINT depth = 0;
+		UINT subtreeItemCount = 0;
+		bool isLeaf = true;
+
+
+		[[nodiscard]] UINT GetChildIndex(const DirectX::XMFLOAT3 &point) const
+		{
+			return (point.x >= bounds.Center.x ? 1 : 0)
+				| (point.z >= bounds.Center.z ? 2 : 0)
+				| (point.y >= bounds.Center.y ? 4 : 0);
+		}
+
+		[[nodiscard]] bool Fits(const DirectX::BoundingBox &itemBounds) const
+		{
+			return std::abs(itemBounds.Center.x - looseBounds.Center.x) + itemBounds.Extents.x <= looseBounds.Extents.x
+				&& std::abs(itemBounds.Center.y - looseBounds.Center.y) + itemBounds.Extents.y <= looseBounds.Extents.y
+				&& std::abs(itemBounds.Center.z - looseBounds.Center.z) + itemBounds.Extents.z <= looseBounds.Extents.z;
+		}
+
+		// Returns the child the item would be stored in, or nullptr if it belongs in this node.
+		[[nodiscard]] Node *GetFittingChild(const DirectX::BoundingBox &itemBounds) const
+		{
+			if (isLeaf)
+				return nullptr;
+
+			Node *child = children[GetChildIndex(itemBounds.Center)].get();
+			return child->Fits(itemBounds) ? child : nullptr;
+		}
+
+
+		void Split(std::vector<ItemLocation> &locations)
+		{
+			const DirectX::XMFLOAT3
+				center = bounds.Center,
+				childExtents = { bounds.Extents.x * 0.5f, bounds.Extents.y * 0.5f, bounds.Extents.z * 0.5f };
+
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+			{
+				children[i] = std::make_unique<Node>();
+				Node *child = children[i].get();
+
+				child->bounds.Center = {
+					center.x + ((i & 1) ? childExtents.x : -childExtents.x),
+					center.y + ((i & 4) ? childExtents.y : -childExtents.y),
+					center.z + ((i & 2) ? childExtents.z : -childExtents.z)
+				};
+				child->bounds.Extents = childExtents;
+
+				child->looseBounds.Center = child->bounds.Center;
+				child->looseBounds.Extents = { childExtents.x * LOOSENESS, childExtents.y * LOOSENESS, childExtents.z * LOOSENESS };
+
+				child->parent = this;
+				child->depth = depth + 1;
+			}
+
+			isLeaf = false;
+
+			// Push down every item that fits in a child, keeping the rest in place.
+			std::vector<VolumeTreeItem> remainingItems;
+			remainingItems.reserve(data.size());
+
+			for (const VolumeTreeItem &item : data)
+			{
+				if (Node *child = GetFittingChild(item.bounds))
+				{
+					child->Insert(item, locations);
+					continue;
+				}
+
+				locations[item.slot] = { this, static_cast<UINT>(remainingItems.size()) };
+				remainingItems.push_back(item);
+			}
+
+			data = std::move(remainingItems);
+		}
+
+		// Gathers all items in the subtree into this node & removes its children.
+		void Collapse(std::vector<ItemLocation> &locations)
+		{
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+			{
+				Node *child = children[i].get();
+				if (!child->isLeaf)
+					child->Collapse(locations);
+
+				for (const VolumeTreeItem &item : child->data)
+				{
+					locations[item.slot] = { this, static_cast<UINT>(data.size()) };
+					data.push_back(item);
+				}
+
+				children[i].reset();
+			}
+
+			isLeaf = true;
+		}
+
+
+		void Insert(const VolumeTreeItem &item, std::vector<ItemLocation> &locations)
+		{
+			VOLUME_TREE_STAT(nodesVisited);
+
+			subtreeItemCount++;
+
+			if (isLeaf && depth < MAX_DEPTH && data.size() >= MAX_ITEMS_IN_NODE)
+				Split(locations);
+
+			VOLUME_TREE_STAT(intersectionTests);
+			if (Node *child = GetFittingChild(item.bounds))
+			{
+				child->Insert(item, locations);
+				return;
+			}
+
+			locations[item.slot] = { this, static_cast<UINT>(data.size()) };
+			data.push_back(item);
+		}
+
+		// Swap-removes the item at the given index without updating subtree counts.
+		void Erase(const UINT index, std::vector<ItemLocation> &locations)
+		{
+			if (index + 1 < data.size())
+			{
+				data[index] = std::move(data.back());
+				locations[data[index].slot].index = index;
+			}
+
+			data.pop_back();
+		}
+
+
+		void AddToVector(std::vector<Entity *> &containingItems) const
+		{
+			VOLUME_TREE_STAT(nodesVisited);
+
+			for (const VolumeTreeItem &item : data)
+				containingItems.push_back(item.entity);
+
+			if (isLeaf)
+				return;
+
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+			{
+				if (children[i]->subtreeItemCount > 0)
+					children[i]->AddToVector(containingItems);
+			}
+		}
+
+		template <typename Shape>
+		void Cull(const Shape &shape, std::vector<Entity *> &containingItems) const
+		{
+			VOLUME_TREE_STAT(nodesVisited);
+			VOLUME_TREE_STAT(intersectionTests);
+
+			switch (shape.Contains(looseBounds))
+			{
+				case DirectX::DISJOINT:
+					return;
+
+				case DirectX::CONTAINS:
+					AddToVector(containingItems);
+					return;
+
+				case DirectX::INTERSECTS:
+					// Loose bounds overlap their neighbours, so items are tested individually.
+					for (const VolumeTreeItem &item : data)
+					{
+						VOLUME_TREE_STAT(intersectionTests);
+
+						if (shape.Intersects(item.bounds))
+							containingItems.push_back(item.entity);
+					}
+
+					if (isLeaf)
+						return;
+
+					for (UINT i = 0; i < CHILD_COUNT; i++)
+					{
+						if (children[i]->subtreeItemCount > 0)
+							children[i]->Cull(shape, containingItems);
+					}
+					return;
+			}
+		}
+
+
+		void MultiViewCull(const MultiViewQuery &query, const MultiViewState &parentState) const
+		{
+			VOLUME_TREE_STAT(nodesVisited);
+
+			MultiViewState state;
+			if (!query.ClassifyNode(parentState, looseBounds, state))
+				return;
+
+			for (const VolumeTreeItem &item : data)
+				query.AddItem(state, item.entity, item.bounds, item.slot);
+
+			if (isLeaf)
+				return;
+
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+			{
+				if (children[i]->subtreeItemCount > 0)
+					children[i]->MultiViewCull(query, state);
+			}
+		}
+
+
+		void NearestCull(NearestQuery &query) const
+		{
+			VOLUME_TREE_STAT(nodesVisited);
+
+			for (const VolumeTreeItem &item : data)
+				query.AddItem(item.entity, item.bounds, item.slot);
+
+			if (isLeaf)
+				return;
+
+			struct ChildDistance { UINT index; float distanceSq; };
+			ChildDistance childDistances[CHILD_COUNT];
+			UINT childCount = 0;
+
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+			{
+				if (children[i]->subtreeItemCount == 0)
+					continue;
+
+				float childDistanceSq = 0.0f;
+				if (!query.ClassifyNode(children[i]->looseBounds, childDistanceSq))
+					continue;
+
+				// Insertion sort by distance.
+				UINT j = childCount++;
+				while (j > 0 && childDistances[j - 1].distanceSq > childDistanceSq)
+				{
+					childDistances[j] = childDistances[j - 1];
+					j--;
+				}
+				childDistances[j] = { i, childDistanceSq };
+			}
+
+			// Visit children from nearest to furthest, skipping any beyond the furthest accepted entity so far.
+			for (UINT i = 0; i < childCount; i++)
+			{
+				if (childDistances[i].distanceSq > query.GetMaxDistanceSq())
+					break;
+
+				children[childDistances[i].index]->NearestCull(query);
+			}
+		}
+
+
+		void RaycastNode(const DirectX::XMFLOAT3 &orig, const DirectX::XMFLOAT3 &dir, float &length, Entity *&entity, RaycastItemTest *itemTest) const
+		{
+			VOLUME_TREE_STAT(nodesVisited);
+
+			for (const VolumeTreeItem &item : data)
+				RaycastItem(orig, dir, item.entity, item.bounds, itemTest, length, entity);
+
+			if (isLeaf)
+				return;
+
+			struct ChildHit { UINT index; float length; };
+			ChildHit childHits[CHILD_COUNT];
+			UINT childHitCount = 0;
+
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+			{
+				const Node *child = children[i].get();
+				if (child->subtreeItemCount == 0)
+					continue;
+
+				VOLUME_TREE_STAT(intersectionTests);
+
+				float childLength = 0.0f;
+				if (!RaycastEntry(orig, dir, child->looseBounds, childLength))
+					continue;
+
+				if (childLength >= length)
+					continue;
+
+				// Insertion sort by length.
+				UINT j = childHitCount++;
+				while (j > 0 && childHits[j - 1].length > childLength)
+				{
+					childHits[j] = childHits[j - 1];
+					j--;
+				}
+				childHits[j] = { i, childLength };
+			}
+
+			// Visit children from closest to furthest, skipping any that start beyond the closest hit so far.
+			for (UINT i = 0; i < childHitCount; i++)
+			{
+				if (childHits[i].length >= length)
+					break;
+
+				children[childHits[i].index]->RaycastNode(orig, dir, length, entity, itemTest);
+			}
+		}
+
+
+		void DebugGetStructure(std::vector<DirectX::BoundingBox> &boxCollection) const
+		{
+			if (isLeaf)
+			{
+				boxCollection.push_back(looseBounds);
+				return;
+			}
+
+			for (UINT i = 0; i < CHILD_COUNT; i++)
+				children[i]->DebugGetStructure(boxCollection);
+		}
+	};
+
+	std::unique_ptr<Node> _root;
+	std::vector<ItemLocation> _locations;
+
+
+	// Removes the item in the given slot from its node, keeping the slot itself.
+	void EraseSlot(const UINT slot)
+	{
+		ItemLocation &location = _locations[slot];
+		Node *node = location.node;
+
+		node->Erase(location.index, _locations);
+		location = { };
+
+		for (Node *ancestor = node; ancestor != nullptr; ancestor = ancestor->parent)
+			ancestor->subtreeItemCount--;
+	}
+
+	// Collapses the largest subtree around the node that has become sparse enough to fit in a single node.
+	void TryCollapse(Node *node)
+	{
+		Node *collapseRoot = nullptr;
+		for (Node *ancestor = node; ancestor != nullptr; ancestor = ancestor->parent)
+		{
+			if (!ancestor->isLeaf && ancestor->subtreeItemCount <= MAX_ITEMS_IN_NODE / 2)
+				collapseRoot = ancestor;
+		}
+
+		if (collapseRoot != nullptr)
+			collapseRoot->Collapse(_locations);
+	}
+
+
+public:
+	LooseOctree() = default;
+	~LooseOctree() override = default;
+	LooseOctree(const LooseOctree &other) = delete;
+	LooseOctree &operator=(const LooseOctree &other) = delete;
+	LooseOctree(LooseOctree &&other) = delete;
+	LooseOctree &operator=(LooseOctree &&other) = delete;
+
+	[[nodiscard]] VolumeTreeType GetType() const override
+	{
+		return VolumeTreeType::LOOSE_OCTREE;
+	}
+
+	[[nodiscard]] bool Initialize(const DirectX::BoundingBox &sceneBounds) override
+	{
+		_root = std::make_unique<Node>();
+		ClearSlots();
+		_locations.clear();
+
+		_root->bounds = sceneBounds;
+		_root->looseBounds = sceneBounds;
+
+		return true;
+	}
+
+	void Insert(Entity *data, const DirectX::BoundingBox &bounds) override
+	{
+		if (_root == nullptr)
+			return;
+
+		// Queries never look outside the scene bounds, so entities not lying fully within them are rejected.
+		if (_root->bounds.Contains(bounds) != DirectX::CONTAINS)
+		{
+			(void)Remove(data);
+			return;
+		}
+
+		const UINT slot = AcquireSlot(data);
+		if (slot >= _locations.size())
+			_locations.resize(slot + 1);
+
+		if (_locations[slot].node != nullptr)
+			EraseSlot(slot);
+
+		_root->Insert({ data, bounds, slot }, _locations);
+	}
+
+
+	[[nodiscard]] bool Remove(Entity *data, const DirectX::BoundingBox &) override
+	{
+		return Remove(data);
+	}
+
+	[[nodiscard]] bool Remove(Entity *data) override
+	{
+		if (_root == nullptr)
+			return false;
+
+		const auto it = _itemSlots.find(data);
+		if (it == _itemSlots.end())
+			return true;
+
+		Node *node = _locations[it->second].node;
+		EraseSlot(it->second);
+		ReleaseSlot(data);
+		TryCollapse(node);
+		return true;
+	}
+
+	[[nodiscard]] bool Move(Entity *data, const DirectX::BoundingBox &bounds) override
+	{
+		if (_root == nullptr)
+			return false;
+
+		const auto it = _itemSlots.find(data);
+		if (it == _itemSlots.end())
+		{
+			Insert(data, bounds);
+			return true;
+		}
+
+		if (_root->bounds.Contains(bounds) != DirectX::CONTAINS)
+			return Remove(data);
+
+		const UINT slot = it->second;
+		Node *node = _locations[slot].node;
+
+		if ((node == _root.get() || node->Fits(bounds)) && node->GetFittingChild(bounds) == nullptr)
+		{ // Still belongs in the same node, only the stored bounds need updating.
+			node->data[_locations[slot].index].bounds = bounds;
+			return true;
+		}
+
+		EraseSlot(slot);
+
+		// Reinsert from the closest ancestor that can contain the new bounds.
+		Node *insertRoot = node;
+		while (insertRoot->parent != nullptr && !insertRoot->Fits(bounds))
+			insertRoot = insertRoot->parent;
+
+		for (Node *ancestor = insertRoot->parent; ancestor != nullptr; ancestor = ancestor->parent)
+			ancestor->subtreeItemCount++;
+
+		insertRoot->Insert({ data, bounds, slot }, _locations);
+		return true;
+	}
+
+
+	[[nodiscard]] bool FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const override
+	{
+		if (_root == nullptr)
+			return false;
+
+		_root->Cull(frustum, containingItems);
+		return true;
+	}
+
+	[[nodiscard]] bool BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const override
+	{
+		if (_root == nullptr)
+			return false;
+
+		_root->Cull(box, containingItems);
+		return true;
+	}
+
+	[[nodiscard]] bool MultiViewCull(const MultiViewQuery &query) const override
+	{
+		if (_root == nullptr)
+			return false;
+
+		_root->MultiViewCull(query, query.Begin(_slotCount));
+		return true;
+	}
+
+
+	[[nodiscard]] bool NearestCull(NearestQuery &query) const override
+	{
+		if (_root == nullptr)
+			return false;
+
+		query.Begin(_slotCount);
+
+		float distanceSq = 0.0f;
+		if (query.ClassifyNode(_root->looseBounds, distanceSq))
+			_root->NearestCull(query);
+
+		return true;
+	}
+
+
+	bool RaycastTree(const DirectX::XMFLOAT3A &orig, const DirectX::XMFLOAT3A &dir, float &length, Entity *&entity, RaycastItemTest *itemTest) const override
+	{
+		if (_root == nullptr)
+			return false;
+
+		entity = nullptr;
+
+		_root->RaycastNode(orig, dir, length, entity, itemTest);
+		return (entity != nullptr);
+	}
+
+
+	[[nodiscard]] const DirectX::BoundingBox *GetBounds() const override
+	{
+		if (_root == nullptr)
+			return nullptr;
+
+		return &_root->bounds;
+	}
+
+
+	void DebugGetStructure(std::vector<DirectX::BoundingBox> &boxCollection) const override
+	{
+		if (_root == nullptr)
+			return;
+
+		_root->DebugGetStructure(boxCollection);
+	}
+};
@@ -42,6 +42,14 @@ bool MeshD3D11::Initialize(ID3D11Device *device, const MeshData &meshInfo)
 		_subMeshes.push_back(std::move(subMesh));
 	}
 
+	if (!_triangleBvh.Build(
+		meshInfo.vertexInfo.vertexData, meshInfo.vertexInfo.sizeOfVertex, meshInfo.vertexInfo.nrOfVerticesInBuffer,
+		meshInfo.indexInfo.indexData, meshInfo.indexInfo.nrOfIndicesInBuffer))
+	{
+		ErrMsg("Failed to build triangle BVH!");
+		return false;
+	}
+
 	_boundingBox = meshInfo.boundingBox;
 	//_mtlFile = meshInfo.mtlFile;
 
@@ -83,6 +91,11 @@ const std::string &MeshD3D11::GetMaterialFile() const
 	return _mtlFile;
 }
 
+const TriangleBvh &MeshD3D11::GetTriangleBvh() const
+{
+	return _triangleBvh;
+}
+
 
 UINT MeshD3D11::GetNrOfSubMeshes() const
 {
@@ -7,6 +7,7 @@
 #include "SubMeshD3D11.h"
 #include "VertexBufferD3D11.h"
 #include "IndexBufferD3D11.h"
+#include "TriangleBvh.h"
 
 
 struct MeshData
@@ -52,6 +53,7 @@ private:
 	IndexBufferD3D11 _indexBuffer;
 	std::string _mtlFile;
 	DirectX::BoundingBox _boundingBox;
+	TriangleBvh _triangleBvh;
 
 
 public:
@@ -69,6 +71,7 @@ public:
 
 	[[nodiscard]] const DirectX::BoundingBox &GetBoundingBox() const;
 	[[nodiscard]] const std::string &GetMaterialFile() const;
+	[[nodiscard]] const TriangleBvh &GetTriangleBvh() const;
 
 	[[nodiscard]] UINT GetNrOfSubMeshes() const;
 	[[nodiscard]] const std::string &GetAmbientPath(UINT subMeshIndex) const;
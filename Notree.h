@@ -1,26 +1,31 @@
 #pragma once
 
+#include <algorithm>
+#include <cfloat>
 #include <memory>
 #include <utility>
 #include <vector>
 #include <DirectXCollision.h>
 
-#include "Entity.h"
+#include "VolumeTree.h"
 #include "Raycast.h"
 
 
-class Notree
+class Notree final : public VolumeTree
 {
 private:
 	struct Node
 	{
-		std::vector<Entity *> data;
+		std::vector<VolumeTreeItem> data;
 		DirectX::BoundingBox bounds;
 
 
-		bool Insert(Entity *item, const DirectX::BoundingBox &itemBounds)
+		bool Insert(const VolumeTreeItem &item)
 		{
-			if (!bounds.Intersects(itemBounds))
+			VOLUME_TREE_STAT(nodesVisited);
+			VOLUME_TREE_STAT(intersectionTests);
+
+			if (!bounds.Intersects(item.bounds))
 				return false;
 
 			data.push_back(item);
@@ -29,24 +34,34 @@ private:
 
 		void Remove(Entity *item, const DirectX::BoundingBox &itemBounds, const bool skipIntersection = false)
 		{
+			VOLUME_TREE_STAT(nodesVisited);
+
 			if (!skipIntersection)
+			{
+				VOLUME_TREE_STAT(intersectionTests);
+
 				if (!bounds.Intersects(itemBounds))
 					return;
+			}
 
-			std::erase_if(data, [item](const Entity *otherItem) { return item == otherItem; });
+			std::erase_if(data, [item](const VolumeTreeItem &otherItem) { return item == otherItem.entity; });
 			return;
 		}
 
 
 		void AddToVector(std::vector<Entity *> &containingItems) const
 		{
-			for (Entity *item : data)
+			VOLUME_TREE_STAT(nodesVisited);
+
+			for (const VolumeTreeItem &item : data)
 			{
-				if (item == nullptr)
+				if (item.entity == nullptr)
 					continue;
 
-				if (std::ranges::find(containingItems, item) == containingItems.end())
-					containingItems.push_back(item);
+				if (volumeTreeVisitedSet.Visit(item.slot))
+					containingItems.push_back(item.entity);
+				else
+					VOLUME_TREE_STAT(duplicateItems);
 			}
 
 			return;
@@ -54,6 +69,9 @@ private:
 
 		void FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const
 		{
+			VOLUME_TREE_STAT(nodesVisited);
+			VOLUME_TREE_STAT(intersectionTests);
+
 			switch (frustum.Contains(bounds))
 			{
 				case DirectX::DISJOINT:
@@ -64,13 +82,15 @@ private:
 					break;
 
 				case DirectX::INTERSECTS:
-					for (Entity *item : data)
+					for (const VolumeTreeItem &item : data)
 					{
-						if (item == nullptr)
+						if (item.entity == nullptr)
 							continue;
 
-						if (std::ranges::find(containingItems, item) == containingItems.end())
-							containingItems.push_back(item);
+						if (volumeTreeVisitedSet.Visit(item.slot))
+							containingItems.push_back(item.entity);
+						else
+							VOLUME_TREE_STAT(duplicateItems);
 					}
 					return;
 			}
@@ -78,6 +98,9 @@ private:
 
 		void BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const
 		{
+			VOLUME_TREE_STAT(nodesVisited);
+			VOLUME_TREE_STAT(intersectionTests);
+
 			switch (box.Contains(bounds))
 			{
 				case DirectX::DISJOINT:
@@ -88,42 +111,58 @@ private:
 					break;
 
 				case DirectX::INTERSECTS:
-					for (Entity *item : data)
+					for (const VolumeTreeItem &item : data)
 					{
-						if (item == nullptr)
+						if (item.entity == nullptr)
 							continue;
 
-						if (std::ranges::find(containingItems, item) == containingItems.end())
-							containingItems.push_back(item);
+						if (volumeTreeVisitedSet.Visit(item.slot))
+							containingItems.push_back(item.entity);
+						else
+							VOLUME_TREE_STAT(duplicateItems);
 					}
 					return;
 			}
 		}
 
 
-		bool RaycastNode(const DirectX::XMFLOAT3 &orig, const DirectX::XMFLOAT3 &dir, float &length, Entity *&entity) const
+		void MultiViewCull(const MultiViewQuery &query, const MultiViewState &parentState) const
 		{
-			// Check all items in leaf for intersection & return result.
-			for (Entity *item : data)
+			VOLUME_TREE_STAT(nodesVisited);
+
+			MultiViewState state;
+			if (!query.ClassifyNode(parentState, bounds, state))
+				return;
+
+			for (const VolumeTreeItem &item : data)
 			{
-				if (item == nullptr)
-					continue;
+				if (item.entity != nullptr)
+					query.AddItem(state, item.entity, item.bounds, item.slot);
+			}
+		}
 
-				DirectX::BoundingBox itemBounds;
-				item->StoreBounds(itemBounds);
 
-				float newLength = 0.0f;
-				if (Raycast(orig, dir, itemBounds, newLength))
-				{
-					if (newLength < 0.0f)
-						continue;
+		void NearestCull(NearestQuery &query) const
+		{
+			VOLUME_TREE_STAT(nodesVisited);
 
-					if (newLength >= length)
-						continue;
+			for (const VolumeTreeItem &item : data)
+			{
+				if (item.entity != nullptr)
+					query.AddItem(item.entity, item.bounds, item.slot);
+			}
+		}
 
-					length = newLength;
-					entity = item;
-				}
+
+		bool RaycastNode(const DirectX::XMFLOAT3 &orig, const DirectX::XMFLOAT3 &dir, float &length, Entity *&entity, RaycastItemTest *itemTest) const
+		{
+			VOLUME_TREE_STAT(nodesVisited);
+
+			// Check all items in leaf for intersection & return result.
+			for (const VolumeTreeItem &item : data)
+			{
+				if (item.entity != nullptr)
+					RaycastItem(orig, dir, item.entity, item.bounds, itemTest, length, entity);
 			}
 
 			return (entity != nullptr);
@@ -142,66 +181,105 @@ private:
 
 public:
 	Notree() = default;
-	~Notree() = default;
+	~Notree() override = default;
 	Notree(const Notree &other) = delete;
 	Notree &operator=(const Notree &other) = delete;
 	Notree(Notree &&other) = delete;
 	Notree &operator=(Notree &&other) = delete;
 
-	[[nodiscard]] bool Initialize(const DirectX::BoundingBox &sceneBounds)
+	[[nodiscard]] VolumeTreeType GetType() const override
+	{
+		return VolumeTreeType::NOTREE;
+	}
+
+	[[nodiscard]] bool Initialize(const DirectX::BoundingBox &sceneBounds) override
 	{
 		_root = std::make_unique<Node>();
+		ClearSlots();
 		_root->bounds = sceneBounds;
 
 		return true;
 	}
 
-	void Insert(Entity *data, const DirectX::BoundingBox &bounds) const
+	void Insert(Entity *data, const DirectX::BoundingBox &bounds) override
 	{
-		if (_root != nullptr)
-			_root->Insert(data, bounds);
+		// Entities outside the root are not stored, so they are given no slot.
+		if (_root != nullptr && _root->bounds.Intersects(bounds))
+			_root->Insert({ data, bounds, AcquireSlot(data) });
 	}
 
 
-	[[nodiscard]] bool Remove(Entity *data, const DirectX::BoundingBox &bounds) const
+	[[nodiscard]] bool Remove(Entity *data, const DirectX::BoundingBox &bounds) override
 	{
 		if (_root == nullptr)
 			return false;
 
 		_root->Remove(data, bounds);
+		ReleaseSlot(data);
 		return true;
 	}
 
-	[[nodiscard]] bool Remove(Entity *data) const
+	[[nodiscard]] bool Remove(Entity *data) override
 	{
 		if (_root == nullptr)
 			return false;
 
 		_root->Remove(data, _root->bounds, true);
+		ReleaseSlot(data);
+		return true;
+	}
+
+	[[nodiscard]] bool Move(Entity *data, const DirectX::BoundingBox &bounds) override
+	{
+		if (!Remove(data))
+			return false;
+
+		Insert(data, bounds);
 		return true;
 	}
 
 
-	[[nodiscard]] bool FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const
+	[[nodiscard]] bool FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const override
 	{
 		if (_root == nullptr)
 			return false;
 
+		volumeTreeVisitedSet.BeginQuery(_slotCount);
 		_root->FrustumCull(frustum, containingItems);
 		return true;
 	}
 
-	[[nodiscard]] bool BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const
+	[[nodiscard]] bool BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const override
 	{
 		if (_root == nullptr)
 			return false;
 
+		volumeTreeVisitedSet.BeginQuery(_slotCount);
 		_root->BoxCull(box, containingItems);
 		return true;
 	}
 
+	[[nodiscard]] bool MultiViewCull(const MultiViewQuery &query) const override
+	{
+		if (_root == nullptr)
+			return false;
+
+		_root->MultiViewCull(query, query.Begin(_slotCount));
+		return true;
+	}
+
+	[[nodiscard]] bool NearestCull(NearestQuery &query) const override
+	{
+		if (_root == nullptr)
+			return false;
+
+		query.Begin(_slotCount);
+		_root->NearestCull(query);
+		return true;
+	}
+
 
-	bool RaycastTree(const DirectX::XMFLOAT3A &orig, const DirectX::XMFLOAT3A &dir, float &length, Entity *&entity) const
+	bool RaycastTree(const DirectX::XMFLOAT3A &orig, const DirectX::XMFLOAT3A &dir, float &length, Entity *&entity, RaycastItemTest *itemTest) const override
 	{
 		if (_root == nullptr)
 			return false;
@@ -210,14 +288,13 @@ public:
 		if (!Raycast(orig, dir, _root->bounds, _))
 			return false;
 
-		length = FLT_MAX;
 		entity = nullptr;
 
-		return _root->RaycastNode(orig, dir, length, entity);
+		return _root->RaycastNode(orig, dir, length, entity, itemTest);
 	}
 
 
-	[[nodiscard]] DirectX::BoundingBox *GetBounds() const
+	[[nodiscard]] const DirectX::BoundingBox *GetBounds() const override
 	{
 		if (_root == nullptr)
 			return nullptr;
@@ -226,7 +303,7 @@ public:
 	}
 
 
-	void DebugGetStructure(std::vector<DirectX::BoundingBox> &boxCollection) const
+	void DebugGetStructure(std::vector<DirectX::BoundingBox> &boxCollection) const override
 	{
 		if (_root == nullptr)
 			return;
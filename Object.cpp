@@ -3,7 +3,7 @@
 #include "ErrMsg.h"
 
 
-Object::Object(const UINT id, const DirectX::BoundingBox &bounds) : Entity(id, bounds)
+Object::Object(const UINT id, const UINT slot, const DirectX::BoundingBox &bounds, EntityNameTable *nameTable, EntityComponents *components) : Entity(id, slot, bounds, nameTable, components)
 {
 
 }
@@ -62,14 +62,25 @@ void Object::SetTexture(const UINT id)	{ _texID = id;	}
 
 bool Object::Update(ID3D11DeviceContext *context, Time &time, const Input &input)
 {
-	bool updatePosBuffer = _transform.GetDirty();
-
 	if (!InternalUpdate(context))
 	{
 		ErrMsg("Failed to update object!");
 		return false;
 	}
 
+	return true;
+}
+
+bool Object::UpdateBuffers(ID3D11DeviceContext *context)
+{
+	bool updatePosBuffer = _transform.GetDirty();
+
+	if (!InternalUpdateBuffers(context))
+	{
+		ErrMsg("Failed to update object buffers!");
+		return false;
+	}
+
 	if (updatePosBuffer)
 	{
 		DirectX::BoundingBox worldSpaceBounds;
@@ -22,7 +22,7 @@ private:
 		_posBuffer;
 
 public:
-	explicit Object(UINT id, const DirectX::BoundingBox &bounds);
+	explicit Object(UINT id, UINT slot, const DirectX::BoundingBox &bounds, EntityNameTable *nameTable, EntityComponents *components);
 
 	[[nodiscard]] bool Initialize(ID3D11Device *device, const std::string &name,
 		UINT meshID, UINT texID, 
@@ -39,6 +39,7 @@ public:
 	void SetTexture(UINT id);
 
 	[[nodiscard]] bool Update(ID3D11DeviceContext *context, Time &time, const Input &input) override;
+	[[nodiscard]] bool UpdateBuffers(ID3D11DeviceContext *context) override;
 	[[nodiscard]] bool BindBuffers(ID3D11DeviceContext *context) const override;
 	[[nodiscard]] bool Render(CameraD3D11 *camera) override;
 };
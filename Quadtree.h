@@ -1,56 +1,86 @@
 #pragma once
 
+#include <algorithm>
+#include <cfloat>
 #include <memory>
 #include <utility>
 #include <vector>
 #include <DirectXCollision.h>
 
-#include "Entity.h"
+#include "VolumeTree.h"
 #include "Raycast.h"
 
 
-class Quadtree
+class Quadtree final : public VolumeTree
 {
 private:
 	static constexpr UINT MAX_ITEMS_IN_NODE = 24;
 	static constexpr UINT MAX_DEPTH = 4;
 	static constexpr UINT CHILD_COUNT = 4;
+	static constexpr UINT MIN_ITEMS_FOR_BULK_BUILD = 256;
+	static constexpr UINT PARALLEL_BUILD_DEPTH = 3; // Subtrees from this depth down are bulk built in parallel.
+	static constexpr UINT MAX_PACKET_STACK_SIZE = MAX_DEPTH * CHILD_COUNT + 1; // Siblings left to visit at every depth.
+
+
+	struct Node;
+
+	// Leaf handles per item slot, letting items be moved & removed without searching the tree.
+	typedef std::vector<Node *> ItemLeaves;
+
+	// Subtree left for a worker thread to build during a bulk insert.
+	struct BulkTask
+	{
+		Node *node = nullptr;
+		std::vector<VolumeTreeItem> items;
+	};
 
 
 	struct Node
 	{
-		std::vector<Entity *> data;
+		std::vector<VolumeTreeItem> data;
 		DirectX::BoundingBox bounds;
 		std::unique_ptr<Node> children[CHILD_COUNT];
+		Node *parent = nullptr;
+		UINT depth = 0;
 		bool isLeaf = true;
 
 
-		void Split(const UINT depth)
+		void CreateChildren()
 		{
 			const DirectX::XMFLOAT3
 				center = bounds.Center,
 				extents = bounds.Extents,
-				min = { center.x - extents.x, 0.0f, center.z - extents.z },
-				max = { center.x + extents.x, 0.0f, center.z + extents.z };
+				min = { center.x - extents.x, center.y - extents.y, center.z - extents.z },
+				max = { center.x + extents.x, center.y + extents.y, center.z + extents.z };
 
 			children[0] = std::make_unique<Node>();
 			children[1] = std::make_unique<Node>();
 			children[2] = std::make_unique<Node>();
 			children[3] = std::make_unique<Node>();
 
-			DirectX::BoundingBox::CreateFromPoints(children[0]->bounds, { min.x, -extents.y, min.z, 0 }, { center.x, extents.y, center.z, 0 });
-			DirectX::BoundingBox::CreateFromPoints(children[1]->bounds, { center.x, -extents.y, min.z, 0 }, { max.x, extents.y, center.z, 0 });
-			DirectX::BoundingBox::CreateFromPoints(children[2]->bounds, { min.x, -extents.y, center.z, 0 }, { center.x, extents.y, max.z, 0 });
-			DirectX::BoundingBox::CreateFromPoints(children[3]->bounds, { center.x, -extents.y, center.z, 0 }, { max.x, extents.y, max.z, 0 });
+			DirectX::BoundingBox::CreateFromPoints(children[0]->bounds, { min.x, min.y, min.z, 0 }, { center.x, max.y, center.z, 0 });
+			DirectX::BoundingBox::CreateFromPoints(children[1]->bounds, { center.x, min.y, min.z, 0 }, { max.x, max.y, center.z, 0 });
+			DirectX::BoundingBox::CreateFromPoints(children[2]->bounds, { min.x, min.y, center.z, 0 }, { center.x, max.y, max.z, 0 });
+			DirectX::BoundingBox::CreateFromPoints(children[3]->bounds, { center.x, min.y, center.z, 0 }, { max.x, max.y, max.z, 0 });
+
+			for (int i = 0; i < CHILD_COUNT; i++)
+			{
+				children[i]->parent = this;
+				children[i]->depth = depth + 1;
+			}
+		}
+
+		void Split(std::vector<ItemLeaves> &itemLeaves)
+		{
+			CreateChildren();
 
 			for (int i = 0; i < data.size(); i++)
-				if (data[i] != nullptr)
+				if (data[i].entity != nullptr)
 				{
-					DirectX::BoundingBox itemBounds;
-					data[i]->StoreBounds(itemBounds);
+					std::erase(itemLeaves[data[i].slot], this);
 
 					for (int j = 0; j < CHILD_COUNT; j++)
-						children[j]->Insert(data[i], itemBounds, depth + 1);
+						children[j]->Insert(data[i], itemLeaves);
 				}
 
 			data.clear();
@@ -58,9 +88,12 @@ private:
 		}
 
 
-		bool Insert(Entity *item, const DirectX::BoundingBox &itemBounds, const UINT depth = 0)
+		bool Insert(const VolumeTreeItem &item, std::vector<ItemLeaves> &itemLeaves)
 		{
-			if (!bounds.Intersects(itemBounds))
+			VOLUME_TREE_STAT(nodesVisited);
+			VOLUME_TREE_STAT(intersectionTests);
+
+			if (!bounds.Intersects(item.bounds))
 				return false;
 
 			if (isLeaf)
@@ -68,58 +101,122 @@ private:
 				if (depth >= MAX_DEPTH || data.size() < MAX_ITEMS_IN_NODE)
 				{
 					data.push_back(item);
+					itemLeaves[item.slot].push_back(this);
 					return true;
 				}
 
-				Split(depth);
+				Split(itemLeaves);
 			}
 
 			for (int i = 0; i < CHILD_COUNT; i++)
 			{
 				if (children[i] != nullptr)
-					children[i]->Insert(item, itemBounds, depth + 1);
+					children[i]->Insert(item, itemLeaves);
 			}
 
 			return true;
 		}
 
-		void Remove(Entity *item, const DirectX::BoundingBox &itemBounds, const UINT depth = 0, const bool skipIntersection = false)
+		// Distributes items down the subtree without maintaining leaf handles, which are linked once the build is done.
+		// If a task list is given, subtrees at the parallel build depth are added to it instead of being built.
+		void InsertBulk(std::vector<VolumeTreeItem> &&items, std::vector<BulkTask> *tasks)
 		{
-			if (!skipIntersection)
-				if (!bounds.Intersects(itemBounds))
-					return;
+			VOLUME_TREE_STAT(nodesVisited);
 
-			if (isLeaf)
+			if (items.empty())
+				return;
+
+			if (tasks != nullptr && depth >= PARALLEL_BUILD_DEPTH)
 			{
-				std::erase_if(data, [item](const Entity *otherItem) { return item == otherItem; });
+				tasks->push_back({ this, std::move(items) });
 				return;
 			}
 
+			if (isLeaf)
+			{
+				if (depth >= MAX_DEPTH || data.size() + items.size() <= MAX_ITEMS_IN_NODE)
+				{
+					data.insert(data.end(), items.begin(), items.end());
+					return;
+				}
+
+				// The items already in the leaf are distributed to the new children along with the new ones.
+				for (const VolumeTreeItem &item : data)
+				{
+					if (item.entity != nullptr)
+						items.push_back(item);
+				}
+
+				data.clear();
+				CreateChildren();
+				isLeaf = false;
+			}
+
 			for (int i = 0; i < CHILD_COUNT; i++)
 			{
-				if (children[i] != nullptr)
-					children[i]->Remove(item, itemBounds, depth + 1, skipIntersection);
+				std::vector<VolumeTreeItem> childItems;
+				for (const VolumeTreeItem &item : items)
+				{
+					VOLUME_TREE_STAT(intersectionTests);
+
+					if (children[i]->bounds.Intersects(item.bounds))
+						childItems.push_back(item);
+				}
+
+				children[i]->InsertBulk(std::move(childItems), tasks);
 			}
+		}
+
+		void LinkLeaves(std::vector<ItemLeaves> &itemLeaves)
+		{
+			if (isLeaf)
+			{
+				for (const VolumeTreeItem &item : data)
+				{
+					if (item.entity != nullptr)
+						itemLeaves[item.slot].push_back(this);
+				}
+				return;
+			}
+
+			for (int i = 0; i < CHILD_COUNT; i++)
+				children[i]->LinkLeaves(itemLeaves);
+		}
 
-			std::vector<Entity *> containingItems;
+		void EraseItem(const UINT slot)
+		{
+			VOLUME_TREE_STAT(nodesVisited);
+
+			std::erase_if(data, [slot](const VolumeTreeItem &otherItem) { return slot == otherItem.slot; });
+		}
+
+		// Merges the children back into this node if they are all leaves & their unique items fit in one node.
+		bool TryMerge(std::vector<ItemLeaves> &itemLeaves)
+		{
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (isLeaf)
+				return false;
+
+			std::vector<VolumeTreeItem> containingItems;
 			containingItems.reserve(MAX_ITEMS_IN_NODE);
 			for (int i = 0; i < CHILD_COUNT; i++)
 				if (children[i] != nullptr)
 				{
 					if (!children[i]->isLeaf)
-						return;
+						return false;
 
 					if (!children[i]->data.empty())
 					{
-						for (Entity *childItem : children[i]->data)
+						for (const VolumeTreeItem &childItem : children[i]->data)
 						{
-							if (childItem == nullptr)
+							if (childItem.entity == nullptr)
 								continue;
 
-							if (std::ranges::find(containingItems, childItem) == containingItems.end())
+							if (std::ranges::find(containingItems, childItem.slot, &VolumeTreeItem::slot) == containingItems.end())
 							{
 								if (containingItems.size() >= MAX_ITEMS_IN_NODE)
-									return;
+									return false;
 
 								containingItems.push_back(childItem);
 							}
@@ -129,28 +226,39 @@ private:
 
 			for (int i = 0; i < CHILD_COUNT; i++)
 			{
-				children[i].release();
-				children[i] = nullptr;
+				for (const VolumeTreeItem &childItem : children[i]->data)
+					std::erase(itemLeaves[childItem.slot], children[i].get());
+
+				children[i].reset();
 			}
 
 			isLeaf = true;
 			data.clear();
-			for (Entity *newItem : containingItems)
+			for (const VolumeTreeItem &newItem : containingItems)
+			{
 				data.push_back(newItem);
+				itemLeaves[newItem.slot].push_back(this);
+			}
+
+			return true;
 		}
 
 
-		void AddToVector(std::vector<Entity *> &containingItems, const UINT depth) const
+		void AddToVector(std::vector<Entity *> &containingItems) const
 		{
+			VOLUME_TREE_STAT(nodesVisited);
+
 			if (isLeaf)
 			{
-				for (Entity *item : data)
+				for (const VolumeTreeItem &item : data)
 				{
-					if (item == nullptr)
+					if (item.entity == nullptr)
 						continue;
 
-					if (std::ranges::find(containingItems, item) == containingItems.end())
-						containingItems.push_back(item);
+					if (volumeTreeVisitedSet.Visit(item.slot))
+						containingItems.push_back(item.entity);
+					else
+						VOLUME_TREE_STAT(duplicateItems);
 				}
 
 				return;
@@ -161,31 +269,36 @@ private:
 				if (children[i] == nullptr)
 					continue;
 
-				children[i]->AddToVector(containingItems, depth + 1);
+				children[i]->AddToVector(containingItems);
 			}
 		}
 
-		void FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems, const UINT depth = 0) const
+		void FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const
 		{
+			VOLUME_TREE_STAT(nodesVisited);
+			VOLUME_TREE_STAT(intersectionTests);
+
 			switch (frustum.Contains(bounds))
 			{
 			case DirectX::DISJOINT:
 				return;
 
 			case DirectX::CONTAINS:
-				AddToVector(containingItems, depth + 1);
+				AddToVector(containingItems);
 				break;
 
 			case DirectX::INTERSECTS:
 				if (isLeaf)
 				{
-					for (Entity *item : data)
+					for (const VolumeTreeItem &item : data)
 					{
-						if (item == nullptr)
+						if (item.entity == nullptr)
 							continue;
 
-						if (std::ranges::find(containingItems, item) == containingItems.end())
-							containingItems.push_back(item);
+						if (volumeTreeVisitedSet.Visit(item.slot))
+							containingItems.push_back(item.entity);
+						else
+							VOLUME_TREE_STAT(duplicateItems);
 					}
 
 					return;
@@ -196,33 +309,38 @@ private:
 					if (children[i] == nullptr)
 						continue;
 
-					children[i]->FrustumCull(frustum, containingItems, depth + 1);
+					children[i]->FrustumCull(frustum, containingItems);
 				}
 				break;
 			}
 		}
 
-		void BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems, const UINT depth = 0) const
+		void BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const
 		{
+			VOLUME_TREE_STAT(nodesVisited);
+			VOLUME_TREE_STAT(intersectionTests);
+
 			switch (box.Contains(bounds))
 			{
 			case DirectX::DISJOINT:
 				return;
 
 			case DirectX::CONTAINS:
-				AddToVector(containingItems, depth + 1);
+				AddToVector(containingItems);
 				break;
 
 			case DirectX::INTERSECTS:
 				if (isLeaf)
 				{
-					for (Entity *item : data)
+					for (const VolumeTreeItem &item : data)
 					{
-						if (item == nullptr)
+						if (item.entity == nullptr)
 							continue;
 
-						if (std::ranges::find(containingItems, item) == containingItems.end())
-							containingItems.push_back(item);
+						if (volumeTreeVisitedSet.Visit(item.slot))
+							containingItems.push_back(item.entity);
+						else
+							VOLUME_TREE_STAT(duplicateItems);
 					}
 
 					return;
@@ -233,83 +351,195 @@ private:
 					if (children[i] == nullptr)
 						continue;
 
-					children[i]->BoxCull(box, containingItems, depth + 1);
+					children[i]->BoxCull(box, containingItems);
 				}
 				break;
 			}
 		}
 
 
-		bool RaycastNode(const DirectX::XMFLOAT3 &orig, const DirectX::XMFLOAT3 &dir, float &length, Entity *&entity) const
+		void MultiViewCull(const MultiViewQuery &query, const MultiViewState &parentState) const
 		{
+			VOLUME_TREE_STAT(nodesVisited);
+
+			MultiViewState state;
+			if (!query.ClassifyNode(parentState, bounds, state))
+				return;
+
 			if (isLeaf)
-			{ // Check all items in leaf for intersection & return result.
-				for (Entity *item : data)
+			{
+				for (const VolumeTreeItem &item : data)
 				{
-					if (item == nullptr)
-						continue;
+					if (item.entity != nullptr)
+						query.AddItem(state, item.entity, item.bounds, item.slot);
+				}
+				return;
+			}
 
-					DirectX::BoundingBox itemBounds;
-					item->StoreBounds(itemBounds);
+			for (int i = 0; i < CHILD_COUNT; i++)
+			{
+				if (children[i] != nullptr)
+					children[i]->MultiViewCull(query, state);
+			}
+		}
 
-					float newLength = 0.0f;
-					if (Raycast(orig, dir, itemBounds, newLength))
-					{
-						if (newLength < 0.0f)
-							continue;
 
-						if (newLength >= length)
-							continue;
+		void NearestCull(NearestQuery &query) const
+		{
+			VOLUME_TREE_STAT(nodesVisited);
 
-						length = newLength;
-						entity = item;
-					}
+			if (isLeaf)
+			{
+				for (const VolumeTreeItem &item : data)
+				{
+					if (item.entity != nullptr)
+						query.AddItem(item.entity, item.bounds, item.slot);
 				}
-
-				return (entity != nullptr);
+				return;
 			}
 
-			struct ChildHit { int index; float length; };
-			std::vector<ChildHit> childHits = {
-				{ 0, FLT_MAX }, { 1, FLT_MAX }, { 2, FLT_MAX }, { 3, FLT_MAX }
-			};
+			struct ChildDistance { int index; float distanceSq; };
+			ChildDistance childDistances[CHILD_COUNT];
+			int childCount = 0;
 
-			int childHitCount = CHILD_COUNT;
-			for (int i = 0; i < childHitCount; i++)
+			for (int i = 0; i < CHILD_COUNT; i++)
 			{
-				const Node *child = children[childHits[i].index].get();
-				if (Raycast(orig, dir, child->bounds, childHits[i].length))
+				if (children[i] == nullptr)
+					continue;
+
+				float childDistanceSq = 0.0f;
+				if (!query.ClassifyNode(children[i]->bounds, childDistanceSq))
 					continue;
 
-				// Remove child node from hits.
-				childHits.erase(childHits.begin() + i);
-				childHitCount--;
-				i--;
+				// Insertion sort by distance.
+				int j = childCount++;
+				while (j > 0 && childDistances[j - 1].distanceSq > childDistanceSq)
+				{
+					childDistances[j] = childDistances[j - 1];
+					j--;
+				}
+				childDistances[j] = { i, childDistanceSq };
+			}
+
+			// Visit children from nearest to furthest, skipping any beyond the furthest accepted entity so far.
+			for (int i = 0; i < childCount; i++)
+			{
+				if (childDistances[i].distanceSq > query.GetMaxDistanceSq())
+					break;
+
+				children[childDistances[i].index]->NearestCull(query);
+			}
+		}
+
+
+		bool RaycastNode(const DirectX::XMFLOAT3 &orig, const DirectX::XMFLOAT3 &dir, float &length, Entity *&entity, RaycastItemTest *itemTest) const
+		{
+			VOLUME_TREE_STAT(nodesVisited);
+
+			if (isLeaf)
+			{ // Check all items in leaf for intersection & return result.
+				for (const VolumeTreeItem &item : data)
+				{
+					if (item.entity != nullptr)
+						RaycastItem(orig, dir, item.entity, item.bounds, itemTest, length, entity);
+				}
+
+				return (entity != nullptr);
 			}
 
-			// Insertion sort by length.
-			for (int i = 1; i < childHitCount; i++)
+			struct ChildHit { int index; float length; };
+			ChildHit childHits[CHILD_COUNT];
+			int childHitCount = 0;
+
+			for (int i = 0; i < CHILD_COUNT; i++)
 			{
-				int j = i;
-				while (childHits[j].length < childHits[j - 1].length)
+				const Node *child = children[i].get();
+
+				VOLUME_TREE_STAT(intersectionTests);
+
+				float childLength = 0.0f;
+				if (!RaycastEntry(orig, dir, child->bounds, childLength) || childLength >= length)
+					continue;
+
+				// Insertion sort by length.
+				int j = childHitCount++;
+				while (j > 0 && childHits[j - 1].length > childLength)
 				{
-					std::swap(childHits[j], childHits[j - 1]);
-					if (--j <= 0)
-						break;
+					childHits[j] = childHits[j - 1];
+					j--;
 				}
+				childHits[j] = { i, childLength };
 			}
 
-			// Check children in order of closest to furthest. Return first intersection found.
+			// Check children in order of closest to furthest, skipping any that start beyond the closest hit so far.
 			for (int i = 0; i < childHitCount; i++)
 			{
-				length = FLT_MAX;
-				entity = nullptr;
+				if (childHits[i].length >= length)
+					break;
 
-				if (children[childHits[i].index]->RaycastNode(orig, dir, length, entity))
-					return true;
+				children[childHits[i].index]->RaycastNode(orig, dir, length, entity, itemTest);
 			}
 
-			return false;
+			return (entity != nullptr);
+		}
+
+		// Nodes are tested against every ray of the packet at once, and a subtree is skipped once none of its rays hit it.
+		// Each stack entry keeps the rays that hit its parent, so rays that miss a subtree are never tested in it again.
+		void RaycastPacket(RayPacket &packet, RaycastItemTest *itemTest) const
+		{
+			struct StackEntry { const Node *node; UINT rayMask; };
+			StackEntry stack[MAX_PACKET_STACK_SIZE];
+			UINT stackSize = 0;
+
+			stack[stackSize++] = { this, packet.activeRays };
+			while (stackSize > 0)
+			{
+				const StackEntry entry = stack[--stackSize];
+				const Node *node = entry.node;
+
+				// Tested when popped rather than pushed, so rays shortened by hits in the meantime are pruned.
+				VOLUME_TREE_STAT(intersectionTests);
+				const UINT rayMask = RaycastBoxPacket(packet, entry.rayMask & packet.activeRays, node->bounds);
+				if (rayMask == 0)
+					continue;
+
+				VOLUME_TREE_STAT(nodesVisited);
+
+				if (node->isLeaf)
+				{ // Check all items in leaf for intersection.
+					for (const VolumeTreeItem &item : node->data)
+					{
+						if (item.entity != nullptr)
+							RaycastPacketItem(packet, rayMask, item.entity, item.bounds, itemTest);
+					}
+					continue;
+				}
+
+				// Order the children along the direction of the first ray, which coherent packets share.
+				const DirectX::XMFLOAT3 &dir = packet.direction[std::countr_zero(rayMask)];
+
+				struct ChildOrder { UINT index; float ahead; };
+				ChildOrder childOrder[CHILD_COUNT];
+
+				for (UINT i = 0; i < CHILD_COUNT; i++)
+				{
+					const DirectX::XMFLOAT3 &center = node->children[i]->bounds.Center;
+					const float ahead = center.x * dir.x + center.y * dir.y + center.z * dir.z;
+
+					// Insertion sort, furthest first.
+					UINT j = i;
+					while (j > 0 && childOrder[j - 1].ahead < ahead)
+					{
+						childOrder[j] = childOrder[j - 1];
+						j--;
+					}
+					childOrder[j] = { i, ahead };
+				}
+
+				// Push the furthest child first so the closest is visited first.
+				for (UINT i = 0; i < CHILD_COUNT; i++)
+					stack[stackSize++] = { node->children[childOrder[i].index].get(), rayMask };
+			}
 		}
 
 
@@ -327,70 +557,266 @@ private:
 	};
 
 	std::unique_ptr<Node> _root;
+	std::vector<ItemLeaves> _itemLeaves;
+
+
+	// Merges nodes bottom-up after removals, never merging above the given limit.
+	void MergeUpwards(std::vector<Node *> &mergeCandidates, const Node *mergeLimit)
+	{
+		// Deepest first, so a merge never destroys a node still waiting in the list.
+		while (!mergeCandidates.empty())
+		{
+			const auto deepest = std::ranges::max_element(mergeCandidates, { }, &Node::depth);
+			Node *node = *deepest;
+			mergeCandidates.erase(deepest);
+
+			if (!node->TryMerge(_itemLeaves))
+				continue;
+
+			if (node == mergeLimit || node->parent == nullptr)
+				continue;
+
+			if (std::ranges::find(mergeCandidates, node->parent) == mergeCandidates.end())
+				mergeCandidates.push_back(node->parent);
+		}
+	}
+
+	// Removes an item from every leaf it occupies, found through its leaf handles.
+	void RemoveSlot(const UINT slot, const Node *mergeLimit = nullptr)
+	{
+		std::vector<Node *> mergeCandidates;
+
+		for (Node *leaf : _itemLeaves[slot])
+		{
+			leaf->EraseItem(slot);
+
+			if (leaf == mergeLimit || leaf->parent == nullptr)
+				continue;
+
+			if (std::ranges::find(mergeCandidates, leaf->parent) == mergeCandidates.end())
+				mergeCandidates.push_back(leaf->parent);
+		}
+
+		_itemLeaves[slot].clear();
+		MergeUpwards(mergeCandidates, mergeLimit);
+	}
+
+	void MoveSlot(const UINT slot, Entity *data, const DirectX::BoundingBox &bounds)
+	{
+		const std::vector<Node *> &leaves = _itemLeaves[slot];
+
+		if (leaves.size() == 1 && leaves[0]->bounds.Contains(bounds) == DirectX::CONTAINS)
+		{ // Still inside the only leaf it occupies, only the stored bounds change.
+			for (VolumeTreeItem &item : leaves[0]->data)
+			{
+				if (item.slot == slot)
+					item.bounds = bounds;
+			}
+			return;
+		}
+
+		// Find the closest common ancestor of the occupied leaves...
+		Node *insertRoot = leaves.empty() ? _root.get() : leaves[0];
+		for (Node *leaf : leaves)
+		{
+			Node *other = leaf;
+			while (insertRoot != other)
+			{
+				if (insertRoot->depth >= other->depth)
+					insertRoot = insertRoot->parent;
+				else
+					other = other->parent;
+			}
+		}
+
+		// ...then walk up only as far as needed to contain the new bounds.
+		while (insertRoot->parent != nullptr && insertRoot->bounds.Contains(bounds) != DirectX::CONTAINS)
+			insertRoot = insertRoot->parent;
+
+		RemoveSlot(slot, insertRoot);
+		insertRoot->Insert({ data, bounds, slot }, _itemLeaves);
+
+		if (_itemLeaves[slot].empty()) // Moved out of the tree.
+			ReleaseSlot(data);
+	}
 
 
 public:
 	Quadtree() = default;
-	~Quadtree() = default;
+	~Quadtree() override = default;
 	Quadtree(const Quadtree &other) = delete;
 	Quadtree &operator=(const Quadtree &other) = delete;
 	Quadtree(Quadtree &&other) = delete;
 	Quadtree &operator=(Quadtree &&other) = delete;
 
-	[[nodiscard]] bool Initialize(const DirectX::BoundingBox &sceneBounds)
+	[[nodiscard]] VolumeTreeType GetType() const override
+	{
+		return VolumeTreeType::QUADTREE;
+	}
+
+	[[nodiscard]] bool Initialize(const DirectX::BoundingBox &sceneBounds) override
 	{
 		_root = std::make_unique<Node>();
+		ClearSlots();
+		_itemLeaves.clear();
 		_root->bounds = sceneBounds;
 
 		return true;
 	}
 
-	void Insert(Entity *data, const DirectX::BoundingBox &bounds) const
+	void Insert(Entity *data, const DirectX::BoundingBox &bounds) override
 	{
-		if (_root != nullptr)
-			_root->Insert(data, bounds);
+		if (_root == nullptr)
+			return;
+
+		const UINT slot = AcquireSlot(data);
+		if (slot >= _itemLeaves.size())
+			_itemLeaves.resize(slot + 1);
+
+		if (!_itemLeaves[slot].empty())
+		{
+			MoveSlot(slot, data, bounds);
+			return;
+		}
+
+		if (!_root->Insert({ data, bounds, slot }, _itemLeaves))
+			ReleaseSlot(data); // Outside the tree, so it is not stored.
+	}
+
+	// Builds the subtrees below the parallel build depth on separate threads, then links every leaf handle again.
+	// Small batches relative to the tree are inserted one at a time instead, as relinking visits the whole tree.
+	void InsertBulk(std::vector<VolumeTreeItem> &items) override
+	{
+		if (_root == nullptr)
+			return;
+
+		if (items.size() < (std::max)(static_cast<size_t>(MIN_ITEMS_FOR_BULK_BUILD), _itemSlots.size() / 8))
+		{
+			VolumeTree::InsertBulk(items);
+			return;
+		}
+
+		// Leaves end up holding their items in Morton order, keeping the items of nearby leaves close in memory.
+		SortByMortonCode(items, _root->bounds);
+
+		std::vector<VolumeTreeItem> newItems;
+		newItems.reserve(items.size());
+
+		for (const VolumeTreeItem &item : items)
+		{
+			const UINT slot = AcquireSlot(item.entity);
+			if (slot >= _itemLeaves.size())
+				_itemLeaves.resize(slot + 1);
+
+			if (!_itemLeaves[slot].empty())
+			{ // Already in the tree, moved like any other insert of a stored entity.
+				MoveSlot(slot, item.entity, item.bounds);
+				continue;
+			}
+
+			if (_root->bounds.Intersects(item.bounds))
+				newItems.push_back({ item.entity, item.bounds, slot });
+			else
+				ReleaseSlot(item.entity);
+		}
+
+		std::vector<BulkTask> tasks;
+		_root->InsertBulk(std::move(newItems), &tasks);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int i = 0; i < static_cast<int>(tasks.size()); i++)
+			tasks[i].node->InsertBulk(std::move(tasks[i].items), nullptr);
+
+		// Splits moved items that were already in the tree as well, so every handle is relinked.
+		for (ItemLeaves &leaves : _itemLeaves)
+			leaves.clear();
+
+		_root->LinkLeaves(_itemLeaves);
 	}
 
 
-	[[nodiscard]] bool Remove(Entity *data, const DirectX::BoundingBox &bounds) const
+	[[nodiscard]] bool Remove(Entity *data, const DirectX::BoundingBox &) override
+	{
+		return Remove(data);
+	}
+
+	[[nodiscard]] bool Remove(Entity *data) override
 	{
 		if (_root == nullptr)
 			return false;
 
-		_root->Remove(data, bounds);
+		const auto it = _itemSlots.find(data);
+		if (it == _itemSlots.end())
+			return true;
+
+		RemoveSlot(it->second);
+		ReleaseSlot(data);
 		return true;
 	}
 
-	[[nodiscard]] bool Remove(Entity *data) const
+	[[nodiscard]] bool Move(Entity *data, const DirectX::BoundingBox &bounds) override
 	{
 		if (_root == nullptr)
 			return false;
 
-		_root->Remove(data, _root->bounds, 0, true);
+		const auto it = _itemSlots.find(data);
+		if (it == _itemSlots.end())
+		{
+			Insert(data, bounds);
+			return true;
+		}
+
+		MoveSlot(it->second, data, bounds);
 		return true;
 	}
 
 
-	[[nodiscard]] bool FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const
+	[[nodiscard]] bool FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const override
 	{
 		if (_root == nullptr)
 			return false;
 
+		volumeTreeVisitedSet.BeginQuery(_slotCount);
 		_root->FrustumCull(frustum, containingItems);
 		return true;
 	}
 
-	[[nodiscard]] bool BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const
+	[[nodiscard]] bool BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const override
 	{
 		if (_root == nullptr)
 			return false;
 
+		volumeTreeVisitedSet.BeginQuery(_slotCount);
 		_root->BoxCull(box, containingItems);
 		return true;
 	}
 
+	[[nodiscard]] bool MultiViewCull(const MultiViewQuery &query) const override
+	{
+		if (_root == nullptr)
+			return false;
+
+		_root->MultiViewCull(query, query.Begin(_slotCount));
+		return true;
+	}
+
+
+	[[nodiscard]] bool NearestCull(NearestQuery &query) const override
+	{
+		if (_root == nullptr)
+			return false;
+
+		query.Begin(_slotCount);
+
+		float distanceSq = 0.0f;
+		if (query.ClassifyNode(_root->bounds, distanceSq))
+			_root->NearestCull(query);
+
+		return true;
+	}
+
 
-	bool RaycastTree(const DirectX::XMFLOAT3A &orig, const DirectX::XMFLOAT3A &dir, float &length, Entity *&entity) const
+	bool RaycastTree(const DirectX::XMFLOAT3A &orig, const DirectX::XMFLOAT3A &dir, float &length, Entity *&entity, RaycastItemTest *itemTest) const override
 	{
 		if (_root == nullptr)
 			return false;
@@ -399,14 +825,21 @@ public:
 		if (!Raycast(orig, dir, _root->bounds, _))
 			return false;
 
-		length = FLT_MAX;
 		entity = nullptr;
 
-		return _root->RaycastNode(orig, dir, length, entity);
+		return _root->RaycastNode(orig, dir, length, entity, itemTest);
+	}
+
+	void RaycastPacket(RayPacket &packet, RaycastItemTest *itemTest) const override
+	{
+		if (_root == nullptr)
+			return;
+
+		_root->RaycastPacket(packet, itemTest);
 	}
 
 
-	[[nodiscard]] DirectX::BoundingBox *GetBounds() const
+	[[nodiscard]] const DirectX::BoundingBox *GetBounds() const override
 	{
 		if (_root == nullptr)
 			return nullptr;
@@ -415,7 +848,7 @@ public:
 	}
 
 
-	void DebugGetStructure(std::vector<DirectX::BoundingBox> &boxCollection) const
+	void DebugGetStructure(std::vector<DirectX::BoundingBox> &boxCollection) const override
 	{
 		if (_root == nullptr)
 			return;
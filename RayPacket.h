@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <DirectXCollision.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RAY_PACKET_WIDTH 8
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define RAY_PACKET_WIDTH 4
+#else
+#define RAY_PACKET_WIDTH 1
+#endif
+
+typedef unsigned int UINT;
+
+class Entity;
+
+
+enum class RaycastMode
+{
+	CLOSEST_HIT, // Find the closest entity along each ray.
+	ANY_HIT, // Stop tracing each ray at the first entity found, such as for line-of-sight checks.
+};
+
+
+// Rays traced together through a volume tree, with the components of every ray stored in separate arrays for wide loads.
+// The length of each ray starts as its maximum distance and shrinks as closer hits are found.
+struct RayPacket
+{
+	static constexpr UINT WIDTH = RAY_PACKET_WIDTH;
+
+	alignas(32) float originX[WIDTH] = { };
+	alignas(32) float originY[WIDTH] = { };
+	alignas(32) float originZ[WIDTH] = { };
+	alignas(32) float invDirX[WIDTH] = { };
+	alignas(32) float invDirY[WIDTH] = { };
+	alignas(32) float invDirZ[WIDTH] = { };
+	alignas(32) float length[WIDTH] = { };
+
+	DirectX::XMFLOAT3 origin[WIDTH] = { };
+	DirectX::XMFLOAT3 direction[WIDTH] = { };
+	Entity *entity[WIDTH] = { };
+	UINT rayIndex[WIDTH] = { }; // Index of each ray in the batch it was taken from.
+
+	UINT count = 0;
+	UINT activeRays = 0; // One bit per ray still being traced.
+	RaycastMode mode = RaycastMode::CLOSEST_HIT;
+
+
+	void Clear(const RaycastMode raycastMode)
+	{
+		count = 0;
+		activeRays = 0;
+		mode = raycastMode;
+	}
+
+	[[nodiscard]] bool IsFull() const
+	{
+		return count >= WIDTH;
+	}
+
+	void AddRay(const DirectX::XMFLOAT3 &rayOrigin, const DirectX::XMFLOAT3 &rayDirection, const float maxLength, const UINT index)
+	{
+		const UINT ray = count++;
+
+		originX[ray] = rayOrigin.x;
+		originY[ray] = rayOrigin.y;
+		originZ[ray] = rayOrigin.z;
+		invDirX[ray] = 1.0f / rayDirection.x;
+		invDirY[ray] = 1.0f / rayDirection.y;
+		invDirZ[ray] = 1.0f / rayDirection.z;
+		length[ray] = maxLength;
+
+		origin[ray] = rayOrigin;
+		direction[ray] = rayDirection;
+		entity[ray] = nullptr;
+		rayIndex[ray] = index;
+
+		activeRays |= 1u << ray;
+	}
+
+	// Records a hit closer than the current length of the ray. In any-hit mode the ray is done.
+	void SetHit(const UINT ray, Entity *hitEntity, const float hitLength)
+	{
+		length[ray] = hitLength;
+		entity[ray] = hitEntity;
+
+		if (mode == RaycastMode::ANY_HIT)
+			activeRays &= ~(1u << ray);
+	}
+};
+
+
+// Returns the rays in rayMask that enter the box before reaching their current length.
+// If entry is given, it receives the distance at which each ray enters the box, or zero if it starts inside.
+[[nodiscard]] inline UINT RaycastBoxPacketScalar(const RayPacket &packet, const UINT rayMask, const DirectX::BoundingBox &box, float *entry = nullptr)
+{
+	const DirectX::XMFLOAT3
+		boxMin = { box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z },
+		boxMax = { box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z };
+
+	UINT result = 0;
+	for (UINT ray = 0; ray < packet.count; ray++)
+	{
+		if (!(rayMask & (1u << ray)))
+			continue;
+
+		const float
+			tx1 = (boxMin.x - packet.originX[ray]) * packet.invDirX[ray],
+			tx2 = (boxMax.x - packet.originX[ray]) * packet.invDirX[ray],
+			ty1 = (boxMin.y - packet.originY[ray]) * packet.invDirY[ray],
+			ty2 = (boxMax.y - packet.originY[ray]) * packet.invDirY[ray],
+			tz1 = (boxMin.z - packet.originZ[ray]) * packet.invDirZ[ray],
+			tz2 = (boxMax.z - packet.originZ[ray]) * packet.invDirZ[ray];
+
+		const float
+			tmin = (std::max)({ (std::min)(tx1, tx2), (std::min)(ty1, ty2), (std::min)(tz1, tz2), 0.0f }),
+			tmax = (std::min)({ (std::max)(tx1, tx2), (std::max)(ty1, ty2), (std::max)(tz1, tz2) });
+
+		if (entry != nullptr)
+			entry[ray] = tmin;
+
+		if (tmin <= tmax && tmin < packet.length[ray])
+			result |= 1u << ray;
+	}
+
+	return result;
+}
+
+// Same as RaycastBoxPacketScalar(), slab testing every ray of the packet at once.
+[[nodiscard]] inline UINT RaycastBoxPacket(const RayPacket &packet, const UINT rayMask, const DirectX::BoundingBox &box, float *entry = nullptr)
+{
+#if RAY_PACKET_WIDTH == 8
+	const __m256
+		minX = _mm256_set1_ps(box.Center.x - box.Extents.x), maxX = _mm256_set1_ps(box.Center.x + box.Extents.x),
+		minY = _mm256_set1_ps(box.Center.y - box.Extents.y), maxY = _mm256_set1_ps(box.Center.y + box.Extents.y),
+		minZ = _mm256_set1_ps(box.Center.z - box.Extents.z), maxZ = _mm256_set1_ps(box.Center.z + box.Extents.z);
+
+	const __m256
+		ox = _mm256_load_ps(packet.originX), oy = _mm256_load_ps(packet.originY), oz = _mm256_load_ps(packet.originZ),
+		ix = _mm256_load_ps(packet.invDirX), iy = _mm256_load_ps(packet.invDirY), iz = _mm256_load_ps(packet.invDirZ);
+
+	const __m256
+		tx1 = _mm256_mul_ps(_mm256_sub_ps(minX, ox), ix), tx2 = _mm256_mul_ps(_mm256_sub_ps(maxX, ox), ix),
+		ty1 = _mm256_mul_ps(_mm256_sub_ps(minY, oy), iy), ty2 = _mm256_mul_ps(_mm256_sub_ps(maxY, oy), iy),
+		tz1 = _mm256_mul_ps(_mm256_sub_ps(minZ, oz), iz), tz2 = _mm256_mul_ps(_mm256_sub_ps(maxZ, oz), iz);
+
+	const __m256 tmin = _mm256_max_ps(
+		_mm256_max_ps(_mm256_min_ps(tx1, tx2), _mm256_min_ps(ty1, ty2)),
+		_mm256_max_ps(_mm256_min_ps(tz1, tz2), _mm256_setzero_ps()));
+
+	const __m256 tmax = _mm256_min_ps(
+		_mm256_min_ps(_mm256_max_ps(tx1, tx2), _mm256_max_ps(ty1, ty2)),
+		_mm256_max_ps(tz1, tz2));
+
+	if (entry != nullptr)
+		_mm256_storeu_ps(entry, tmin);
+
+	const __m256 hit = _mm256_and_ps(
+		_mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ),
+		_mm256_cmp_ps(tmin, _mm256_load_ps(packet.length), _CMP_LT_OQ));
+
+	return static_cast<UINT>(_mm256_movemask_ps(hit)) & rayMask;
+#elif RAY_PACKET_WIDTH == 4
+	const __m128
+		minX = _mm_set1_ps(box.Center.x - box.Extents.x), maxX = _mm_set1_ps(box.Center.x + box.Extents.x),
+		minY = _mm_set1_ps(box.Center.y - box.Extents.y), maxY = _mm_set1_ps(box.Center.y + box.Extents.y),
+		minZ = _mm_set1_ps(box.Center.z - box.Extents.z), maxZ = _mm_set1_ps(box.Center.z + box.Extents.z);
+
+	const __m128
+		ox = _mm_load_ps(packet.originX), oy = _mm_load_ps(packet.originY), oz = _mm_load_ps(packet.originZ),
+		ix = _mm_load_ps(packet.invDirX), iy = _mm_load_ps(packet.invDirY), iz = _mm_load_ps(packet.invDirZ);
+
+	const __m128
+		tx1 = _mm_mul_ps(_mm_sub_ps(minX, ox), ix), tx2 = _mm_mul_ps(_mm_sub_ps(maxX, ox), ix),
+		ty1 = _mm_mul_ps(_mm_sub_ps(minY, oy), iy), ty2 = _mm_mul_ps(_mm_sub_ps(maxY, oy), iy),
+		tz1 = _mm_mul_ps(_mm_sub_ps(minZ, oz), iz), tz2 = _mm_mul_ps(_mm_sub_ps(maxZ, oz), iz);
+
+	const __m128 tmin = _mm_max_ps(
+		_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)),
+		_mm_max_ps(_mm_min_ps(tz1, tz2), _mm_setzero_ps()));
+
+	const __m128 tmax = _mm_min_ps(
+		_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)),
+		_mm_max_ps(tz1, tz2));
+
+	if (entry != nullptr)
+		_mm_storeu_ps(entry, tmin);
+
+	const __m128 hit = _mm_and_ps(_mm_cmple_ps(tmin, tmax), _mm_cmplt_ps(tmin, _mm_load_ps(packet.length)));
+
+	return static_cast<UINT>(_mm_movemask_ps(hit)) & rayMask;
+#else
+	return RaycastBoxPacketScalar(packet, rayMask, box, entry);
+#endif
+}
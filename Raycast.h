@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <DirectXMath.h>
 #include <DirectXCollision.h>
 
@@ -23,26 +26,42 @@ static bool Raycast(
 		tx2 = (boxMax.x - origin.x) * invDir.x;
 
     float
-		tmin = min(tx1, tx2),
-		tmax = max(tx1, tx2);
+		tmin = (std::min)(tx1, tx2),
+		tmax = (std::max)(tx1, tx2);
 
     const float
 		ty1 = (boxMin.y - origin.y) * invDir.y,
 		ty2 = (boxMax.y - origin.y) * invDir.y;
 
-    tmin = max(tmin, min(ty1, ty2));
-    tmax = min(tmax, max(ty1, ty2));
+    tmin = (std::max)(tmin, (std::min)(ty1, ty2));
+    tmax = (std::min)(tmax, (std::max)(ty1, ty2));
 
     const float
 		tz1 = (boxMin.z - origin.z) * invDir.z,
 		tz2 = (boxMax.z - origin.z) * invDir.z;
 
-    tmin = max(tmin, min(tz1, tz2));
-    tmax = min(tmax, max(tz1, tz2));
+    tmin = (std::max)(tmin, (std::min)(tz1, tz2));
+    tmax = (std::min)(tmax, (std::max)(tz1, tz2));
 
-    if (!((tmax >= max(0.0, tmin)) && (tmin < FLT_MAX)))
+    if (!((tmax >= (std::max)(0.0f, tmin)) && (tmin < FLT_MAX)))
         return false;
 
-    length = (tmin > 0.0) ? tmin : tmax;
+    length = (tmin > 0.0f) ? tmin : tmax;
     return true;
-}
\ No newline at end of file
+}
+
+// Returns the distance at which the ray enters the box, or zero if it starts inside.
+static bool RaycastEntry(
+    const DirectX::XMFLOAT3 &origin, const DirectX::XMFLOAT3 &direction, 
+    const DirectX::BoundingBox &box, float &length)
+{
+    if (std::abs(origin.x - box.Center.x) <= box.Extents.x &&
+        std::abs(origin.y - box.Center.y) <= box.Extents.y &&
+        std::abs(origin.z - box.Center.z) <= box.Extents.z)
+    {
+        length = 0.0f;
+        return true;
+    }
+
+    return Raycast(origin, direction, box, length);
+}
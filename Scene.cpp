@@ -210,6 +210,7 @@ bool Scene::Initialize(ID3D11Device *device, Content *content, Graphics *graphic
 		}
 
 		reinterpret_cast<Entity *>(obj)->GetTransform()->ScaleRelative({ 15.0f, 15.0f, 15.0f, 0 });
+		reinterpret_cast<Entity *>(obj)->SetStatic(true);
 	}
 
 	// Create model
@@ -689,7 +690,7 @@ bool Scene::UpdateDebugPlayer(ID3D11DeviceContext* context, Time& time, const In
 				if (_sceneHolder.Raycast(
 					{ camPos.x, camPos.y, camPos.z },
 					{ camDir.x, camDir.y, camDir.z },
-					out))
+					*_content, out))
 				{
 					const UINT entityI = _sceneHolder.GetEntityIndex(out.entity);
 					_currSelection = (entityI == 0xffffffff) ? -1 : static_cast<int>(entityI);
@@ -854,14 +855,11 @@ bool Scene::UpdateDebugPlayer(ID3D11DeviceContext* context, Time& time, const In
 			{
 				if (input.GetKey(KeyCode::Delete) == KeyState::Pressed)
 				{
-					const Entity* ent = _sceneHolder.GetEntity(_currSelection);
-					if (!_sceneHolder.RemoveEntity(_currSelection))
+					if (!_sceneHolder.RemoveEntity(_sceneHolder.GetEntity(_currSelection)))
 					{
 						ErrMsg("Failed to remove entity!");
-						delete ent;
 						return false;
 					}
-					delete ent;
 					_currSelection = -1;
 				}
 			}
@@ -984,15 +982,18 @@ bool Scene::UpdateEntities(ID3D11DeviceContext *context, Time &time, const Input
 		return false;
 	}
 
-	const UINT entityCount = _sceneHolder.GetEntityCount();
-	for (UINT i = 0; i < entityCount; i++)
+	const bool isUpdated = _sceneHolder.ForEachAwakeEntity([&](Entity *entity)
 	{
-		if (!_sceneHolder.GetEntity(i)->Update(context, time, input))
+		if (!entity->Update(context, time, input))
 		{
-			ErrMsg(std::format("Failed to update entity #{}!", i));
+			ErrMsg(std::format("Failed to update entity #{}!", entity->GetID()));
 			return false;
 		}
-	}
+		return true;
+	});
+
+	if (!isUpdated)
+		return false;
 
 	if (!_sceneHolder.Update())
 	{
@@ -1000,7 +1001,16 @@ bool Scene::UpdateEntities(ID3D11DeviceContext *context, Time &time, const Input
 		return false;
 	}
 
-	return true;
+	// World data is computed by the scene holder update, so buffers are uploaded after it.
+	return _sceneHolder.ForEachAwakeEntity([&](Entity *entity)
+	{
+		if (!entity->UpdateBuffers(context))
+		{
+			ErrMsg(std::format("Failed to update buffers of entity #{}!", entity->GetID()));
+			return false;
+		}
+		return true;
+	});
 }
 
 void Scene::UpdateSelectionMarker() const
@@ -1033,16 +1043,17 @@ bool Scene::Render(Time &time, const Input &input)
 		return false;
 	}
 
-	std::vector<Entity *> entitiesToRender;
-	entitiesToRender.reserve(_camera->GetCullCount());
-
 	union {
 		BoundingFrustum frustum = {};
 		BoundingOrientedBox box;
 	} view;
 	bool isCameraOrtho = _camera->GetOrtho();
 
-	time.TakeSnapshot("FrustumCull");
+	// Every view rendered this frame is gathered first, so the volume tree only needs to be traversed once.
+	time.TakeSnapshot("MultiViewCull");
+	_cullingViews.clear();
+	_cullingViewCameras.clear();
+
 	if (isCameraOrtho)
 	{
 		if (!_camera->StoreBounds(view.box))
@@ -1051,11 +1062,7 @@ bool Scene::Render(Time &time, const Input &input)
 			return false;
 		}
 
-		if (!_sceneHolder.BoxCull(view.box, entitiesToRender))
-		{
-			ErrMsg("Failed to perform box culling!");
-			return false;
-		}
+		_cullingViews.push_back(CullingPlanes::FromOrientedBox(view.box));
 	}
 	else
 	{
@@ -1065,190 +1072,77 @@ bool Scene::Render(Time &time, const Input &input)
 			return false;
 		}
 
-		if (!_sceneHolder.FrustumCull(view.frustum, entitiesToRender))
-		{
-			ErrMsg("Failed to perform frustum culling!");
-			return false;
-		}
+		_cullingViews.push_back(CullingPlanes::FromFrustum(view.frustum));
 	}
+	_cullingViewCameras.push_back(_camera);
 
-	for (Entity *ent : entitiesToRender)
-	{
-		if (!ent->Render(_camera))
-		{
-			ErrMsg("Failed to render entity!");
-			return false;
-		}
-	}
-	time.TakeSnapshot("FrustumCull");
+	const bool isCubemapUpdating = _graphics->GetUpdateCubemap() && _cubemap.GetUpdate();
 
+	const size_t spotlightViewStart = _cullingViews.size();
 	const int spotlightCount = static_cast<int>(_spotlights->GetNrOfLights());
-	time.TakeSnapshot("FrustumCullSpotlights");
-	if (_doMultiThread)
-		#pragma omp parallel for num_threads(2)
-		for (int i = 0; i < spotlightCount; i++)
-		{
-			CameraD3D11 *spotlightCamera = _spotlights->GetLightCamera(i);
-
-			std::vector<Entity *> entitiesToCastShadows;
-			entitiesToCastShadows.reserve(spotlightCamera->GetCullCount());
-
-			bool isSpotlightOrtho = spotlightCamera->GetOrtho();
+	for (int i = 0; i < spotlightCount; i++)
+	{
+		CameraD3D11 *spotlightCamera = _spotlights->GetLightCamera(i);
 
-			bool intersectResult = _graphics->GetUpdateCubemap() && _cubemap.GetUpdate();
-			if (isSpotlightOrtho)
+		bool intersectResult = isCubemapUpdating;
+		if (spotlightCamera->GetOrtho())
+		{
+			BoundingOrientedBox lightBounds;
+			if (!spotlightCamera->StoreBounds(lightBounds))
 			{
-				BoundingOrientedBox lightBounds;
-				if (!spotlightCamera->StoreBounds(lightBounds))
-				{
-					ErrMsg("Failed to store spotlight camera oriented box!");
-					continue;
-				}
-
-				if (isCameraOrtho)	intersectResult = intersectResult || view.box.Intersects(lightBounds);
-				else				intersectResult = intersectResult || view.frustum.Intersects(lightBounds);
-
-				if (!intersectResult)
-				{ // Skip rendering if the bounds don't intersect
-					_spotlights->SetLightEnabled(i, false);
-					continue;
-				}
-
-				if (!_sceneHolder.BoxCull(lightBounds, entitiesToCastShadows))
-				{
-					ErrMsg(std::format("Failed to perform box culling for spotlight #{}!", i));
-					continue;
-				}
+				ErrMsg("Failed to store spotlight camera oriented box!");
+				return false;
 			}
-			else
-			{
-				BoundingFrustum lightBounds;
-				if (!spotlightCamera->StoreBounds(lightBounds))
-				{
-					ErrMsg("Failed to store spotlight camera frustum!");
-					continue;
-				}
-
-				if (isCameraOrtho)	intersectResult = intersectResult || view.box.Intersects(lightBounds);
-				else				intersectResult = intersectResult || view.frustum.Intersects(lightBounds);
 
-				if (!intersectResult)
-				{ // Skip rendering if the bounds don't intersect
-					_spotlights->SetLightEnabled(i, false);
-					continue;
-				}
-				_spotlights->SetLightEnabled(i, true);
+			if (isCameraOrtho)	intersectResult = intersectResult || view.box.Intersects(lightBounds);
+			else				intersectResult = intersectResult || view.frustum.Intersects(lightBounds);
 
-				if (!_sceneHolder.FrustumCull(lightBounds, entitiesToCastShadows))
-				{
-					ErrMsg(std::format("Failed to perform frustum culling for spotlight #{}!", i));
-					continue;
-				}
+			if (!intersectResult)
+			{ // Skip rendering if the bounds don't intersect
+				_spotlights->SetLightEnabled(i, false);
+				continue;
 			}
 
-			for (Entity *ent : entitiesToCastShadows)
-			{
-				if (!ent->Render(spotlightCamera))
-				{
-					ErrMsg(std::format("Failed to render entity for spotlight #{}!", i));
-					break;
-				}
-			}
+			_cullingViews.push_back(CullingPlanes::FromOrientedBox(lightBounds));
 		}
-	else
-		for (int i = 0; i < spotlightCount; i++)
+		else
 		{
-			CameraD3D11 *spotlightCamera = _spotlights->GetLightCamera(i);
-
-			std::vector<Entity *> entitiesToCastShadows;
-			entitiesToCastShadows.reserve(spotlightCamera->GetCullCount());
-
-			bool isSpotlightOrtho = spotlightCamera->GetOrtho();
-
-			bool intersectResult = _graphics->GetUpdateCubemap() && _cubemap.GetUpdate();
-			if (isSpotlightOrtho)
+			BoundingFrustum lightBounds;
+			if (!spotlightCamera->StoreBounds(lightBounds))
 			{
-				BoundingOrientedBox lightBounds;
-				if (!spotlightCamera->StoreBounds(lightBounds))
-				{
-					ErrMsg("Failed to store spotlight camera oriented box!");
-					return false;
-				}
-
-				if (isCameraOrtho)	intersectResult = intersectResult || view.box.Intersects(lightBounds);
-				else				intersectResult = intersectResult || view.frustum.Intersects(lightBounds);
-
-				if (!intersectResult)
-				{ // Skip rendering if the bounds don't intersect
-					_spotlights->SetLightEnabled(i, false);
-					continue;
-				}
-
-				time.TakeSnapshot(std::format("FrustumCullSpotlight{}", i));
-				if (!_sceneHolder.BoxCull(lightBounds, entitiesToCastShadows))
-				{
-					ErrMsg(std::format("Failed to perform box culling for spotlight #{}!", i));
-					return false;
-				}
-				time.TakeSnapshot(std::format("FrustumCullSpotlight{}", i));
+				ErrMsg("Failed to store spotlight camera frustum!");
+				return false;
 			}
-			else
-			{
-				BoundingFrustum lightBounds;
-				if (!spotlightCamera->StoreBounds(lightBounds))
-				{
-					ErrMsg("Failed to store spotlight camera frustum!");
-					return false;
-				}
 
-				if (isCameraOrtho)	intersectResult = intersectResult || view.box.Intersects(lightBounds);
-				else				intersectResult = intersectResult || view.frustum.Intersects(lightBounds);
+			if (isCameraOrtho)	intersectResult = intersectResult || view.box.Intersects(lightBounds);
+			else				intersectResult = intersectResult || view.frustum.Intersects(lightBounds);
 
-				if (!intersectResult)
-				{ // Skip rendering if the bounds don't intersect
-					_spotlights->SetLightEnabled(i, false);
-					continue;
-				}
-				_spotlights->SetLightEnabled(i, true);
-
-				time.TakeSnapshot(std::format("FrustumCullSpotlight{}", i));
-				if (!_sceneHolder.FrustumCull(lightBounds, entitiesToCastShadows))
-				{
-					ErrMsg(std::format("Failed to perform frustum culling for spotlight #{}!", i));
-					return false;
-				}
-				time.TakeSnapshot(std::format("FrustumCullSpotlight{}", i));
+			if (!intersectResult)
+			{ // Skip rendering if the bounds don't intersect
+				_spotlights->SetLightEnabled(i, false);
+				continue;
 			}
+			_spotlights->SetLightEnabled(i, true);
 
-			for (Entity *ent : entitiesToCastShadows)
-			{
-				if (!ent->Render(spotlightCamera))
-				{
-					ErrMsg(std::format( "Failed to render entity for spotlight #{}!", i));
-					return false;
-				}
-			}
+			_cullingViews.push_back(CullingPlanes::FromFrustum(lightBounds));
 		}
-	time.TakeSnapshot("FrustumCullSpotlights");
-	
+		_cullingViewCameras.push_back(spotlightCamera);
+	}
+
+	const size_t dirlightViewStart = _cullingViews.size();
 	const int dirlightCount = static_cast<int>(_dirlights->GetNrOfLights());
-	time.TakeSnapshot("FrustumCullDirlights");
-	#pragma omp parallel for num_threads(2)
 	for (int i = 0; i < dirlightCount; i++)
 	{
 		CameraD3D11 *dirlightCamera = _dirlights->GetLightCamera(i);
 
-		std::vector<Entity *> entitiesToCastShadows;
-		entitiesToCastShadows.reserve(dirlightCamera->GetCullCount());
-
-		bool intersectResult = _graphics->GetUpdateCubemap() && _cubemap.GetUpdate();
 		BoundingOrientedBox lightBounds;
 		if (!dirlightCamera->StoreBounds(lightBounds))
 		{
 			ErrMsg("Failed to store directional light camera oriented box!");
-			continue;
+			return false;
 		}
 
+		bool intersectResult = isCubemapUpdating;
 		if (isCameraOrtho)	intersectResult = intersectResult || view.box.Intersects(lightBounds);
 		else				intersectResult = intersectResult || view.frustum.Intersects(lightBounds);
 
@@ -1258,185 +1152,196 @@ bool Scene::Render(Time &time, const Input &input)
 			continue;
 		}
 
-		if (!_sceneHolder.BoxCull(lightBounds, entitiesToCastShadows))
-		{
-			ErrMsg(std::format("Failed to perform box culling for directional light #{}!", i));
-			continue;
-		}
+		_cullingViews.push_back(CullingPlanes::FromOrientedBox(lightBounds));
+		_cullingViewCameras.push_back(dirlightCamera);
+	}
 
-		for (Entity *ent : entitiesToCastShadows)
+	// Each point light is culled once against the cube its six faces span, and entities are sorted into faces afterwards.
+	const size_t pointlightViewStart = _cullingViews.size();
+	_pointlightViews.clear();
+
+	const int pointlightCount = static_cast<int>(_pointlights->GetNrOfLights());
+	for (int i = 0; i < pointlightCount; i++)
+	{
+		PointlightView pointlightView;
+		pointlightView.lightIndex = i;
+
+		for (int j = 0; j < 6; j++)
 		{
-			if (!ent->Render(dirlightCamera))
+			CameraD3D11 *pointlightCamera = _pointlights->GetLightCamera(i, j);
+
+			BoundingFrustum pointlightFrustum;
+			if (!pointlightCamera->StoreBounds(pointlightFrustum))
 			{
-				ErrMsg(std::format("Failed to render entity for directional light #{}!", i));
-				break;
+				ErrMsg("Failed to store pointlight camera frustum!");
+				return false;
 			}
-		}
-	}
-	time.TakeSnapshot("FrustumCullDirlights");
 
-	const int pointlightCount = static_cast<int>(_pointlights->GetNrOfLights());
-	time.TakeSnapshot("FrustumCullPointlights");
-	if (_doMultiThread)
-		#pragma omp parallel for num_threads(2)
-		for (int i = 0; i < pointlightCount; i++)
-			for (int j = 0; j < 6; j++)
-			{
-				CameraD3D11 *pointlightCamera = _pointlights->GetLightCamera(i, j);
+			bool intersectResult = isCubemapUpdating;
+			if (isCameraOrtho)	intersectResult = intersectResult || view.box.Intersects(pointlightFrustum);
+			else				intersectResult = intersectResult || view.frustum.Intersects(pointlightFrustum);
 
-				std::vector<Entity *> entitiesToCastShadows;
-				entitiesToCastShadows.reserve(pointlightCamera->GetCullCount());
+			if (!intersectResult)
+			{ // Skip rendering if the frustums don't intersect
+				_pointlights->SetEnabled(i, j, false);
+				continue;
+			}
+			_pointlights->SetEnabled(i, j, true);
 
-				BoundingFrustum pointlightFrustum;
-				if (!pointlightCamera->StoreBounds(pointlightFrustum))
-				{
-					ErrMsg("Failed to store pointlight camera frustum!");
-					continue;
-				}
+			pointlightView.faceMask |= 1u << j;
+			pointlightView.faces[j] = CullingPlanes::FromFrustum(pointlightFrustum);
+		}
 
-				bool intersectResult = _graphics->GetUpdateCubemap() && _cubemap.GetUpdate();
-				if (isCameraOrtho)	intersectResult = intersectResult || view.box.Intersects(pointlightFrustum);
-				else				intersectResult = intersectResult || view.frustum.Intersects(pointlightFrustum);
+		if (pointlightView.faceMask == 0)
+			continue;
 
-				if (!intersectResult)
-				{ // Skip rendering if the frustums don't intersect
-					_pointlights->SetEnabled(i, j, false);
-					continue;
-				}
-				_pointlights->SetEnabled(i, j, true);
+		// The 90 degree faces reach projectionFarZ along each axis, together covering a cube around the light.
+		CameraD3D11 *pointlightCamera = _pointlights->GetLightCamera(i, 0);
+		const XMFLOAT4A &lightPosition = pointlightCamera->GetPosition();
+		const float lightReach = pointlightCamera->GetCurrProjectionInfo().farZ;
 
-				if (!_sceneHolder.FrustumCull(pointlightFrustum, entitiesToCastShadows))
-				{
-					ErrMsg(std::format("Failed to perform frustum culling for pointlight #{} camera #{}!", i, j));
-					continue;
-				}
+		const BoundingBox lightBounds({ lightPosition.x, lightPosition.y, lightPosition.z }, { lightReach, lightReach, lightReach });
+		_cullingViews.push_back(CullingPlanes::FromBox(lightBounds));
+		_cullingViewCameras.push_back(pointlightCamera);
+		_pointlightViews.push_back(pointlightView);
+	}
 
-				for (Entity *ent : entitiesToCastShadows)
-				{
-					if (!ent->Render(pointlightCamera))
-					{
-						ErrMsg(std::format("Failed to render entity for pointlight #{} camera #{}!", i, j));
-						break;
-					}
-				}
-			}
-	else
-		for (int i = 0; i < pointlightCount; i++)
+	const size_t cubemapViewStart = _cullingViews.size();
+	if (isCubemapUpdating)
+	{
+		for (int i = 0; i < 6; i++)
 		{
-			time.TakeSnapshot(std::format("FrustumCullPointlight{}", i));
-			for (int j = 0; j < 6; j++)
+			CameraD3D11 *cubemapCamera = _cubemap.GetCamera(i);
+
+			BoundingFrustum cubemapViewFrustum;
+			if (!cubemapCamera->StoreBounds(cubemapViewFrustum))
 			{
-				CameraD3D11 *pointlightCamera = _pointlights->GetLightCamera(i, j);
+				ErrMsg("Failed to store cubemap camera frustum!");
+				return false;
+			}
 
-				std::vector<Entity *> entitiesToCastShadows;
-				entitiesToCastShadows.reserve(pointlightCamera->GetCullCount());
+			_cullingViews.push_back(CullingPlanes::FromFrustum(cubemapViewFrustum));
+			_cullingViewCameras.push_back(cubemapCamera);
+		}
+	}
+	const size_t viewCount = _cullingViews.size();
 
-				BoundingFrustum pointlightFrustum;
-				if (!pointlightCamera->StoreBounds(pointlightFrustum))
-				{
-					ErrMsg("Failed to store pointlight camera frustum!");
-					return false;
-				}
+	// Lists keep their capacity between frames.
+	if (_cullingViewItems.size() < viewCount)
+		_cullingViewItems.resize(viewCount);
 
-				bool intersectResult = _graphics->GetUpdateCubemap() && _cubemap.GetUpdate();
-				if (isCameraOrtho)	intersectResult = intersectResult || view.box.Intersects(pointlightFrustum);
-				else				intersectResult = intersectResult || view.frustum.Intersects(pointlightFrustum);
+	for (size_t i = 0; i < viewCount; i++)
+	{
+		_cullingViewItems[i].clear();
+		_cullingViewItems[i].reserve(_cullingViewCameras[i]->GetCullCount());
+	}
 
-				if (!intersectResult)
-				{ // Skip rendering if the frustums don't intersect
-					_pointlights->SetEnabled(i, j, false);
-					continue;
-				}
-				_pointlights->SetEnabled(i, j, true);
+	// Views that have not moved since last frame, such as static lights, reuse their results patched with moved entities.
+	if (!_sceneHolder.CachedMultiViewCull(_cullingViews, _cullingViewCameras, _cullingViewItems))
+	{
+		ErrMsg("Failed to perform multi-view culling!");
+		return false;
+	}
 
-				if (!_sceneHolder.FrustumCull(pointlightFrustum, entitiesToCastShadows))
-				{
-					ErrMsg(std::format("Failed to perform frustum culling for pointlight #{} camera #{}!", i, j));
-					return false;
-				}
+	// Sort the entities seen by each point light into the faces that see them, one list per enabled face.
+	size_t pointlightFaceCount = 0;
+	for (size_t i = 0; i < _pointlightViews.size(); i++)
+	{
+		const PointlightView &pointlightView = _pointlightViews[i];
 
-				for (Entity *ent : entitiesToCastShadows)
-				{
-					if (!ent->Render(pointlightCamera))
-					{
-						ErrMsg(std::format("Failed to render entity for pointlight #{} camera #{}!", i, j));
-						return false;
-					}
-				}
-			}
-			time.TakeSnapshot(std::format("FrustumCullPointlight{}", i));
+		size_t faceLists[6] = { };
+		for (UINT j = 0; j < 6; j++)
+		{
+			if (!(pointlightView.faceMask & (1u << j)))
+				continue;
+
+			if (_pointlightFaceItems.size() <= pointlightFaceCount)
+				_pointlightFaceItems.resize(pointlightFaceCount + 1);
+
+			if (_pointlightFaceCameras.size() <= pointlightFaceCount)
+				_pointlightFaceCameras.resize(pointlightFaceCount + 1);
+
+			_pointlightFaceItems[pointlightFaceCount].clear();
+			_pointlightFaceCameras[pointlightFaceCount] = _pointlights->GetLightCamera(pointlightView.lightIndex, j);
+			faceLists[j] = pointlightFaceCount++;
 		}
-	time.TakeSnapshot("FrustumCullPointlights");
 
+		for (Entity *ent : _cullingViewItems[pointlightViewStart + i])
+		{
+			BoundingBox entityBounds;
+			ent->StoreBounds(entityBounds);
+
+			for (UINT faces = ClassifyBoxViews(pointlightView.faces, pointlightView.faceMask, entityBounds); faces != 0; faces &= faces - 1)
+				_pointlightFaceItems[faceLists[std::countr_zero(faces)]].push_back(ent);
+		}
+	}
+	time.TakeSnapshot("MultiViewCull");
 
-	time.TakeSnapshot("FrustumCullCubemap");
-	if (_graphics->GetUpdateCubemap() && _cubemap.GetUpdate())
+	// Renders the culled entities of views [first, last) to their cameras.
+	auto renderViews = [&](const std::vector<std::vector<Entity *>> &viewItems, const std::vector<CameraD3D11 *> &viewCameras,
+		const size_t first, const size_t last, const char *viewName) -> bool
 	{
 		if (_doMultiThread)
+		{
 			#pragma omp parallel for num_threads(2)
-			for (int i = 0; i < 6; i++)
+			for (int i = static_cast<int>(first); i < static_cast<int>(last); i++)
 			{
-				CameraD3D11 *cubemapCamera = _cubemap.GetCamera(i);
-
-				std::vector<Entity *> entitiesToReflect;
-				entitiesToReflect.reserve(cubemapCamera->GetCullCount());
-
-				DirectX::BoundingFrustum cubemapViewFrustum;
-				entitiesToReflect.clear();
-				entitiesToReflect.reserve(cubemapCamera->GetCullCount());
-
-				if (!cubemapCamera->StoreBounds(cubemapViewFrustum))
-				{
-					ErrMsg("Failed to store cubemap camera frustum!");
-					continue;
-				}
-
-				if (!_sceneHolder.FrustumCull(cubemapViewFrustum, entitiesToReflect))
-				{
-					ErrMsg(std::format("Failed to perform frustum culling for cubemap camera #{}!", i));
-					continue;
-				}
-
-				for (Entity *ent : entitiesToReflect)
+				for (Entity *ent : viewItems[i])
 				{
-					if (!ent->Render(cubemapCamera))
+					if (!ent->Render(viewCameras[i]))
 					{
-						ErrMsg(std::format("Failed to render entity for cubemap camera #{}!", i));
-						continue;
+						ErrMsg(std::format("Failed to render entity for {} view #{}!", viewName, i - static_cast<int>(first)));
+						break;
 					}
 				}
 			}
-		else
-			for (int i = 0; i < 6; i++)
-			{
-				CameraD3D11 *cubemapCamera = _cubemap.GetCamera(i);
-
-				entitiesToRender.clear();
-				entitiesToRender.reserve(cubemapCamera->GetCullCount());
-
-				if (!cubemapCamera->StoreBounds(view.frustum)) // using predefined view frustum to save memory :}
-				{
-					ErrMsg("Failed to store cubemap camera frustum!");
-					return false;
-				}
+			return true;
+		}
 
-				if (!_sceneHolder.FrustumCull(view.frustum, entitiesToRender))
+		for (size_t i = first; i < last; i++)
+		{
+			for (Entity *ent : viewItems[i])
+			{
+				if (!ent->Render(viewCameras[i]))
 				{
-					ErrMsg(std::format("Failed to perform frustum culling for cubemap camera #{}!", i));
+					ErrMsg(std::format("Failed to render entity for {} view #{}!", viewName, i - first));
 					return false;
 				}
-
-				for (Entity *ent : entitiesToRender)
-				{
-					if (!ent->Render(cubemapCamera))
-					{
-						ErrMsg(std::format("Failed to render entity for cubemap camera #{}!", i));
-						return false;
-					}
-				}
 			}
+		}
+		return true;
+	};
+
+	time.TakeSnapshot("RenderMainView");
+	for (Entity *ent : _cullingViewItems[0])
+	{
+		if (!ent->Render(_camera))
+		{
+			ErrMsg("Failed to render entity!");
+			return false;
+		}
 	}
-	time.TakeSnapshot("FrustumCullCubemap");
+	time.TakeSnapshot("RenderMainView");
+
+	time.TakeSnapshot("RenderSpotlights");
+	if (!renderViews(_cullingViewItems, _cullingViewCameras, spotlightViewStart, dirlightViewStart, "spotlight"))
+		return false;
+	time.TakeSnapshot("RenderSpotlights");
+
+	time.TakeSnapshot("RenderDirlights");
+	if (!renderViews(_cullingViewItems, _cullingViewCameras, dirlightViewStart, pointlightViewStart, "directional light"))
+		return false;
+	time.TakeSnapshot("RenderDirlights");
+
+	time.TakeSnapshot("RenderPointlights");
+	if (!renderViews(_pointlightFaceItems, _pointlightFaceCameras, 0, pointlightFaceCount, "pointlight face"))
+		return false;
+	time.TakeSnapshot("RenderPointlights");
+
+	time.TakeSnapshot("RenderCubemap");
+	if (!renderViews(_cullingViewItems, _cullingViewCameras, cubemapViewStart, viewCount, "cubemap"))
+		return false;
+	time.TakeSnapshot("RenderCubemap");
 
 	if (!_graphics->SetCubemap(&_cubemap))
 	{
@@ -1460,6 +1365,55 @@ bool Scene::RenderUI()
 	if (ImGui::Button(_doMultiThread ? "Threading On" : "Threading Off"))
 		_doMultiThread = !_doMultiThread;
 
+	const char *treeName = "Unknown";
+	VolumeTreeType nextTreeType = VolumeTreeType::QUADTREE;
+	switch (_sceneHolder.GetVolumeTreeType())
+	{
+		case VolumeTreeType::QUADTREE:
+			treeName = "Volume Tree: Quadtree";
+			nextTreeType = VolumeTreeType::OCTREE;
+			break;
+
+		case VolumeTreeType::OCTREE:
+			treeName = "Volume Tree: Octree";
+			nextTreeType = VolumeTreeType::LOOSE_OCTREE;
+			break;
+
+		case VolumeTreeType::LOOSE_OCTREE:
+			treeName = "Volume Tree: Loose Octree";
+			nextTreeType = VolumeTreeType::LINEAR_OCTREE;
+			break;
+
+		case VolumeTreeType::LINEAR_OCTREE:
+			treeName = "Volume Tree: Linear Octree";
+			nextTreeType = VolumeTreeType::BVH;
+			break;
+
+		case VolumeTreeType::BVH:
+			treeName = "Volume Tree: BVH";
+			nextTreeType = VolumeTreeType::NOTREE;
+			break;
+
+		case VolumeTreeType::NOTREE:
+			treeName = "Volume Tree: Notree";
+			nextTreeType = VolumeTreeType::HASH_GRID;
+			break;
+
+		case VolumeTreeType::HASH_GRID:
+			treeName = "Volume Tree: Hash Grid";
+			nextTreeType = VolumeTreeType::QUADTREE;
+			break;
+	}
+
+	if (ImGui::Button(treeName))
+	{
+		if (!_sceneHolder.SetVolumeTreeType(nextTreeType))
+		{
+			ErrMsg("Failed to switch volume tree!");
+			return false;
+		}
+	}
+
 	bool isOrtho = _camera->GetOrtho();
 	if (ImGui::Button(isOrtho ? "Orthographic: true" : "Orthographic: false"))
 	{
@@ -1526,14 +1480,11 @@ void Scene::DebugGenerateVolumeTreeStructure()
 	if (lastEntityCount >= 0)
 		for (int i = 0; i < lastBoxCount; i++)
 		{
-			const Entity *ent = _sceneHolder.GetEntity(lastEntityCount);
-			if (!_sceneHolder.RemoveEntity(lastEntityCount))
+			if (!_sceneHolder.RemoveEntity(_sceneHolder.GetEntity(lastEntityCount)))
 			{
 				ErrMsg("Failed to remove entity!");
-				delete ent;
 				return;
 			}
-			delete ent;
 		}
 	lastEntityCount = _sceneHolder.GetEntityCount();
 
@@ -1565,6 +1516,7 @@ void Scene::DebugGenerateVolumeTreeStructure()
 
 		reinterpret_cast<Entity *>(obj)->GetTransform()->SetPosition(center);
 		reinterpret_cast<Entity *>(obj)->GetTransform()->SetScale(scale);
+		reinterpret_cast<Entity *>(obj)->SetStatic(true);
 	}
 }
 
@@ -1576,14 +1528,11 @@ void Scene::DebugGenerateEntityBounds()
 	if (lastEntityCount >= 0)
 		for (int i = 0; i < lastBoxCount; i++)
 		{
-			const Entity *ent = _sceneHolder.GetEntity(lastEntityCount);
-			if (!_sceneHolder.RemoveEntity(lastEntityCount))
+			if (!_sceneHolder.RemoveEntity(_sceneHolder.GetEntity(lastEntityCount)))
 			{
 				ErrMsg("Failed to remove entity!");
-				delete ent;
 				return;
 			}
-			delete ent;
 		}
 	lastEntityCount = _sceneHolder.GetEntityCount();
 
@@ -1622,5 +1571,6 @@ void Scene::DebugGenerateEntityBounds()
 
 		reinterpret_cast<Entity *>(obj)->GetTransform()->SetPosition(center);
 		reinterpret_cast<Entity *>(obj)->GetTransform()->SetScale(scale);
+		reinterpret_cast<Entity *>(obj)->SetStatic(true);
 	}
 }
@@ -36,6 +36,23 @@ private:
 
 	bool _doMultiThread = true;
 
+	// Views culled together each frame, along with their cameras & culled entities.
+	std::vector<CullingPlanes> _cullingViews;
+	std::vector<CameraD3D11 *> _cullingViewCameras;
+	std::vector<std::vector<Entity *>> _cullingViewItems;
+
+	// Point light culled as a single view, with the planes of each face enabled in faceMask.
+	struct PointlightView
+	{
+		UINT lightIndex = 0;
+		UINT faceMask = 0;
+		CullingPlanes faces[6];
+	};
+
+	std::vector<PointlightView> _pointlightViews;
+	std::vector<CameraD3D11 *> _pointlightFaceCameras;
+	std::vector<std::vector<Entity *>> _pointlightFaceItems;
+
 	bool _useMainCamera = true;
 	bool _playerPhysics = false;
 	bool _rotateLights = false;
@@ -1,100 +1,406 @@
 #include "SceneHolder.h"
 
 #include "ErrMsg.h"
+#include "Quadtree.h"
+#include "Octree.h"
+#include "LooseOctree.h"
+#include "LinearOctree.h"
+#include "Bvh.h"
+#include "Notree.h"
+#include "HashGrid.h"
 
 
 SceneHolder::~SceneHolder()
 {
-	for (const SceneEntity *ent : _entities)
-		delete ent;
+	_objectPool.Clear();
+	_emitterPool.Clear();
 }
 
-bool SceneHolder::Initialize(const DirectX::BoundingBox &sceneBounds)
+UINT SceneHolder::GetEntitySlot(const UINT id)
+{
+	return id & ENTITY_SLOT_MASK;
+}
+
+std::unique_ptr<VolumeTree> SceneHolder::CreateVolumeTree(const VolumeTreeType type)
+{
+	switch (type)
+	{
+		case VolumeTreeType::QUADTREE:
+			return std::make_unique<Quadtree>();
+
+		case VolumeTreeType::OCTREE:
+			return std::make_unique<Octree>();
+
+		case VolumeTreeType::LOOSE_OCTREE:
+			return std::make_unique<LooseOctree>();
+
+		case VolumeTreeType::LINEAR_OCTREE:
+			return std::make_unique<LinearOctree>();
+
+		case VolumeTreeType::BVH:
+			return std::make_unique<Bvh>();
+
+		case VolumeTreeType::NOTREE:
+			return std::make_unique<Notree>();
+
+		case VolumeTreeType::HASH_GRID:
+			return std::make_unique<HashGrid>();
+	}
+
+	return nullptr;
+}
+
+bool SceneHolder::Initialize(const DirectX::BoundingBox &sceneBounds, const VolumeTreeType treeType)
 {
 	_bounds = sceneBounds;
-	if (!_volumeTree.Initialize(sceneBounds))
+
+	if (!RebuildVolumeTrees(treeType, sceneBounds))
+	{
+		ErrMsg("Failed to create volume trees!");
+		return false;
+	}
+
+	return true;
+}
+
+bool SceneHolder::RebuildVolumeTrees(const VolumeTreeType treeType, const DirectX::BoundingBox &treeBounds)
+{
+	std::unique_ptr<VolumeTree> newTree = CreateVolumeTree(treeType);
+	if (newTree == nullptr)
+	{
+		ErrMsg("Failed to create volume tree!");
+		return false;
+	}
+
+	if (!newTree->Initialize(treeBounds))
 	{
 		ErrMsg("Failed to initialize volume tree!");
 		return false;
 	}
 
+	std::unique_ptr<VolumeTree> newOverflowTree = std::make_unique<Bvh>();
+	if (!newOverflowTree->Initialize(treeBounds))
+	{
+		ErrMsg("Failed to initialize overflow volume tree!");
+		return false;
+	}
+
+	_volumeTree = std::move(newTree);
+	_overflowTree = std::move(newOverflowTree);
+	_overflowEntities.clear();
+	_treeBounds = treeBounds;
+	DirectX::BoundingBox::CreateMerged(_bounds, _bounds, treeBounds);
+
+	// Entities still waiting in the insertion queue are added to the new trees on the next update.
+	std::vector<Entity *> treeEntities;
+	treeEntities.reserve(_entities.size());
+	for (const SceneEntity &ent : _entities)
+	{
+		if (!IsQueuedForInsertion(ent.entity))
+			treeEntities.push_back(ent.entity);
+	}
+
+	InsertIntoTreesBulk(treeEntities);
+
+	if (!_volumeTree->Update())
+	{
+		ErrMsg("Failed to update volume tree!");
+		return false;
+	}
+
+	if (!_overflowTree->Update())
+	{
+		ErrMsg("Failed to update overflow volume tree!");
+		return false;
+	}
+
+	InvalidateViewCaches();
 	return true;
 }
 
 bool SceneHolder::Update()
 {
-	for (const UINT id : _treeInsertionQueue)
+	// Entities have updated for this frame, so their bounds can be computed once for everything that follows.
+	_components.UpdateWorldData();
+
+	InsertIntoTreesBulk(_treeInsertionQueue);
+
+	for (const Entity *entity : _treeInsertionQueue)
+		_isQueuedForInsertion[GetEntitySlot(entity->GetID())] = false;
+	_treeInsertionQueue.clear();
+
+	_freeEntitySlots.insert(_freeEntitySlots.end(), _releasedEntitySlots.begin(), _releasedEntitySlots.end());
+	_releasedEntitySlots.clear();
+
+	if (!_volumeTree->Update())
 	{
-		Entity *entity = GetEntityByID(id);
+		ErrMsg("Failed to update volume tree!");
+		return false;
+	}
 
-		if (entity == nullptr)
+	if (!_overflowTree->Update())
+	{
+		ErrMsg("Failed to update overflow volume tree!");
+		return false;
+	}
+
+	// Stray entities stay in the overflow tree. Once they are a large share of the scene, the world has outgrown
+	// the tree bounds, which are then grown to contain every entity so the bounded tree is used again.
+	const size_t overflowCount = _overflowEntities.size();
+	if (overflowCount >= MIN_OVERFLOW_FOR_GROWTH && static_cast<float>(overflowCount) > static_cast<float>(_entities.size()) * OVERFLOW_GROWTH_RATIO)
+	{
+		const DirectX::BoundingBox grownBounds = {
+			_bounds.Center,
+			{ _bounds.Extents.x * GROWTH_MARGIN, _bounds.Extents.y * GROWTH_MARGIN, _bounds.Extents.z * GROWTH_MARGIN }
+		};
+
+		if (!RebuildVolumeTrees(_volumeTree->GetType(), grownBounds))
 		{
-			ErrMsg(std::format("Failed to update scene holder, entity ID #{} not found!", id));
+			ErrMsg("Failed to grow volume tree bounds!");
 			return false;
 		}
-		
+	}
+
+	_broadphase.Update();
+	return true;
+}
+
+
+bool SceneHolder::IsOverflowing(const DirectX::BoundingBox &bounds) const
+{
+	return _volumeTree->IsBounded() && _treeBounds.Contains(bounds) != DirectX::CONTAINS;
+}
+
+void SceneHolder::InsertIntoTrees(Entity *entity, const DirectX::BoundingBox &bounds)
+{
+	RecordChange(entity, bounds, false);
+
+	if (!IsOverflowing(bounds))
+	{
+		_volumeTree->Insert(entity, bounds);
+		return;
+	}
+
+	DirectX::BoundingBox::CreateMerged(_bounds, _bounds, bounds);
+	_overflowEntities.insert(entity);
+	_overflowTree->Insert(entity, bounds);
+}
+
+// Entities inside the tree bounds are handed to the tree as one batch, letting it build them in bulk.
+void SceneHolder::InsertIntoTreesBulk(const std::vector<Entity *> &entities)
+{
+	std::vector<VolumeTreeItem> items;
+	items.reserve(entities.size());
+
+	for (Entity *entity : entities)
+	{
 		DirectX::BoundingBox entityBounds;
 		entity->StoreBounds(entityBounds);
 
-		_volumeTree.Insert(entity, entityBounds);
+		if (IsOverflowing(entityBounds))
+		{
+			InsertIntoTrees(entity, entityBounds);
+			continue;
+		}
+
+		RecordChange(entity, entityBounds, false);
+		items.push_back({ entity, entityBounds });
+	}
+
+	_volumeTree->InsertBulk(items);
+}
+
+bool SceneHolder::MoveInTrees(Entity *entity, const DirectX::BoundingBox &bounds)
+{
+	RecordChange(entity, bounds, false);
+
+	const bool
+		wasOverflowing = _overflowEntities.contains(entity),
+		isOverflowing = IsOverflowing(bounds);
+
+	if (isOverflowing)
+		DirectX::BoundingBox::CreateMerged(_bounds, _bounds, bounds);
+
+	if (wasOverflowing == isOverflowing)
+		return (isOverflowing ? _overflowTree : _volumeTree)->Move(entity, bounds);
+
+	// Crossed the tree bounds, move the entity over to the other tree.
+	if (isOverflowing)
+	{
+		if (!_volumeTree->Remove(entity))
+			return false;
+
+		_overflowEntities.insert(entity);
+		_overflowTree->Insert(entity, bounds);
+	}
+	else
+	{
+		if (!_overflowTree->Remove(entity))
+			return false;
+
+		_overflowEntities.erase(entity);
+		_volumeTree->Insert(entity, bounds);
 	}
-	_treeInsertionQueue.clear();
 
 	return true;
 }
 
+bool SceneHolder::RemoveFromTrees(Entity *entity, const DirectX::BoundingBox &bounds)
+{
+	RecordChange(entity, bounds, true);
+
+	if (!_overflowEntities.erase(entity))
+		return _volumeTree->Remove(entity, bounds);
+
+	return _overflowTree->Remove(entity, bounds);
+}
+
+bool SceneHolder::IsQueuedForInsertion(const Entity *entity) const
+{
+	const UINT slot = GetEntitySlot(entity->GetID());
+	return slot < _isQueuedForInsertion.size() && _isQueuedForInsertion[slot];
+}
+
+
+void SceneHolder::RecordChange(Entity *entity, const DirectX::BoundingBox &bounds, const bool isRemoved)
+{
+	// Past this size, patching would cost more than culling again.
+	if (_changeLog.size() >= MAX_CHANGE_LOG_SIZE)
+		InvalidateViewCaches();
+
+	const UINT id = entity->GetID();
+	const UINT slot = GetEntitySlot(id);
+	if (slot >= _entityChangeStamps.size())
+		_entityChangeStamps.resize(slot + 1, 0);
+
+	_changeLog.push_back({ entity, id, bounds, isRemoved });
+	_entityChangeStamps[slot] = _changeLogStart + _changeLog.size();
+
+	if (isRemoved)
+		_broadphase.RemoveBody(slot);
+	else
+		_broadphase.SetBody(slot, entity, bounds);
+}
+
+void SceneHolder::InvalidateViewCaches()
+{
+	_structureVersion++;
+	_changeLogStart += _changeLog.size();
+	_changeLog.clear();
+}
+
 
 // Entity is Not initialized automatically. Initialize manually through the returned pointer.
 Entity *SceneHolder::AddEntity(const DirectX::BoundingBox &bounds, const EntityType type)
 {
-	SceneEntity *newEntity = new SceneEntity(_entityCounter, bounds, type);
-	_entities.push_back(newEntity);
-	_entityCounter++;
+	const bool isOutOfNewSlots = _entitySlots.size() >= ENTITY_SLOT_MASK;
+
+	UINT slot;
+	if (_freeEntitySlots.size() >= MIN_FREE_ENTITY_SLOTS || (isOutOfNewSlots && !_freeEntitySlots.empty()))
+	{
+		slot = _freeEntitySlots.front();
+		_freeEntitySlots.pop_front();
+	}
+	else
+	{
+		slot = static_cast<UINT>(_entitySlots.size());
+		if (isOutOfNewSlots)
+		{
+			ErrMsg("Failed to add entity, out of entity slots!");
+			return nullptr;
+		}
+
+		_entitySlots.emplace_back();
+		_isQueuedForInsertion.push_back(false);
+	}
+
+	EntitySlot &entitySlot = _entitySlots[slot];
+	entitySlot.index = static_cast<UINT>(_entities.size());
 
+	const UINT id = (entitySlot.generation << ENTITY_SLOT_BITS) | slot;
+
+	SceneEntity newEntity;
+	newEntity.type = type;
 	switch (type)
 	{
 		case EntityType::OBJECT:
-			_treeInsertionQueue.push_back((reinterpret_cast<Entity *>(newEntity->_item.object))->GetID());
-			return reinterpret_cast<Entity *>(_entities.back()->_item.object);
+			newEntity.entity = reinterpret_cast<Entity *>(_objectPool.Create(newEntity.poolIndex, id, slot, bounds, &_nameTable, &_components));
+			break;
 
 		case EntityType::EMITTER:
-			_treeInsertionQueue.push_back((reinterpret_cast<Entity *>(newEntity->_item.emitter))->GetID());
-			return reinterpret_cast<Entity *>(_entities.back()->_item.emitter);
+			newEntity.entity = reinterpret_cast<Entity *>(_emitterPool.Create(newEntity.poolIndex, id, slot, bounds, &_nameTable, &_components));
+			_components.SetSleepless(slot); // Particles are simulated every frame, moving or not.
+			break;
 	}
 
-	return nullptr;
+	_entities.push_back(newEntity);
+	_isQueuedForInsertion[slot] = true;
+
+	_treeInsertionQueue.push_back(newEntity.entity);
+	return newEntity.entity;
 }
 
 bool SceneHolder::RemoveEntity(Entity *entity)
 {
-	for (auto& child : *entity->GetChildren())
+	if (GetEntityByID(entity->GetID()) != entity)
 	{
-		if (!RemoveEntity(child))
+		ErrMsg("Failed to remove entity, entity is not in the scene!");
+		return false;
+	}
+
+	// Destroying a child also removes it from the children of the entity.
+	const std::vector<Entity *> &children = *entity->GetChildren();
+	while (!children.empty())
+	{
+		if (!RemoveEntity(children.back()))
 		{
 			ErrMsg("Failed to remove child entity!");
-			delete child;
 			return false;
 		}
-		delete child;
 	}
 
-	DirectX::BoundingBox entityBounds;
-	entity->StoreBounds(entityBounds);
+	if (IsQueuedForInsertion(entity))
+	{ // Never made it into the trees.
+		_isQueuedForInsertion[GetEntitySlot(entity->GetID())] = false;
+		std::erase(_treeInsertionQueue, entity);
+	}
+	else
+	{
+		DirectX::BoundingBox entityBounds;
+		entity->StoreBounds(entityBounds);
+
+		if (!RemoveFromTrees(entity, entityBounds))
+		{
+			ErrMsg("Failed to remove entity from volume tree!");
+			return false;
+		}
+	}
+
+	// Fill the gap with the last entity to keep the entities dense.
+	const UINT slot = GetEntitySlot(entity->GetID());
+	EntitySlot &entitySlot = _entitySlots[slot];
 
-	if (!_volumeTree.Remove(entity, entityBounds))
+	const SceneEntity removed = _entities[entitySlot.index];
+	const SceneEntity &last = _entities.back();
+	_entities[entitySlot.index] = last;
+	_entitySlots[GetEntitySlot(last.entity->GetID())].index = entitySlot.index;
+	_entities.pop_back();
+
+	entitySlot.index = 0xffffffff;
+	if (entitySlot.generation < ENTITY_GENERATION_MASK)
 	{
-		ErrMsg("Failed to remove entity from volume tree!");
-		return false;
+		entitySlot.generation++;
+		_releasedEntitySlots.push_back(slot);
 	}
 
-	switch (entity->GetType())
+	switch (removed.type)
 	{
 		case EntityType::OBJECT:
-			std::erase_if(_entities, [entity](const SceneEntity *item) { return reinterpret_cast<Entity *>(item->_item.object) == entity; });
+			_objectPool.Destroy(removed.poolIndex);
 			break;
 
 		case EntityType::EMITTER:
-			std::erase_if(_entities, [entity](const SceneEntity *item) { return reinterpret_cast<Entity *>(item->_item.emitter) == entity; });
+			_emitterPool.Destroy(removed.poolIndex);
 			break;
 	}
 
@@ -103,40 +409,62 @@ bool SceneHolder::RemoveEntity(Entity *entity)
 
 bool SceneHolder::RemoveEntity(const UINT id)
 {
-	if (id >= _entities.size())
+	Entity *entity = GetEntityByID(id);
+	if (entity == nullptr)
 	{
-		ErrMsg("Failed to remove entity, ID out of range!");
+		ErrMsg("Failed to remove entity, ID is not in use!");
 		return false;
 	}
 
-	switch (_entities[id]->_type)
-	{
-		case EntityType::OBJECT:
-			return RemoveEntity(reinterpret_cast<Entity *>(_entities[id]->_item.object));
-
-		case EntityType::EMITTER:
-			return RemoveEntity(reinterpret_cast<Entity *>(_entities[id]->_item.emitter));
-	}
-
-	return false;
+	return RemoveEntity(entity);
 }
 
 
 bool SceneHolder::UpdateEntityPosition(Entity *entity)
 {
-	DirectX::BoundingBox entityBounds;
-	entity->StoreBounds(entityBounds);
+	// The volume tree keeps the bounds each entity was inserted with, so children have to be moved along with their parent.
+	entity->SetDirty();
 
-	if (!_volumeTree.Remove(entity))
+	// Entities still in the insertion queue are inserted with up-to-date bounds on the next update.
+	if (!IsQueuedForInsertion(entity))
 	{
-		ErrMsg("Failed to remove entity from volume tree!");
-		return false;
+		_components.UpdateWorldData(GetEntitySlot(entity->GetID()));
+
+		DirectX::BoundingBox entityBounds;
+		entity->StoreBounds(entityBounds);
+
+		if (!MoveInTrees(entity, entityBounds))
+		{
+			ErrMsg("Failed to move entity in volume tree!");
+			return false;
+		}
+	}
+
+	for (Entity *child : *entity->GetChildren())
+	{
+		if (!UpdateEntityPosition(child))
+		{
+			ErrMsg("Failed to update child entity position!");
+			return false;
+		}
 	}
 
-	_volumeTree.Insert(entity, entityBounds);
 	return true;
 }
 
+bool SceneHolder::SetVolumeTreeType(const VolumeTreeType treeType)
+{
+	if (_volumeTree != nullptr && _volumeTree->GetType() == treeType)
+		return true;
+
+	return RebuildVolumeTrees(treeType, _treeBounds);
+}
+
+VolumeTreeType SceneHolder::GetVolumeTreeType() const
+{
+	return _volumeTree->GetType();
+}
+
 const DirectX::BoundingBox& SceneHolder::GetBounds() const
 {
 	return _bounds;
@@ -151,82 +479,56 @@ Entity *SceneHolder::GetEntity(const UINT i) const
 		return nullptr;
 	}
 
-	switch (_entities[i]->_type)
-	{
-		case EntityType::OBJECT:
-			return reinterpret_cast<Entity *>(_entities[i]->_item.object);
-
-		case EntityType::EMITTER:
-			return reinterpret_cast<Entity *>(_entities[i]->_item.emitter);
-	}
-
-	return nullptr;
+	return _entities[i].entity;
 }
 
 Entity *SceneHolder::GetEntityByID(const UINT id) const
 {
-	const UINT entityCount = GetEntityCount();
-	for (UINT i = 0; i < entityCount; i++)
-	{
-		switch (_entities[i]->_type)
-		{
-			case EntityType::OBJECT:
-				if (reinterpret_cast<Entity *>(_entities[i]->_item.object)->GetID() != id)
-					break;
-				return reinterpret_cast<Entity *>(_entities[i]->_item.object);
-
-			case EntityType::EMITTER:
-				if (reinterpret_cast<Entity *>(_entities[i]->_item.emitter)->GetID() != id)
-					break;
-				return reinterpret_cast<Entity *>(_entities[i]->_item.emitter);
-		}
-	}
+	const UINT slot = GetEntitySlot(id);
+	if (slot >= _entitySlots.size())
+		return nullptr;
 
-	return nullptr;
+	const EntitySlot &entitySlot = _entitySlots[slot];
+	if (entitySlot.index == 0xffffffff || entitySlot.generation != id >> ENTITY_SLOT_BITS)
+		return nullptr;
+
+	return _entities[entitySlot.index].entity;
 }
 
 Entity *SceneHolder::GetEntityByName(const std::string &name) const
 {
-	const UINT entityCount = GetEntityCount();
-	for (UINT i = 0; i < entityCount; i++)
+	const UINT nameID = _nameTable.Find(name);
+	if (nameID == EntityNameTable::INVALID_NAME_ID)
+		return nullptr;
+
+	for (Entity *entity : _nameTable.GetEntities(nameID))
 	{
-		switch (_entities[i]->_type)
-		{
-			case EntityType::OBJECT:
-				if (reinterpret_cast<Entity *>(_entities[i]->_item.object)->GetName() == name)
-					return reinterpret_cast<Entity *>(_entities[i]->_item.object);
-				break;
-
-			case EntityType::EMITTER:
-				if (reinterpret_cast<Entity *>(_entities[i]->_item.emitter)->GetName() == name)
-					return reinterpret_cast<Entity *>(_entities[i]->_item.emitter);
-				break;
-		}
+		if (GetEntityByID(entity->GetID()) == entity)
+			return entity;
 	}
 
 	return nullptr;
 }
 
-UINT SceneHolder::GetEntityIndex(const Entity *entity) const
+void SceneHolder::GetEntitiesByName(const std::string &name, std::vector<Entity *> &entities) const
 {
-	const UINT entityCount = GetEntityCount();
-	for (UINT i = 0; i < entityCount; i++)
+	const UINT nameID = _nameTable.Find(name);
+	if (nameID == EntityNameTable::INVALID_NAME_ID)
+		return;
+
+	for (Entity *entity : _nameTable.GetEntities(nameID))
 	{
-		switch (_entities[i]->_type)
-		{
-			case EntityType::OBJECT:
-				if (entity == reinterpret_cast<Entity *>(_entities[i]->_item.object))
-					return i;
-				break;
-
-			case EntityType::EMITTER:
-				if (entity == reinterpret_cast<Entity *>(_entities[i]->_item.emitter))
-					return i;
-				break;
-		}
+		if (GetEntityByID(entity->GetID()) == entity)
+			entities.push_back(entity);
 	}
+}
 
-	return 0xffffffff;
+UINT SceneHolder::GetEntityIndex(const Entity *entity) const
+{
+	if (GetEntityByID(entity->GetID()) != entity)
+		return 0xffffffff;
+
+	return _entitySlots[GetEntitySlot(entity->GetID())].index;
 }
 
 UINT SceneHolder::GetEntityCount() const
@@ -234,19 +536,10 @@ UINT SceneHolder::GetEntityCount() const
 	return static_cast<UINT>(_entities.size());
 }
 
-void SceneHolder::GetEntities(std::vector<Entity *> entities) const
+void SceneHolder::GetEntities(std::vector<Entity *> &entities) const
 {
-	for (const SceneEntity *ent : _entities)
-		switch (ent->_type)
-		{
-			case EntityType::OBJECT:
-				entities.push_back(reinterpret_cast<Entity *>(ent->_item.object));
-				break;
-
-			case EntityType::EMITTER:
-				entities.push_back(reinterpret_cast<Entity *>(ent->_item.emitter));
-				break;
-		}
+	for (const SceneEntity &ent : _entities)
+		entities.push_back(ent.entity);
 }
 
 
@@ -255,12 +548,18 @@ bool SceneHolder::FrustumCull(const DirectX::BoundingFrustum &frustum, std::vect
 	std::vector<Entity *> containingInterfaces;
 	containingInterfaces.reserve(_entities.capacity());
 
-	if (!_volumeTree.FrustumCull(frustum, containingInterfaces))
+	if (!_volumeTree->FrustumCull(frustum, containingInterfaces))
 	{
 		ErrMsg("Failed to frustum cull volume tree!");
 		return false;
 	}
 
+	if (!_overflowEntities.empty() && !_overflowTree->FrustumCull(frustum, containingInterfaces))
+	{
+		ErrMsg("Failed to frustum cull overflow volume tree!");
+		return false;
+	}
+
 	for (Entity *iEnt : containingInterfaces)
 		containingItems.push_back(iEnt);
 
@@ -272,35 +571,367 @@ bool SceneHolder::BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<E
 	std::vector<Entity *> containingInterfaces;
 	containingInterfaces.reserve(_entities.capacity());
 
-#ifdef QUADTREE_CULLING
-#elif defined OCTREE_CULLING
-#endif
-	if (!_volumeTree.BoxCull(box, containingInterfaces))
+	if (!_volumeTree->BoxCull(box, containingInterfaces))
 	{
 		ErrMsg("Failed to box cull volume tree!");
 		return false;
 	}
 
+	if (!_overflowEntities.empty() && !_overflowTree->BoxCull(box, containingInterfaces))
+	{
+		ErrMsg("Failed to box cull overflow volume tree!");
+		return false;
+	}
+
 	for (Entity *iEnt : containingInterfaces)
 		containingItems.push_back(iEnt);
 
 	return true;
 }
 
+bool SceneHolder::MultiViewCull(const std::vector<CullingPlanes> &views, std::vector<std::vector<Entity *>> &viewItems) const
+{
+	viewItems.resize(views.size());
+
+	// Each traversal handles as many views as fit in a view mask.
+	for (size_t first = 0; first < views.size(); first += MAX_CULLING_VIEWS)
+	{
+		const UINT viewCount = static_cast<UINT>((std::min)(views.size() - first, static_cast<size_t>(MAX_CULLING_VIEWS)));
+		const MultiViewQuery query(&views[first], &viewItems[first], viewCount);
+
+		if (!_volumeTree->MultiViewCull(query))
+		{
+			ErrMsg("Failed to multi-view cull volume tree!");
+			return false;
+		}
+
+		if (!_overflowEntities.empty() && !_overflowTree->MultiViewCull(query))
+		{
+			ErrMsg("Failed to multi-view cull overflow volume tree!");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SceneHolder::FindNearest(const DirectX::XMFLOAT3 &point, UINT count, std::vector<NearestItem> &nearestItems, float maxDistance) const
+{
+	if (count == 0)
+		return true;
+
+	NearestQuery query(point, maxDistance, count, nearestItems);
+	return QueryNearest(query);
+}
+
+bool SceneHolder::FindInRadius(const DirectX::XMFLOAT3 &point, float radius, std::vector<NearestItem> &nearestItems) const
+{
+	NearestQuery query(point, radius, 0, nearestItems);
+	return QueryNearest(query);
+}
+
+bool SceneHolder::QueryNearest(NearestQuery &query) const
+{
+	if (!_volumeTree->NearestCull(query))
+	{
+		ErrMsg("Failed to find nearest entities in volume tree!");
+		return false;
+	}
+
+	// Both trees share one query, so entities found in the overflow tree compete with those already found.
+	if (!_overflowEntities.empty() && !_overflowTree->NearestCull(query))
+	{
+		ErrMsg("Failed to find nearest entities in overflow volume tree!");
+		return false;
+	}
+
+	query.End();
+	return true;
+}
+
+
+bool SceneHolder::PatchViewCache(ViewCache &cache) const
+{
+	const size_t changeSequence = _changeLogStart + _changeLog.size();
+
+	if (cache.structureVersion != _structureVersion || changeSequence - cache.changeSequence > MAX_PATCHED_CHANGES)
+		return false;
+
+	if (cache.changeSequence == changeSequence)
+		return true;
+
+	// Drop every entity that changed since the view was culled...
+	size_t keptCount = 0;
+	for (size_t i = 0; i < cache.items.size(); i++)
+	{
+		if (_entityChangeStamps[GetEntitySlot(cache.itemIDs[i])] > cache.changeSequence)
+			continue;
+
+		cache.items[keptCount] = cache.items[i];
+		cache.itemIDs[keptCount] = cache.itemIDs[i];
+		keptCount++;
+	}
+	cache.items.resize(keptCount);
+	cache.itemIDs.resize(keptCount);
+
+	// ...then add back the ones that still exist & are seen at their latest bounds.
+	for (size_t i = cache.changeSequence - _changeLogStart; i < _changeLog.size(); i++)
+	{
+		const EntityChange &change = _changeLog[i];
+		if (change.isRemoved || _entityChangeStamps[GetEntitySlot(change.id)] != _changeLogStart + i + 1)
+			continue;
+
+		if (ClassifyBox(cache.planes, CULLING_ALL_PLANES, change.bounds) == CULLING_OUTSIDE)
+			continue;
+
+		cache.items.push_back(change.entity);
+		cache.itemIDs.push_back(change.id);
+	}
+
+	cache.changeSequence = changeSequence;
+	return true;
+}
+
+bool SceneHolder::CachedMultiViewCull(const std::vector<CullingPlanes> &views, const std::vector<CameraD3D11 *> &viewCameras,
+	std::vector<std::vector<Entity *>> &viewItems)
+{
+	viewItems.resize(views.size());
+	_viewCacheFrame++;
+
+	_staleViews.clear();
+	_staleViewCaches.clear();
+
+	for (size_t i = 0; i < views.size(); i++)
+	{
+		ViewCache &cache = _viewCaches[viewCameras[i]];
+		cache.lastUsed = _viewCacheFrame;
+
+		if (cache.planes == views[i] && PatchViewCache(cache))
+			continue;
+
+		cache.planes = views[i];
+		_staleViews.push_back(views[i]);
+		_staleViewCaches.push_back(&cache);
+	}
+
+	// Caches of cameras that were not culled this time may be for views that no longer exist.
+	std::erase_if(_viewCaches, [this](const auto &entry) { return entry.second.lastUsed != _viewCacheFrame; });
+
+	if (!_staleViews.empty())
+	{
+		if (_staleViewItems.size() < _staleViews.size())
+			_staleViewItems.resize(_staleViews.size());
+
+		for (size_t i = 0; i < _staleViews.size(); i++)
+			_staleViewItems[i].clear();
+
+		if (!MultiViewCull(_staleViews, _staleViewItems))
+		{
+			ErrMsg("Failed to cull stale views!");
+			return false;
+		}
+
+		const size_t changeSequence = _changeLogStart + _changeLog.size();
+		for (size_t i = 0; i < _staleViews.size(); i++)
+		{
+			ViewCache &cache = *_staleViewCaches[i];
+			cache.items.swap(_staleViewItems[i]);
+			cache.structureVersion = _structureVersion;
+			cache.changeSequence = changeSequence;
+
+			cache.itemIDs.clear();
+			for (const Entity *entity : cache.items)
+				cache.itemIDs.push_back(entity->GetID());
+		}
+	}
+
+	for (size_t i = 0; i < views.size(); i++)
+	{
+		const std::vector<Entity *> &cachedItems = _viewCaches[viewCameras[i]].items;
+		viewItems[i].insert(viewItems[i].end(), cachedItems.begin(), cachedItems.end());
+	}
+
+	return true;
+}
+
+
+const std::vector<CollisionPair> &SceneHolder::GetCollisionPairs() const
+{
+	return _broadphase.GetPairs();
+}
+
+const std::vector<CollisionPair> &SceneHolder::GetBeganCollisionPairs() const
+{
+	return _broadphase.GetBeganPairs();
+}
+
+const std::vector<CollisionPair> &SceneHolder::GetEndedCollisionPairs() const
+{
+	return _broadphase.GetEndedPairs();
+}
+
+
+bool SceneHolder::RaycastTrees(const DirectX::XMFLOAT3A &origin, const DirectX::XMFLOAT3A &direction, float &length, Entity *&entity, RaycastItemTest *itemTest) const
+{
+	entity = nullptr;
+	_volumeTree->RaycastTree(origin, direction, length, entity, itemTest);
+
+	// Length now holds the closest hit so far, so the overflow tree only reports closer hits.
+	Entity *overflowEntity = nullptr;
+	if (!_overflowEntities.empty() && _overflowTree->RaycastTree(origin, direction, length, overflowEntity, itemTest))
+		entity = overflowEntity;
+
+	return (entity != nullptr);
+}
 
 bool SceneHolder::Raycast(const DirectX::XMFLOAT3A &origin, const DirectX::XMFLOAT3A &direction, RaycastOut &result) const
 {
-#ifdef QUADTREE_CULLING
-#elif defined OCTREE_CULLING
-#endif
-	return _volumeTree.RaycastTree(origin, direction, result.distance, result.entity);
+	return RaycastTrees(origin, direction, result.distance, result.entity, nullptr);
+}
+
+// Raycasts objects against their mesh in object space, remembering the triangle of the closest hit of each ray.
+// Entities without a mesh are hit where the ray enters their bounds.
+class MeshRaycastTest final : public RaycastItemTest
+{
+private:
+	const RaycastIn *_rays;
+	const Content &_content;
+
+public:
+	std::vector<TriangleRaycastHit> closestHits;
+
+	MeshRaycastTest(const RaycastIn *rays, const size_t rayCount, const Content &content) :
+		_rays(rays), _content(content), closestHits(rayCount)
+	{
+	}
+
+	[[nodiscard]] bool Test(Entity *entity, const float maxLength, float &length) override
+	{
+		using namespace DirectX;
+
+		const MeshD3D11 *mesh = nullptr;
+		if (entity->GetType() == EntityType::OBJECT)
+			mesh = _content.GetMesh(reinterpret_cast<Object *>(entity)->GetMeshID(0));
+
+		if (mesh == nullptr || mesh->GetTriangleBvh().IsEmpty())
+		{
+			closestHits[ray] = { };
+			return true;
+		}
+
+		XMVECTOR determinant;
+		const XMMATRIX worldToObject = XMMatrixInverse(&determinant, entity->GetWorldMatrix());
+		if (XMVectorGetX(determinant) == 0.0f)
+			return false;
+
+		// The direction is not renormalized, keeping hit distances in world units.
+		XMFLOAT3 localOrigin, localDirection;
+		XMStoreFloat3(&localOrigin, XMVector3TransformCoord(XMLoadFloat3A(&_rays[ray].origin), worldToObject));
+		XMStoreFloat3(&localDirection, XMVector3TransformNormal(XMLoadFloat3A(&_rays[ray].direction), worldToObject));
+
+		TriangleRaycastHit hit;
+		hit.distance = maxLength;
+		if (!mesh->GetTriangleBvh().Raycast(localOrigin, localDirection, hit))
+			return false;
+
+		closestHits[ray] = hit;
+		length = hit.distance;
+		return true;
+	}
+};
+
+bool SceneHolder::Raycast(const DirectX::XMFLOAT3A &origin, const DirectX::XMFLOAT3A &direction, const Content &content, RaycastOut &result) const
+{
+	const RaycastIn ray = { origin, direction, result.distance };
+
+	MeshRaycastTest meshTest(&ray, 1, content);
+	if (!RaycastTrees(origin, direction, result.distance, result.entity, &meshTest))
+		return false;
+
+	result.triangle = meshTest.closestHits[0].triangle;
+	result.u = meshTest.closestHits[0].u;
+	result.v = meshTest.closestHits[0].v;
+	return true;
+}
+
+void SceneHolder::RaycastPackets(const std::vector<RaycastIn> &rays, const RaycastMode mode, RaycastItemTest *itemTest, std::vector<RaycastOut> &results) const
+{
+	results.assign(rays.size(), RaycastOut());
+
+	// Rays are packed by the octant they point into, keeping the rays of each packet coherent.
+	auto getOctant = [](const DirectX::XMFLOAT3A &dir)
+	{
+		return (dir.x < 0.0f ? 1u : 0u) | (dir.y < 0.0f ? 2u : 0u) | (dir.z < 0.0f ? 4u : 0u);
+	};
+
+	UINT octantStart[9] = { };
+	for (const RaycastIn &ray : rays)
+		octantStart[getOctant(ray.direction) + 1]++;
+
+	for (UINT i = 1; i < 9; i++)
+		octantStart[i] += octantStart[i - 1];
+
+	std::vector<UINT> rayOrder(rays.size());
+	for (UINT i = 0; i < rays.size(); i++)
+		rayOrder[octantStart[getOctant(rays[i].direction)]++] = i;
+
+	RayPacket packet;
+	packet.Clear(mode);
+
+	for (size_t i = 0; i < rayOrder.size(); i++)
+	{
+		const RaycastIn &ray = rays[rayOrder[i]];
+		packet.AddRay(
+			{ ray.origin.x, ray.origin.y, ray.origin.z },
+			{ ray.direction.x, ray.direction.y, ray.direction.z },
+			ray.maxDistance, rayOrder[i]
+		);
+
+		if (!packet.IsFull() && i + 1 < rayOrder.size())
+			continue;
+
+		_volumeTree->RaycastPacket(packet, itemTest);
+		if (!_overflowEntities.empty())
+			_overflowTree->RaycastPacket(packet, itemTest);
+
+		for (UINT lane = 0; lane < packet.count; lane++)
+		{
+			if (packet.entity[lane] == nullptr)
+				continue;
+
+			RaycastOut &result = results[packet.rayIndex[lane]];
+			result.entity = packet.entity[lane];
+			result.distance = packet.length[lane];
+		}
+
+		packet.Clear(mode);
+	}
+}
+
+void SceneHolder::Raycast(const std::vector<RaycastIn> &rays, const RaycastMode mode, std::vector<RaycastOut> &results) const
+{
+	RaycastPackets(rays, mode, nullptr, results);
+}
+
+void SceneHolder::Raycast(const std::vector<RaycastIn> &rays, const RaycastMode mode, const Content &content, std::vector<RaycastOut> &results) const
+{
+	MeshRaycastTest meshTest(rays.data(), rays.size(), content);
+	RaycastPackets(rays, mode, &meshTest, results);
+
+	for (size_t i = 0; i < rays.size(); i++)
+	{
+		if (results[i].entity == nullptr)
+			continue;
+
+		results[i].triangle = meshTest.closestHits[i].triangle;
+		results[i].u = meshTest.closestHits[i].u;
+		results[i].v = meshTest.closestHits[i].v;
+	}
 }
 
 
 void SceneHolder::DebugGetTreeStructure(std::vector<DirectX::BoundingBox> &boxCollection) const
 {
-#ifdef QUADTREE_CULLING
-#elif defined OCTREE_CULLING
-#endif
-	_volumeTree.DebugGetStructure(boxCollection);
+	_volumeTree->DebugGetStructure(boxCollection);
+	_overflowTree->DebugGetStructure(boxCollection);
 }
@@ -1,106 +1,152 @@
 #pragma once
 
+#include <cfloat>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "Entity.h"
 #include "Object.h"
 #include "Emitter.h"
+#include "VolumeTree.h"
+#include "Broadphase.h"
+#include "EntityPool.h"
 
-#define QUADTREE_CULLING
-//#define OCTREE_CULLING
-//#define NOTREE_CULLING
-
-#ifdef QUADTREE_CULLING
-#include "Quadtree.h"
-#elif defined OCTREE_CULLING
-#include "Octree.h"
-#elif defined NOTREE_CULLING
-#include "Notree.h"
-#endif
 
+struct RaycastIn
+{
+	DirectX::XMFLOAT3A origin = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3A direction = { 0.0f, 0.0f, 1.0f };
+	float maxDistance = FLT_MAX;
+};
 
 struct RaycastOut
 {
 	Entity *entity = nullptr;
 	float distance = FLT_MAX;
+
+	// Triangle & barycentrics of the hit, if it was found by raycasting the triangles of an object mesh.
+	UINT triangle = 0xffffffff;
+	float u = 0.0f, v = 0.0f;
 };
 
 
 class SceneHolder
 {
 private:
+	// Entities are stored in a pool per type, so the entities of each type are packed together in memory.
 	struct SceneEntity
 	{
-		EntityType _type = EntityType::OBJECT;
+		Entity *entity = nullptr;
+		EntityType type = EntityType::OBJECT;
+		UINT poolIndex = 0;
+	};
 
-		union
-		{
-			Object *object = nullptr;
-			Emitter *emitter;
-		} _item;
+	// Views with more entity changes than this since they were last culled are culled again instead of patched.
+	static constexpr size_t MAX_PATCHED_CHANGES = 256;
+	static constexpr size_t MAX_CHANGE_LOG_SIZE = 4096;
 
-		explicit SceneEntity(const UINT id, const DirectX::BoundingBox &bounds, EntityType type)
-		{
-			_type = type;
-
-			switch (type)
-			{
-				case EntityType::OBJECT:
-					_item.object = new Object(id, bounds);
-					break;
-
-				case EntityType::EMITTER:
-					_item.emitter = new Emitter(id, bounds);
-					break;
-			}
-		}
+	// Outliers only trigger a rebuild with grown tree bounds once they make up this share of all entities.
+	static constexpr size_t MIN_OVERFLOW_FOR_GROWTH = 16;
+	static constexpr float OVERFLOW_GROWTH_RATIO = 0.25f;
+	static constexpr float GROWTH_MARGIN = 1.25f;
 
-		~SceneEntity()
-		{
-			switch (_type)
-			{
-				case EntityType::OBJECT:
-					delete _item.object;
-					break;
-
-				case EntityType::EMITTER:
-					delete _item.emitter;
-					break;
-			}
-		}
+	// Entity IDs are handles made of a slot & the generation of that slot, which is bumped whenever its entity is removed.
+	// IDs of removed entities thus never match the entity later given their slot. Slots whose generation would wrap
+	// are retired instead of freed. The last slot is never used, as its last ID would be 0xffffffff, which means "not found".
+	static constexpr UINT ENTITY_SLOT_BITS = 20;
+	static constexpr UINT ENTITY_SLOT_MASK = (1u << ENTITY_SLOT_BITS) - 1;
+	static constexpr UINT ENTITY_GENERATION_MASK = 0xffffffff >> ENTITY_SLOT_BITS;
 
-		SceneEntity(const SceneEntity &other) = delete;
-		SceneEntity &operator=(const SceneEntity &other) = delete;
-		SceneEntity(SceneEntity &&other) = delete;
-		SceneEntity &operator=(SceneEntity &&other) = delete;
+	// Free slots are reused oldest first & only once this many are free, spreading removals over many slots
+	// so a generation takes far longer to run out under steady churn.
+	static constexpr UINT MIN_FREE_ENTITY_SLOTS = 1024;
 
-		Entity *GetEntity() const
-		{
-			switch (_type)
-			{
-			case EntityType::OBJECT:
-				return reinterpret_cast<Entity *>(_item.object);
+	struct EntitySlot
+	{
+		UINT generation = 0;
+		UINT index = 0xffffffff; // Index of the entity in _entities, or 0xffffffff if the slot is free.
+	};
 
-			case EntityType::EMITTER:
-				return reinterpret_cast<Entity *>(_item.emitter);
-			}
+	DirectX::BoundingBox _bounds; // Grows to contain every entity added to the overflow tree.
+	DirectX::BoundingBox _treeBounds;
+	std::vector<SceneEntity> _entities; // Kept dense, removed entities are replaced by the last one.
+	std::vector<EntitySlot> _entitySlots;
+	std::deque<UINT> _freeEntitySlots;
+	std::vector<UINT> _releasedEntitySlots; // Freed since the last Update(), so per-slot state never mixes two entities within a frame.
 
-			return nullptr;
-		}
+	// Entities stay listed under their name until deleted, so lookups skip the ones already removed from the scene.
+	EntityNameTable _nameTable;
+
+	EntityComponents _components;
+
+	// Declared after the name table & components, which entities unregister from when destroyed.
+	EntityPool<Object> _objectPool;
+	EntityPool<Emitter> _emitterPool;
+
+	std::unique_ptr<VolumeTree> _volumeTree;
+	std::vector<Entity *> _treeInsertionQueue;
+	std::vector<bool> _isQueuedForInsertion; // Indexed by entity slot.
+
+	// Entities not fully inside the root of a bounded volume tree are kept in a BVH, which has no fixed bounds.
+	std::unique_ptr<VolumeTree> _overflowTree;
+	std::unordered_set<const Entity *> _overflowEntities;
+
+	// Tree insertions, moves & removals in the order they happened, along with the new bounds of the entity.
+	struct EntityChange
+	{
+		Entity *entity = nullptr;
+		UINT id = 0;
+		DirectX::BoundingBox bounds;
+		bool isRemoved = false;
 	};
 
-	UINT _entityCounter = 0;
+	// Entities a view saw when last culled, valid while the view keeps the same planes.
+	struct ViewCache
+	{
+		CullingPlanes planes;
+		std::vector<Entity *> items;
+		std::vector<UINT> itemIDs; // Entities may be deleted once removed, so they are identified by ID.
+		UINT structureVersion = 0;
+		size_t changeSequence = 0;
+		UINT lastUsed = 0;
+	};
+
+	// Change sequence numbers start at one, so a stamp of zero means the entity has never changed.
+	std::vector<EntityChange> _changeLog;
+	std::vector<size_t> _entityChangeStamps; // Indexed by entity slot.
+	size_t _changeLogStart = 0;
+	UINT _structureVersion = 0;
+
+	std::unordered_map<const CameraD3D11 *, ViewCache> _viewCaches;
+	std::vector<CullingPlanes> _staleViews;
+	std::vector<std::vector<Entity *>> _staleViewItems;
+	std::vector<ViewCache *> _staleViewCaches;
+	UINT _viewCacheFrame = 0;
 
-	DirectX::BoundingBox _bounds;
-	std::vector<SceneEntity *> _entities; 
+	// Follows the same tree insertions, moves & removals as the change log.
+	Broadphase _broadphase;
 
-#ifdef QUADTREE_CULLING
-	Quadtree _volumeTree;
-#elif defined OCTREE_CULLING
-	Octree _volumeTree;
-#elif defined NOTREE_CULLING
-	Notree _volumeTree;
-#endif
+	[[nodiscard]] static std::unique_ptr<VolumeTree> CreateVolumeTree(VolumeTreeType type);
+	[[nodiscard]] static UINT GetEntitySlot(UINT id);
+	[[nodiscard]] bool RebuildVolumeTrees(VolumeTreeType treeType, const DirectX::BoundingBox &treeBounds);
 
-	std::vector<UINT> _treeInsertionQueue;
+	[[nodiscard]] bool IsOverflowing(const DirectX::BoundingBox &bounds) const;
+	void InsertIntoTrees(Entity *entity, const DirectX::BoundingBox &bounds);
+	void InsertIntoTreesBulk(const std::vector<Entity *> &entities);
+	[[nodiscard]] bool MoveInTrees(Entity *entity, const DirectX::BoundingBox &bounds);
+	[[nodiscard]] bool RemoveFromTrees(Entity *entity, const DirectX::BoundingBox &bounds);
+	[[nodiscard]] bool IsQueuedForInsertion(const Entity *entity) const;
+
+	void RecordChange(Entity *entity, const DirectX::BoundingBox &bounds, bool isRemoved);
+	void InvalidateViewCaches();
+	[[nodiscard]] bool PatchViewCache(ViewCache &cache) const;
+
+	[[nodiscard]] bool QueryNearest(NearestQuery &query) const;
+
+	bool RaycastTrees(const DirectX::XMFLOAT3A &origin, const DirectX::XMFLOAT3A &direction, float &length, Entity *&entity, RaycastItemTest *itemTest) const;
+
+	void RaycastPackets(const std::vector<RaycastIn> &rays, RaycastMode mode, RaycastItemTest *itemTest, std::vector<RaycastOut> &results) const;
 
 
 public:
@@ -116,28 +162,88 @@ public:
 	SceneHolder(SceneHolder &&other) = delete;
 	SceneHolder &operator=(SceneHolder &&other) = delete;
 
-	[[nodiscard]] bool Initialize(const DirectX::BoundingBox &sceneBounds);
+	[[nodiscard]] bool Initialize(const DirectX::BoundingBox &sceneBounds, VolumeTreeType treeType = VolumeTreeType::QUADTREE);
 	[[nodiscard]] bool Update();
 
 	[[nodiscard]] Entity *AddEntity(const DirectX::BoundingBox &bounds, EntityType type);
-	// Entity must be manually deleted after calling!
+	// Destroys the entity & its children. Removing an entity moves the last entity to its index.
 	[[nodiscard]] bool RemoveEntity(Entity *entity);
 	[[nodiscard]] bool RemoveEntity(UINT id);
 
 	[[nodiscard]] bool UpdateEntityPosition(Entity *entity);
 
+	// Rebuilds the volume tree from all entities currently in the scene using the given backend.
+	[[nodiscard]] bool SetVolumeTreeType(VolumeTreeType treeType);
+	[[nodiscard]] VolumeTreeType GetVolumeTreeType() const;
+
+	// Bounds containing every entity, which grow past the bounds given to Initialize() as entities leave them.
 	[[nodiscard]] const DirectX::BoundingBox &GetBounds() const;
 	[[nodiscard]] Entity *GetEntity(UINT i) const;
+	// Returns nullptr if the ID belongs to an entity that has been removed.
 	[[nodiscard]] Entity *GetEntityByID(UINT id) const;
+	// Returns any one of the entities with the name.
 	[[nodiscard]] Entity *GetEntityByName(const std::string &name) const;
+	// Appends every entity with the name.
+	void GetEntitiesByName(const std::string &name, std::vector<Entity *> &entities) const;
 	[[nodiscard]] UINT GetEntityIndex(const Entity *entity) const;
 	[[nodiscard]] UINT GetEntityCount() const;
-	void GetEntities(std::vector<Entity *> entities) const;
+	void GetEntities(std::vector<Entity *> &entities) const;
+
+	// Calls func on every entity, one type at a time in the order they are stored in memory, which is faster than
+	// iterating by index. Stops early if func returns false. Returns whether every call returned true.
+	template <typename Func>
+	[[nodiscard]] bool ForEachEntity(Func &&func) const
+	{
+		if (!_objectPool.ForEach([&func](Object *object) { return func(reinterpret_cast<Entity *>(object)); }))
+			return false;
+
+		return _emitterPool.ForEach([&func](Emitter *emitter) { return func(reinterpret_cast<Entity *>(emitter)); });
+	}
+
+	// Calls func on every awake entity, including entities woken by func. Sleeping entities have not moved in a while & are skipped.
+	// Stops early if func returns false. Returns whether every call returned true.
+	template <typename Func>
+	[[nodiscard]] bool ForEachAwakeEntity(Func &&func) const
+	{
+		const std::vector<UINT> &awakeSlots = _components.GetAwakeSlots();
+		for (size_t i = 0; i < awakeSlots.size(); i++)
+		{
+			if (!func(_entities[_entitySlots[awakeSlots[i]].index].entity))
+				return false;
+		}
+
+		return true;
+	}
 
 	[[nodiscard]] bool FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const;
 	[[nodiscard]] bool BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const;
+	// Culls every view in as few tree traversals as possible, appending the entities seen by view i to viewItems[i].
+	[[nodiscard]] bool MultiViewCull(const std::vector<CullingPlanes> &views, std::vector<std::vector<Entity *>> &viewItems) const;
+	// Same as MultiViewCull(), but remembers what the view of each camera saw. Views whose planes are unchanged since
+	// the previous call are patched with the entities that changed since then, only the others traverse the tree.
+	// Each camera may only appear once per call.
+	[[nodiscard]] bool CachedMultiViewCull(const std::vector<CullingPlanes> &views, const std::vector<CameraD3D11 *> &viewCameras,
+		std::vector<std::vector<Entity *>> &viewItems);
+
+	// Appends up to count entities nearest to the point & within maxDistance of it, nearest first.
+	// Distances are measured to the entity bounds. At most MAX_NEAREST_ITEMS entities are found per call.
+	[[nodiscard]] bool FindNearest(const DirectX::XMFLOAT3 &point, UINT count, std::vector<NearestItem> &nearestItems, float maxDistance = FLT_MAX) const;
+	// Appends every entity whose bounds lie within radius of the point, nearest first.
+	[[nodiscard]] bool FindInRadius(const DirectX::XMFLOAT3 &point, float radius, std::vector<NearestItem> &nearestItems) const;
+
+	// Entity pairs with overlapping bounds as of the last Update(), along with the pairs that started & stopped overlapping then.
+	// Pairs are only valid until the next RemoveEntity(), as they may reference the removed entity.
+	[[nodiscard]] const std::vector<CollisionPair> &GetCollisionPairs() const;
+	[[nodiscard]] const std::vector<CollisionPair> &GetBeganCollisionPairs() const;
+	[[nodiscard]] const std::vector<CollisionPair> &GetEndedCollisionPairs() const;
 
 	bool Raycast(const DirectX::XMFLOAT3A &origin, const DirectX::XMFLOAT3A &direction, RaycastOut &result) const;
+	// Raycasts the triangles of object meshes, using entity bounds only to find the objects to test.
+	bool Raycast(const DirectX::XMFLOAT3A &origin, const DirectX::XMFLOAT3A &direction, const Content &content, RaycastOut &result) const;
+
+	// Raycasts every ray, writing the hit of rays[i] to results[i]. Rays are traced in packets, grouped by direction.
+	void Raycast(const std::vector<RaycastIn> &rays, RaycastMode mode, std::vector<RaycastOut> &results) const;
+	void Raycast(const std::vector<RaycastIn> &rays, RaycastMode mode, const Content &content, std::vector<RaycastOut> &results) const;
 
 	void DebugGetTreeStructure(std::vector<DirectX::BoundingBox> &boxCollection) const;
 };
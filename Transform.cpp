@@ -118,6 +118,7 @@ bool Transform::Initialize(ID3D11Device *device, const XMMATRIX& worldMatrix)
 
 	NormalizeBases();
 	OrthogonalizeBases();
+	SetDirty();
 
 	const XMMATRIX transposeWorldMatrix = XMMatrixTranspose(GetWorldMatrix());
 	const XMMATRIX worldMatrixData[2] = {
@@ -131,7 +132,6 @@ bool Transform::Initialize(ID3D11Device *device, const XMMATRIX& worldMatrix)
 		return false;
 	}
 
-	SetDirty();
 	return true;
 }
 
@@ -332,6 +332,7 @@ const XMFLOAT4A &Transform::GetForward() const	{ return _forward;	}
 void Transform::SetDirty()
 {
 	_isDirty = true;
+	_isWorldMatrixDirty = true;
 
 	for (auto child : _children)
 		child->SetDirty();
@@ -345,7 +346,12 @@ bool Transform::GetDirty() const
 
 bool Transform::UpdateConstantBuffer(ID3D11DeviceContext *context)
 {
-	const XMMATRIX transposeWorldMatrix = XMMatrixTranspose(GetWorldMatrix());
+	return UpdateConstantBuffer(context, GetWorldMatrix());
+}
+
+bool Transform::UpdateConstantBuffer(ID3D11DeviceContext *context, const XMMATRIX &worldMatrix)
+{
+	const XMMATRIX transposeWorldMatrix = XMMatrixTranspose(worldMatrix);
 	const XMMATRIX worldMatrixData[2] = {
 		transposeWorldMatrix,
 		XMMatrixTranspose(XMMatrixInverse(nullptr, transposeWorldMatrix)),
@@ -377,8 +383,15 @@ XMMATRIX Transform::GetLocalMatrix() const
 }
 XMMATRIX Transform::GetWorldMatrix() const
 {
-	if (!_parent)
-		return GetLocalMatrix();
+	if (_isWorldMatrixDirty)
+	{
+		XMMATRIX worldMatrix = GetLocalMatrix();
+		if (_parent)
+			worldMatrix = XMMatrixMultiply(worldMatrix, _parent->GetWorldMatrix());
+
+		XMStoreFloat4x4A(&_worldMatrix, worldMatrix);
+		_isWorldMatrixDirty = false;
+	}
 
-	return XMMatrixMultiply(GetLocalMatrix(), _parent->GetWorldMatrix());
+	return XMLoadFloat4x4A(&_worldMatrix);
 }
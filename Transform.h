@@ -20,6 +20,10 @@ private:
 	ConstantBufferD3D11 _worldMatrixBuffer;
 	bool _isDirty = true;
 
+	// Cached by GetWorldMatrix(), which only recomputes it after this transform or an ancestor has been dirtied.
+	mutable DirectX::XMFLOAT4X4A _worldMatrix = { };
+	mutable bool _isWorldMatrixDirty = true;
+
 	Transform *_parent = nullptr;
 	std::vector<Transform*> _children;
 
@@ -69,7 +73,9 @@ public:
 	[[nodiscard]] bool GetDirty() const;
 
 	[[nodiscard]] bool UpdateConstantBuffer(ID3D11DeviceContext *context);
+	[[nodiscard]] bool UpdateConstantBuffer(ID3D11DeviceContext *context, const DirectX::XMMATRIX &worldMatrix);
 	[[nodiscard]] ID3D11Buffer *GetConstantBuffer() const;
 	[[nodiscard]] DirectX::XMMATRIX GetLocalMatrix() const;
+	// Not thread-safe while the transform is dirty.
 	[[nodiscard]] DirectX::XMMATRIX GetWorldMatrix() const;
 };
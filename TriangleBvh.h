@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <DirectXMath.h>
+
+typedef unsigned int UINT;
+
+
+// Closest intersection of a ray with the triangles of a mesh.
+// The hit point is (1 - u - v) * v0 + u * v1 + v * v2 of the triangle with index triangle.
+struct TriangleRaycastHit
+{
+	float distance = FLT_MAX;
+	UINT triangle = 0xffffffff;
+	float u = 0.0f, v = 0.0f;
+};
+
+
+// Bounding volume hierarchy over the triangles of a single mesh, built once at load time and queried in object space.
+class TriangleBvh
+{
+private:
+	static constexpr UINT MAX_LEAF_TRIANGLES = 4;
+	static constexpr UINT MAX_STACK_SIZE = 64;
+
+	struct Node
+	{
+		DirectX::XMFLOAT3 boundsMin, boundsMax;
+		UINT first = 0; // First triangle of leaves, left child of internal nodes. The right child follows the left.
+		UINT count = 0; // Triangle count, zero for internal nodes.
+	};
+
+	// Triangles stored in leaf order as one vertex and two edges, ready for the intersection test.
+	struct Triangle
+	{
+		DirectX::XMFLOAT3 v0, edge1, edge2;
+		UINT index = 0;
+	};
+
+	std::vector<Node> _nodes;
+	std::vector<Triangle> _triangles;
+
+
+	void UpdateNodeBounds(Node &node) const
+	{
+		node.boundsMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+		node.boundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (UINT i = node.first; i < node.first + node.count; i++)
+		{
+			const Triangle &tri = _triangles[i];
+			const DirectX::XMFLOAT3 verts[3] = {
+				tri.v0,
+				{ tri.v0.x + tri.edge1.x, tri.v0.y + tri.edge1.y, tri.v0.z + tri.edge1.z },
+				{ tri.v0.x + tri.edge2.x, tri.v0.y + tri.edge2.y, tri.v0.z + tri.edge2.z }
+			};
+
+			for (const DirectX::XMFLOAT3 &vert : verts)
+			{
+				node.boundsMin = { (std::min)(node.boundsMin.x, vert.x), (std::min)(node.boundsMin.y, vert.y), (std::min)(node.boundsMin.z, vert.z) };
+				node.boundsMax = { (std::max)(node.boundsMax.x, vert.x), (std::max)(node.boundsMax.y, vert.y), (std::max)(node.boundsMax.z, vert.z) };
+			}
+		}
+	}
+
+	// Splits nodes at the median centroid along their longest axis until leaves hold few enough triangles.
+	void Subdivide(const UINT nodeIndex)
+	{
+		if (_nodes[nodeIndex].count <= MAX_LEAF_TRIANGLES)
+			return;
+
+		const UINT first = _nodes[nodeIndex].first, count = _nodes[nodeIndex].count;
+
+		float centroidMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, centroidMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (UINT i = first; i < first + count; i++)
+		{
+			const float centroid[3] = { Centroid(_triangles[i], 0), Centroid(_triangles[i], 1), Centroid(_triangles[i], 2) };
+			for (UINT axis = 0; axis < 3; axis++)
+			{
+				centroidMin[axis] = (std::min)(centroidMin[axis], centroid[axis]);
+				centroidMax[axis] = (std::max)(centroidMax[axis], centroid[axis]);
+			}
+		}
+
+		UINT axis = 0;
+		for (UINT a = 1; a < 3; a++)
+		{
+			if (centroidMax[a] - centroidMin[a] > centroidMax[axis] - centroidMin[axis])
+				axis = a;
+		}
+
+		const UINT half = count / 2;
+		std::nth_element(_triangles.begin() + first, _triangles.begin() + first + half, _triangles.begin() + first + count,
+			[axis](const Triangle &a, const Triangle &b) { return Centroid(a, axis) < Centroid(b, axis); });
+
+		const UINT leftIndex = static_cast<UINT>(_nodes.size());
+		_nodes.emplace_back();
+		_nodes.emplace_back();
+
+		Node &left = _nodes[leftIndex], &right = _nodes[leftIndex + 1];
+		left.first = first;
+		left.count = half;
+		right.first = first + half;
+		right.count = count - half;
+		UpdateNodeBounds(left);
+		UpdateNodeBounds(right);
+
+		_nodes[nodeIndex].first = leftIndex;
+		_nodes[nodeIndex].count = 0;
+
+		Subdivide(leftIndex);
+		Subdivide(leftIndex + 1);
+	}
+
+	[[nodiscard]] static float Centroid(const Triangle &tri, const UINT axis)
+	{
+		const float *v0 = &tri.v0.x, *edge1 = &tri.edge1.x, *edge2 = &tri.edge2.x;
+		return v0[axis] + (edge1[axis] + edge2[axis]) * (1.0f / 3.0f);
+	}
+
+	// Returns the distance at which the ray enters the node, or zero if it starts inside.
+	[[nodiscard]] static bool RaycastNode(const Node &node, const DirectX::XMFLOAT3 &orig, const DirectX::XMFLOAT3 &invDir, float &length)
+	{
+		const float
+			tx1 = (node.boundsMin.x - orig.x) * invDir.x, tx2 = (node.boundsMax.x - orig.x) * invDir.x,
+			ty1 = (node.boundsMin.y - orig.y) * invDir.y, ty2 = (node.boundsMax.y - orig.y) * invDir.y,
+			tz1 = (node.boundsMin.z - orig.z) * invDir.z, tz2 = (node.boundsMax.z - orig.z) * invDir.z;
+
+		const float
+			tmin = (std::max)((std::max)((std::min)(tx1, tx2), (std::min)(ty1, ty2)), (std::min)(tz1, tz2)),
+			tmax = (std::min)((std::min)((std::max)(tx1, tx2), (std::max)(ty1, ty2)), (std::max)(tz1, tz2));
+
+		if (!(tmax >= (std::max)(0.0f, tmin)))
+			return false;
+
+		length = (std::max)(0.0f, tmin);
+		return true;
+	}
+
+	// Moller-Trumbore intersection, accepting hits from either side of the triangle.
+	[[nodiscard]] static bool RaycastTriangle(const Triangle &tri, const DirectX::XMFLOAT3 &orig, const DirectX::XMFLOAT3 &dir, TriangleRaycastHit &hit)
+	{
+		using namespace DirectX;
+
+		const XMVECTOR
+			rayDir = XMLoadFloat3(&dir),
+			edge1 = XMLoadFloat3(&tri.edge1),
+			edge2 = XMLoadFloat3(&tri.edge2);
+
+		const XMVECTOR pVec = XMVector3Cross(rayDir, edge2);
+		const float det = XMVectorGetX(XMVector3Dot(edge1, pVec));
+		if (det == 0.0f)
+			return false;
+
+		const float invDet = 1.0f / det;
+		const XMVECTOR tVec = XMVectorSubtract(XMLoadFloat3(&orig), XMLoadFloat3(&tri.v0));
+
+		const float u = XMVectorGetX(XMVector3Dot(tVec, pVec)) * invDet;
+		if (u < 0.0f || u > 1.0f)
+			return false;
+
+		const XMVECTOR qVec = XMVector3Cross(tVec, edge1);
+		const float v = XMVectorGetX(XMVector3Dot(rayDir, qVec)) * invDet;
+		if (v < 0.0f || u + v > 1.0f)
+			return false;
+
+		const float t = XMVectorGetX(XMVector3Dot(edge2, qVec)) * invDet;
+		if (t < 0.0f || t >= hit.distance)
+			return false;
+
+		hit.distance = t;
+		hit.triangle = tri.index;
+		hit.u = u;
+		hit.v = v;
+		return true;
+	}
+
+
+public:
+	TriangleBvh() = default;
+	~TriangleBvh() = default;
+	TriangleBvh(const TriangleBvh &other) = delete;
+	TriangleBvh &operator=(const TriangleBvh &other) = delete;
+	TriangleBvh(TriangleBvh &&other) = default;
+	TriangleBvh &operator=(TriangleBvh &&other) = default;
+
+	// Builds the hierarchy from an indexed triangle list. Each vertex is vertexStride bytes and starts with its position.
+	[[nodiscard]] bool Build(const float *vertexData, const UINT vertexStride, const UINT vertexCount, const uint32_t *indexData, const UINT indexCount)
+	{
+		_nodes.clear();
+		_triangles.clear();
+
+		if (vertexData == nullptr || indexData == nullptr || vertexStride < sizeof(DirectX::XMFLOAT3) || indexCount % 3 != 0)
+			return false;
+
+		const unsigned char *vertexBytes = reinterpret_cast<const unsigned char *>(vertexData);
+		auto loadPosition = [&](const uint32_t index)
+		{
+			DirectX::XMFLOAT3 position;
+			std::memcpy(&position, vertexBytes + static_cast<size_t>(index) * vertexStride, sizeof(position));
+			return position;
+		};
+
+		const UINT triangleCount = indexCount / 3;
+		_triangles.reserve(triangleCount);
+
+		for (UINT i = 0; i < triangleCount; i++)
+		{
+			const uint32_t i0 = indexData[i * 3], i1 = indexData[i * 3 + 1], i2 = indexData[i * 3 + 2];
+			if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+			{
+				_triangles.clear();
+				return false;
+			}
+
+			const DirectX::XMFLOAT3 p0 = loadPosition(i0), p1 = loadPosition(i1), p2 = loadPosition(i2);
+
+			Triangle &tri = _triangles.emplace_back();
+			tri.v0 = p0;
+			tri.edge1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+			tri.edge2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+			tri.index = i;
+		}
+
+		if (_triangles.empty())
+			return true;
+
+		_nodes.reserve(2 * (triangleCount / MAX_LEAF_TRIANGLES + 1));
+
+		Node &root = _nodes.emplace_back();
+		root.first = 0;
+		root.count = triangleCount;
+		UpdateNodeBounds(root);
+		Subdivide(0);
+
+		return true;
+	}
+
+	[[nodiscard]] bool IsEmpty() const
+	{
+		return _nodes.empty();
+	}
+
+	[[nodiscard]] UINT GetTriangleCount() const
+	{
+		return static_cast<UINT>(_triangles.size());
+	}
+
+	// Finds the closest triangle hit by the ray closer than hit.distance, in units of the length of dir.
+	// Returns false, leaving hit untouched, if no such triangle exists.
+	[[nodiscard]] bool Raycast(const DirectX::XMFLOAT3 &orig, const DirectX::XMFLOAT3 &dir, TriangleRaycastHit &hit) const
+	{
+		if (_nodes.empty())
+			return false;
+
+		const DirectX::XMFLOAT3 invDir = { 1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z };
+		bool isHit = false;
+
+		struct StackEntry { UINT node; float length; };
+		StackEntry stack[MAX_STACK_SIZE];
+		UINT stackSize = 0;
+
+		float rootLength = 0.0f;
+		if (!RaycastNode(_nodes[0], orig, invDir, rootLength))
+			return false;
+
+		stack[stackSize++] = { 0, rootLength };
+		while (stackSize > 0)
+		{
+			const StackEntry entry = stack[--stackSize];
+			if (entry.length >= hit.distance)
+				continue;
+
+			const Node &node = _nodes[entry.node];
+			if (node.count > 0)
+			{
+				for (UINT i = node.first; i < node.first + node.count; i++)
+					isHit |= RaycastTriangle(_triangles[i], orig, dir, hit);
+				continue;
+			}
+
+			float leftLength = 0.0f, rightLength = 0.0f;
+			const bool
+				leftHit = RaycastNode(_nodes[node.first], orig, invDir, leftLength) && leftLength < hit.distance,
+				rightHit = RaycastNode(_nodes[node.first + 1], orig, invDir, rightLength) && rightLength < hit.distance;
+
+			// Push the further child first so the closer one is visited first.
+			if (leftHit && rightHit && leftLength < rightLength)
+			{
+				stack[stackSize++] = { node.first + 1, rightLength };
+				stack[stackSize++] = { node.first, leftLength };
+			}
+			else
+			{
+				if (leftHit)
+					stack[stackSize++] = { node.first, leftLength };
+				if (rightHit)
+					stack[stackSize++] = { node.first + 1, rightLength };
+			}
+		}
+
+		return isHit;
+	}
+};
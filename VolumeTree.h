@@ -0,0 +1,628 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <DirectXCollision.h>
+
+#include "CullingKernel.h"
+#include "Raycast.h"
+#include "RayPacket.h"
+
+typedef unsigned int UINT;
+
+// Volume trees only store and return entity pointers, they never dereference them.
+// This keeps the trees free of any D3D11 dependencies so they can be built and benchmarked headless.
+class Entity;
+
+
+enum class VolumeTreeType
+{
+	QUADTREE,
+	OCTREE,
+	LOOSE_OCTREE,
+	LINEAR_OCTREE,
+	BVH,
+	NOTREE,
+	HASH_GRID,
+};
+
+
+// Entity stored in a volume tree node, along with the world bounds it was inserted with.
+// The slot is a dense per-tree index shared by every node holding the same entity.
+struct VolumeTreeItem
+{
+	Entity *entity = nullptr;
+	DirectX::BoundingBox bounds;
+	UINT slot = 0;
+};
+
+
+// Spreads the low 10 bits of a value out to every third bit.
+[[nodiscard]] inline std::uint32_t SpreadMortonBits(std::uint32_t value)
+{
+	value &= 0x000003ff;
+	value = (value | (value << 16)) & 0x030000ff;
+	value = (value | (value << 8)) & 0x0300f00f;
+	value = (value | (value << 4)) & 0x030c30c3;
+	value = (value | (value << 2)) & 0x09249249;
+	return value;
+}
+
+// 30-bit Morton code of a point quantized to a 1024^3 grid over the given bounds, clamped to the bounds.
+[[nodiscard]] inline std::uint32_t GetMortonCode(const DirectX::XMFLOAT3 &point, const DirectX::BoundingBox &bounds)
+{
+	auto quantize = [](const float value, const float center, const float extent) -> std::uint32_t
+	{
+		const float normalized = (extent > 0.0f) ? (value - center + extent) / (2.0f * extent) : 0.5f;
+		return static_cast<std::uint32_t>(std::clamp(normalized, 0.0f, 1.0f) * 1023.0f);
+	};
+
+	return SpreadMortonBits(quantize(point.x, bounds.Center.x, bounds.Extents.x))
+		| (SpreadMortonBits(quantize(point.y, bounds.Center.y, bounds.Extents.y)) << 1)
+		| (SpreadMortonBits(quantize(point.z, bounds.Center.z, bounds.Extents.z)) << 2);
+}
+
+// Orders items along a Morton curve by the centers of their bounds, so that consecutive items lie close together.
+// The 30-bit codes are radix sorted 10 bits at a time, keeping the sort linear in the item count.
+inline void SortByMortonCode(std::vector<VolumeTreeItem> &items, const DirectX::BoundingBox &bounds)
+{
+	constexpr UINT RADIX_BITS = 10, RADIX_SIZE = 1 << RADIX_BITS;
+
+	const UINT itemCount = static_cast<UINT>(items.size());
+	std::vector<std::pair<std::uint32_t, UINT>> codes(itemCount), sortedCodes(itemCount);
+	for (UINT i = 0; i < itemCount; i++)
+		codes[i] = { GetMortonCode(items[i].bounds.Center, bounds), i };
+
+	for (UINT shift = 0; shift < 30; shift += RADIX_BITS)
+	{
+		std::vector<UINT> offsets(RADIX_SIZE + 1, 0);
+		for (const auto &code : codes)
+			offsets[((code.first >> shift) & (RADIX_SIZE - 1)) + 1]++;
+
+		for (UINT i = 1; i <= RADIX_SIZE; i++)
+			offsets[i] += offsets[i - 1];
+
+		for (const auto &code : codes)
+			sortedCodes[offsets[(code.first >> shift) & (RADIX_SIZE - 1)]++] = code;
+
+		std::swap(codes, sortedCodes);
+	}
+
+	std::vector<VolumeTreeItem> sortedItems(itemCount);
+	for (UINT i = 0; i < itemCount; i++)
+		sortedItems[i] = items[codes[i].second];
+
+	items = std::move(sortedItems);
+}
+
+
+// Per-thread record of which item slots have already been added to the results of a query.
+// Each query bumps the generation instead of clearing the stamps, making duplicate checks O(1).
+class VolumeTreeVisitedSet
+{
+private:
+	std::vector<UINT> _stamps;
+	UINT _generation = 0;
+
+public:
+	void BeginQuery(const UINT slotCount)
+	{
+		if (_stamps.size() < slotCount)
+			_stamps.resize(slotCount, 0);
+
+		if (++_generation == 0)
+		{ // Generation wrapped around, stale stamps could now match.
+			std::fill(_stamps.begin(), _stamps.end(), 0);
+			_generation = 1;
+		}
+	}
+
+	// Returns true the first time a slot is visited during the current query.
+	[[nodiscard]] bool Visit(const UINT slot)
+	{
+		if (_stamps[slot] == _generation)
+			return false;
+
+		_stamps[slot] = _generation;
+		return true;
+	}
+};
+
+inline thread_local VolumeTreeVisitedSet volumeTreeVisitedSet;
+
+
+// One bit per view of a multi-view query.
+typedef std::uint64_t ViewMask;
+constexpr UINT MAX_CULLING_VIEWS = 64;
+
+// Per-thread record of which views each item slot has already been added to during a multi-view query.
+class VolumeTreeVisitedViews
+{
+private:
+	std::vector<UINT> _stamps;
+	std::vector<ViewMask> _views;
+	UINT _generation = 0;
+
+public:
+	void BeginQuery(const UINT slotCount)
+	{
+		if (_stamps.size() < slotCount)
+		{
+			_stamps.resize(slotCount, 0);
+			_views.resize(slotCount, 0);
+		}
+
+		if (++_generation == 0)
+		{ // Generation wrapped around, stale stamps could now match.
+			std::fill(_stamps.begin(), _stamps.end(), 0);
+			_generation = 1;
+		}
+	}
+
+	// Returns the given views the slot has not yet been added to during the current query.
+	[[nodiscard]] ViewMask GetUnvisited(const UINT slot, const ViewMask views) const
+	{
+		return (_stamps[slot] == _generation) ? (views & ~_views[slot]) : views;
+	}
+
+	void Visit(const UINT slot, const ViewMask views)
+	{
+		if (_stamps[slot] != _generation)
+		{
+			_stamps[slot] = _generation;
+			_views[slot] = 0;
+		}
+
+		_views[slot] |= views;
+	}
+};
+
+inline thread_local VolumeTreeVisitedViews volumeTreeVisitedViews;
+
+
+#ifdef VOLUME_TREE_STATS
+// Per-thread counters updated by the volume trees when built with VOLUME_TREE_STATS defined.
+struct VolumeTreeStats
+{
+	size_t nodesVisited = 0;
+	size_t intersectionTests = 0;
+	size_t duplicateItems = 0;
+};
+
+inline thread_local VolumeTreeStats volumeTreeStats;
+
+#define VOLUME_TREE_STAT(stat) (++volumeTreeStats.stat)
+#else
+#define VOLUME_TREE_STAT(stat) ((void)0)
+#endif
+
+
+// Visibility of a node against every view of a multi-view query.
+struct MultiViewState
+{
+	ViewMask activeViews = 0; // Views that see at least part of the node.
+	ViewMask containedViews = 0; // Active views that see all of the node.
+	unsigned char planeMasks[MAX_CULLING_VIEWS] = { }; // Planes each partially seeing view still needs to test.
+};
+
+// Culls against up to MAX_CULLING_VIEWS views in one traversal, appending the entities each view sees to its own list.
+// Trees classify every node with ClassifyNode(), skipping subtrees as soon as no view remains, and report items through AddItem().
+class MultiViewQuery
+{
+private:
+	const CullingPlanes *_views = nullptr;
+	std::vector<Entity *> *_viewItems = nullptr;
+	UINT _viewCount = 0;
+
+public:
+	MultiViewQuery(const CullingPlanes *views, std::vector<Entity *> *viewItems, const UINT viewCount) :
+		_views(views), _viewItems(viewItems), _viewCount((std::min)(viewCount, MAX_CULLING_VIEWS))
+	{
+	}
+
+	[[nodiscard]] UINT GetViewCount() const
+	{
+		return _viewCount;
+	}
+
+	[[nodiscard]] const CullingPlanes &GetView(const UINT view) const
+	{
+		return _views[view];
+	}
+
+	// Starts the query for a tree with the given slot count, returning the state where every view still tests every plane.
+	[[nodiscard]] MultiViewState Begin(const UINT slotCount) const
+	{
+		volumeTreeVisitedViews.BeginQuery(slotCount);
+
+		MultiViewState state;
+		state.activeViews = (_viewCount == MAX_CULLING_VIEWS) ? ~ViewMask(0) : ((ViewMask(1) << _viewCount) - 1);
+		std::fill_n(state.planeMasks, _viewCount, static_cast<unsigned char>(CULLING_ALL_PLANES));
+		return state;
+	}
+
+	// Classifies node bounds against the views that see the parent partially. Returns false if no view sees the node.
+	[[nodiscard]] bool ClassifyNode(const MultiViewState &parent, const DirectX::BoundingBox &bounds, MultiViewState &state) const
+	{
+		state = parent;
+
+		ViewMask partialViews = parent.activeViews & ~parent.containedViews;
+		while (partialViews != 0)
+		{
+			const UINT view = static_cast<UINT>(std::countr_zero(partialViews));
+			const ViewMask viewBit = ViewMask(1) << view;
+			partialViews &= partialViews - 1;
+
+			VOLUME_TREE_STAT(intersectionTests);
+
+			const UINT result = ClassifyBox(_views[view], parent.planeMasks[view], bounds);
+			if (result == CULLING_OUTSIDE)
+				state.activeViews &= ~viewBit;
+			else if (result == 0)
+				state.containedViews |= viewBit;
+			else
+				state.planeMasks[view] = static_cast<unsigned char>(result);
+		}
+
+		return state.activeViews != 0;
+	}
+
+	// Adds an item to the list of every view in the state that sees it and has not received it yet.
+	void AddItem(const MultiViewState &state, Entity *entity, const DirectX::BoundingBox &bounds, const UINT slot) const
+	{
+		const ViewMask unvisitedViews = volumeTreeVisitedViews.GetUnvisited(slot, state.activeViews);
+		if (unvisitedViews != state.activeViews)
+			VOLUME_TREE_STAT(duplicateItems);
+
+		ViewMask seenViews = unvisitedViews & state.containedViews;
+
+		ViewMask partialViews = unvisitedViews & ~state.containedViews;
+		while (partialViews != 0)
+		{
+			const UINT view = static_cast<UINT>(std::countr_zero(partialViews));
+			partialViews &= partialViews - 1;
+
+			VOLUME_TREE_STAT(intersectionTests);
+
+			if (ClassifyBox(_views[view], state.planeMasks[view], bounds) != CULLING_OUTSIDE)
+				seenViews |= ViewMask(1) << view;
+		}
+
+		AddVisibleItem(entity, slot, seenViews);
+	}
+
+	// Adds an item already classified by the tree to the list of every given view that has not received it yet.
+	void AddVisibleItem(Entity *entity, const UINT slot, ViewMask seenViews) const
+	{
+		seenViews = volumeTreeVisitedViews.GetUnvisited(slot, seenViews);
+		if (seenViews == 0)
+			return;
+
+		volumeTreeVisitedViews.Visit(slot, seenViews);
+
+		while (seenViews != 0)
+		{
+			_viewItems[std::countr_zero(seenViews)].push_back(entity);
+			seenViews &= seenViews - 1;
+		}
+	}
+};
+
+
+// Entity found by a nearest query, along with the distance from the query point to its bounds.
+struct NearestItem
+{
+	Entity *entity = nullptr;
+	float distance = 0.0f;
+};
+
+// k-nearest queries keep their candidates in a fixed-size heap, so at most this many entities are found at once.
+constexpr UINT MAX_NEAREST_ITEMS = 64;
+
+// Finds either the k entities nearest to a point or every entity within a radius of it, measured to the entity bounds.
+// Trees visit nodes nearest first with ClassifyNode(), skipping those farther than the current bound, and report items through AddItem().
+class NearestQuery
+{
+private:
+	struct Candidate
+	{
+		float distanceSq;
+		Entity *entity;
+
+		[[nodiscard]] bool operator<(const Candidate &other) const { return distanceSq < other.distanceSq; }
+	};
+
+	DirectX::XMFLOAT3 _point;
+	float _maxDistanceSq;
+	UINT _maxCount; // Zero for radius queries, which keep every entity within the radius.
+
+	Candidate _heap[MAX_NEAREST_ITEMS]; // Max-heap of the nearest entities so far in k-nearest queries.
+	UINT _heapSize = 0;
+
+	std::vector<NearestItem> *_results = nullptr;
+	size_t _resultStart = 0;
+
+public:
+	// A count of zero finds every entity within maxDistance instead of only the nearest ones.
+	NearestQuery(const DirectX::XMFLOAT3 &point, const float maxDistance, const UINT maxCount, std::vector<NearestItem> &results) :
+		_point(point), _maxDistanceSq(maxDistance * maxDistance), _maxCount((std::min)(maxCount, MAX_NEAREST_ITEMS)),
+		_results(&results), _resultStart(results.size())
+	{
+	}
+
+	[[nodiscard]] const DirectX::XMFLOAT3 &GetPoint() const
+	{
+		return _point;
+	}
+
+	// Squared distance beyond which no entity is accepted, shrinking once the k nearest candidates are found.
+	[[nodiscard]] float GetMaxDistanceSq() const
+	{
+		return (_maxCount > 0 && _heapSize == _maxCount) ? _heap[0].distanceSq : _maxDistanceSq;
+	}
+
+	[[nodiscard]] float GetDistanceSq(const DirectX::BoundingBox &bounds) const
+	{
+		const float
+			dx = (std::max)(std::abs(_point.x - bounds.Center.x) - bounds.Extents.x, 0.0f),
+			dy = (std::max)(std::abs(_point.y - bounds.Center.y) - bounds.Extents.y, 0.0f),
+			dz = (std::max)(std::abs(_point.z - bounds.Center.z) - bounds.Extents.z, 0.0f);
+
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	// Starts the query for a tree with the given slot count. Queries may span several trees before End().
+	void Begin(const UINT slotCount) const
+	{
+		volumeTreeVisitedSet.BeginQuery(slotCount);
+	}
+
+	// Returns false if nothing within the node bounds can be accepted, otherwise setting the squared distance to the node.
+	[[nodiscard]] bool ClassifyNode(const DirectX::BoundingBox &bounds, float &distanceSq) const
+	{
+		VOLUME_TREE_STAT(intersectionTests);
+
+		distanceSq = GetDistanceSq(bounds);
+		return distanceSq <= GetMaxDistanceSq();
+	}
+
+	void AddItem(Entity *entity, const DirectX::BoundingBox &bounds, const UINT slot)
+	{
+		if (!volumeTreeVisitedSet.Visit(slot))
+		{
+			VOLUME_TREE_STAT(duplicateItems);
+			return;
+		}
+
+		VOLUME_TREE_STAT(intersectionTests);
+
+		const float distanceSq = GetDistanceSq(bounds);
+		if (distanceSq > _maxDistanceSq)
+			return;
+
+		if (_maxCount == 0)
+		{
+			_results->push_back({ entity, distanceSq });
+			return;
+		}
+
+		if (_heapSize == _maxCount)
+		{
+			if (distanceSq >= _heap[0].distanceSq)
+				return;
+
+			std::pop_heap(_heap, _heap + _heapSize--);
+		}
+
+		_heap[_heapSize++] = { distanceSq, entity };
+		std::push_heap(_heap, _heap + _heapSize);
+	}
+
+	// Appends the entities found to the results, nearest first.
+	void End()
+	{
+		if (_maxCount > 0)
+		{
+			std::sort_heap(_heap, _heap + _heapSize);
+			for (UINT i = 0; i < _heapSize; i++)
+				_results->push_back({ _heap[i].entity, _heap[i].distanceSq });
+			_heapSize = 0;
+		}
+		else
+		{
+			std::sort(_results->begin() + _resultStart, _results->end(),
+				[](const NearestItem &a, const NearestItem &b) { return a.distance < b.distance; });
+		}
+
+		for (auto it = _results->begin() + _resultStart; it != _results->end(); ++it)
+			it->distance = std::sqrt(it->distance);
+	}
+};
+
+
+// Narrow-phase test for entities whose bounds are hit by a tree raycast, such as a test against the triangles of their mesh.
+class RaycastItemTest
+{
+public:
+	virtual ~RaycastItemTest() = default;
+
+	// Index of the ray being tested within its batch, set by packet raycasts before every test.
+	UINT ray = 0;
+
+	// Called with length set to where the ray enters the entity bounds. Returns true if the entity is hit closer than
+	// maxLength, setting length to the distance of the hit. The tree always accepts such a hit as its new closest one.
+	[[nodiscard]] virtual bool Test(Entity *entity, float maxLength, float &length) = 0;
+};
+
+// Raycasts the bounds of a tree item, replacing the closest hit so far if the item is hit closer.
+// With an item test the bounds only reject items, the item test decides the hit distance.
+inline void RaycastItem(const DirectX::XMFLOAT3 &orig, const DirectX::XMFLOAT3 &dir, Entity *item, const DirectX::BoundingBox &bounds,
+	RaycastItemTest *itemTest, float &length, Entity *&entity)
+{
+	VOLUME_TREE_STAT(intersectionTests);
+
+	float newLength = 0.0f;
+	if (itemTest == nullptr)
+	{
+		if (!Raycast(orig, dir, bounds, newLength))
+			return;
+
+		if (newLength < 0.0f || newLength >= length)
+			return;
+	}
+	else
+	{
+		if (!RaycastEntry(orig, dir, bounds, newLength) || newLength >= length)
+			return;
+
+		if (!itemTest->Test(item, length, newLength))
+			return;
+	}
+
+	length = newLength;
+	entity = item;
+}
+
+// Raycasts the bounds of a tree item with every ray in rayMask that is still active, recording hits in the packet.
+inline void RaycastPacketItem(RayPacket &packet, const UINT rayMask, Entity *item, const DirectX::BoundingBox &bounds, RaycastItemTest *itemTest)
+{
+	VOLUME_TREE_STAT(intersectionTests);
+
+	// The wide test only rejects rays, the hit distance of each remaining ray is decided as in RaycastItem().
+	for (UINT hits = RaycastBoxPacket(packet, rayMask & packet.activeRays, bounds); hits != 0; hits &= hits - 1)
+	{
+		const UINT ray = static_cast<UINT>(std::countr_zero(hits));
+		if (itemTest != nullptr)
+			itemTest->ray = packet.rayIndex[ray];
+
+		float length = packet.length[ray];
+		Entity *entity = nullptr;
+		RaycastItem(packet.origin[ray], packet.direction[ray], item, bounds, itemTest, length, entity);
+
+		if (entity != nullptr)
+			packet.SetHit(ray, entity, length);
+	}
+}
+
+
+// Common interface for the spatial structures used to cull and raycast scene entities.
+class VolumeTree
+{
+public:
+	VolumeTree() = default;
+	virtual ~VolumeTree() = default;
+	VolumeTree(const VolumeTree &other) = delete;
+	VolumeTree &operator=(const VolumeTree &other) = delete;
+	VolumeTree(VolumeTree &&other) = delete;
+	VolumeTree &operator=(VolumeTree &&other) = delete;
+
+	[[nodiscard]] virtual VolumeTreeType GetType() const = 0;
+
+	[[nodiscard]] virtual bool Initialize(const DirectX::BoundingBox &sceneBounds) = 0;
+
+	// Whether queries only find entities lying fully within the bounds the tree was initialized with.
+	[[nodiscard]] virtual bool IsBounded() const { return true; }
+
+	// Applies deferred structural changes. Called once per frame, never concurrently with queries.
+	[[nodiscard]] virtual bool Update() { return true; }
+
+	virtual void Insert(Entity *data, const DirectX::BoundingBox &bounds) = 0;
+
+	// Inserts many entities at once, such as when loading a level. The slots of the given items are ignored,
+	// and the tree may reorder the items. Trees without a bulk build insert the items one at a time.
+	virtual void InsertBulk(std::vector<VolumeTreeItem> &items)
+	{
+		for (const VolumeTreeItem &item : items)
+			Insert(item.entity, item.bounds);
+	}
+
+	// Trees that find entities through their slot forward this to Remove(data), ignoring the bounds.
+	[[nodiscard]] virtual bool Remove(Entity *data, const DirectX::BoundingBox &bounds) = 0;
+	[[nodiscard]] virtual bool Remove(Entity *data) = 0;
+
+	// Updates the bounds of an entity already in the tree, inserting it if it is not.
+	[[nodiscard]] virtual bool Move(Entity *data, const DirectX::BoundingBox &bounds) = 0;
+
+	[[nodiscard]] virtual bool FrustumCull(const DirectX::BoundingFrustum &frustum, std::vector<Entity *> &containingItems) const = 0;
+	[[nodiscard]] virtual bool BoxCull(const DirectX::BoundingOrientedBox &box, std::vector<Entity *> &containingItems) const = 0;
+	[[nodiscard]] virtual bool MultiViewCull(const MultiViewQuery &query) const = 0;
+
+	// Reports the entities that may be nearest to the query point, visiting the nearest nodes first.
+	[[nodiscard]] virtual bool NearestCull(NearestQuery &query) const = 0;
+
+	// Finds the closest entity hit by the ray before length, which is then set to the distance of the hit.
+	// If itemTest is given, it decides whether and where each entity with hit bounds is hit.
+	virtual bool RaycastTree(const DirectX::XMFLOAT3A &orig, const DirectX::XMFLOAT3A &dir, float &length, Entity *&entity, RaycastItemTest *itemTest) const = 0;
+
+	// Traces every active ray of the packet, storing the entity each ray hits & the distance of the hit.
+	// Trees without a packet traversal trace the rays one at a time, where any-hit rays still find the closest hit.
+	virtual void RaycastPacket(RayPacket &packet, RaycastItemTest *itemTest) const
+	{
+		for (UINT rays = packet.activeRays; rays != 0; rays &= rays - 1)
+		{
+			const UINT ray = static_cast<UINT>(std::countr_zero(rays));
+			if (itemTest != nullptr)
+				itemTest->ray = packet.rayIndex[ray];
+
+			const DirectX::XMFLOAT3A
+				orig = { packet.origin[ray].x, packet.origin[ray].y, packet.origin[ray].z },
+				dir = { packet.direction[ray].x, packet.direction[ray].y, packet.direction[ray].z };
+
+			float length = packet.length[ray];
+			Entity *entity = nullptr;
+			if (RaycastTree(orig, dir, length, entity, itemTest))
+				packet.SetHit(ray, entity, length);
+		}
+	}
+
+	[[nodiscard]] virtual const DirectX::BoundingBox *GetBounds() const = 0;
+
+	virtual void DebugGetStructure(std::vector<DirectX::BoundingBox> &boxCollection) const = 0;
+
+
+protected:
+	std::unordered_map<const Entity *, UINT> _itemSlots;
+	std::vector<UINT> _freeSlots;
+	UINT _slotCount = 0;
+
+	// Returns the slot of an entity, assigning a new one if the entity is not yet stored in the tree.
+	[[nodiscard]] UINT AcquireSlot(const Entity *entity)
+	{
+		if (const auto it = _itemSlots.find(entity); it != _itemSlots.end())
+			return it->second;
+
+		UINT slot;
+		if (!_freeSlots.empty())
+		{
+			slot = _freeSlots.back();
+			_freeSlots.pop_back();
+		}
+		else
+			slot = _slotCount++;
+
+		_itemSlots.emplace(entity, slot);
+		return slot;
+	}
+
+	void ReleaseSlot(const Entity *entity)
+	{
+		const auto it = _itemSlots.find(entity);
+		if (it == _itemSlots.end())
+			return;
+
+		_freeSlots.push_back(it->second);
+		_itemSlots.erase(it);
+	}
+
+	void ClearSlots()
+	{
+		_itemSlots.clear();
+		_freeSlots.clear();
+		_slotCount = 0;
+	}
+};